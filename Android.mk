@@ -116,9 +116,21 @@ LOCAL_SRC_FILES := \
 	src/dbextension.cpp \
 	src/devicestream.cpp \
 	src/httpstream.cpp \
+	src/mpegts.cpp \
+	src/pcrclock.cpp \
+	src/pretuner.cpp \
+	src/psiprobe.cpp \
 	src/radiofilter.cpp \
+	src/rangestream.cpp \
 	src/scheduler.cpp \
+	src/segmentcache.cpp \
 	src/sqlite_exception.cpp \
+	src/streammeter.cpp \
+	src/streamrace.cpp \
+	src/streamreaper.cpp \
+	src/timeshiftbuffer.cpp \
+	src/tsaligner.cpp \
+	src/tsdemuxer.cpp \
 	src/xmlstream.cpp \
 	src/sqlext/uuid.c \
 	src/sqlext/zipfile.c
@@ -34,6 +34,7 @@
 #include <kodi/gui/dialogs/Select.h>
 #include <kodi/gui/dialogs/TextViewer.h>
 #include <sstream>
+#include <string.h>
 #include <version.h>
 
 #ifdef __ANDROID__
@@ -56,8 +57,12 @@
 #include "devicestream.h"
 #include "httpstream.h"
 #include "radiofilter.h"
+#include "rangestream.h"
+#include "streammeter.h"
 #include "string_exception.h"
 #include "sqlite_exception.h"
+#include "timeshiftbuffer.h"
+#include "tsaligner.h"
 
 #pragma warning(push, 4)
 
@@ -69,6 +74,7 @@ ADDONCREATOR(addon)
 //
 char const* addon::PROXY_CHANGED_TASK			= "proxy_changed_task";
 char const* addon::PUSH_LISTINGS_TASK			= "push_listings_task";
+char const* addon::RELEASE_PRETUNER_TASK		= "release_pretuner_task";
 char const* addon::UPDATE_DEVICES_TASK			= "update_devices_task";
 char const* addon::UPDATE_EPISODES_TASK			= "update_episodes_task";
 char const* addon::UPDATE_LINEUPS_TASK			= "update_lineups_task";
@@ -76,6 +82,14 @@ char const* addon::UPDATE_LISTINGS_TASK			= "update_listings_task";
 char const* addon::UPDATE_RECORDINGRULES_TASK	= "update_recordingrules_task";
 char const* addon::UPDATE_RECORDINGS_TASK		= "update_recordings_task";
 
+// Adaptive Stream Read Chunk Size
+//
+size_t const addon::ADAPTIVE_CHUNK_CHANNEL_BITRATES		= 16;
+long long const addon::ADAPTIVE_CHUNK_LIVE_BITRATE		= (19392658 / 8);	// ATSC 1.0
+size_t const addon::ADAPTIVE_CHUNK_MAX_SIZE				= (188 * 348);		// ~64 KiB
+size_t const addon::ADAPTIVE_CHUNK_MIN_SIZE				= (188 * 22);		// ~4 KiB
+size_t const addon::ADAPTIVE_CHUNK_READS_PER_SECOND		= 32;
+
 //---------------------------------------------------------------------------
 // addon Instance Constructor
 //
@@ -90,12 +104,22 @@ addon::addon() : m_discovered_devices{ false },
 	m_discovered_recordingrules{ false }, 
 	m_discovered_recordings{ false },
 	m_epgmaxtime{ EPG_TIMEFRAME_UNLIMITED }, 
+	m_lastchannelid{},
+	m_nextstreamid(1),
+	m_pcrclock(nullptr),
+	m_psiprobe(nullptr),
+	m_pvrstreamid{ 0 },
 	m_randomengine(static_cast<unsigned int>(time(nullptr))),
 	m_scheduler([&](std::exception const& ex) -> void { handle_stdexception("scheduled task", ex); }),
 	m_settings{},
 	m_startup_complete{ false },
 	m_stream_starttime(0), 
 	m_stream_endtime(0),
+	m_streambitrate(0),
+	m_streamchannelid{},
+	m_streammeter(nullptr),
+	m_telemetry_serial(0),
+	m_tempfile_serial{ 0 },
 	m_useproxy{ false } {}
 
 //---------------------------------------------------------------------------
@@ -109,6 +133,32 @@ addon::~addon()
 	Destroy();
 }
 
+//---------------------------------------------------------------------------
+// addon::adaptive_chunk_size (private)
+//
+// Calculates a stream read chunk size from the measured or estimated bitrate of
+// the active stream, aligned to MPEG-TS packets
+//
+// Arguments:
+//
+//	NONE
+
+size_t addon::adaptive_chunk_size(void) const
+{
+	if(!m_pvrstream) return ADAPTIVE_CHUNK_MIN_SIZE;
+
+	// Kodi asks for the chunk size as soon as the stream has been opened and before it has been read from, so
+	// the estimate made when the stream was opened is used until the stream meter has measured the actual rate
+	long long bitrate = (m_streammeter) ? static_cast<long long>(m_streammeter->bytespersecond()) : 0;
+	if(bitrate <= 0) bitrate = m_streambitrate;
+
+	// Size the chunk to keep the number of reads per second roughly constant
+	size_t chunksize = (bitrate > 0) ? static_cast<size_t>(bitrate) / ADAPTIVE_CHUNK_READS_PER_SECOND : 0;
+
+	chunksize = std::min(std::max(chunksize, ADAPTIVE_CHUNK_MIN_SIZE), ADAPTIVE_CHUNK_MAX_SIZE);
+	return chunksize - (chunksize % 188);
+}
+
 //---------------------------------------------------------------------------
 // addon::copy_settings (private, inline)
 //
@@ -263,10 +313,12 @@ void addon::discover_lineups(scalar_condition<bool> const&, bool& changed)
 //
 //	cancel		- Condition variable used to cancel the operation
 //	changed		- Reference to a flag indicating that the discovery information has changed
+//	removed		- Receives the upcoming listings that were removed
 
-void addon::discover_listings(scalar_condition<bool> const&, bool& changed)
+void addon::discover_listings(scalar_condition<bool> const&, bool& changed, std::vector<struct listingid>& removed)
 {
-	changed = true;						// Initialize [ref] argument
+	changed = false;					// Initialize [ref] argument
+	removed.clear();					// Initialize [ref] argument
 
 	// Create a copy of the current addon settings structure
 	struct settings settings = copy_settings();
@@ -286,7 +338,7 @@ void addon::discover_listings(scalar_condition<bool> const&, bool& changed)
 		if(has_dvr_authorization(dbhandle)) {
 
 			std::string authorization = get_authorization_strings(dbhandle, false);
-			if(authorization.length() != 0) ::discover_listings(dbhandle, authorization.c_str(), changed);
+			if(authorization.length() != 0) ::discover_listings(dbhandle, authorization.c_str(), changed, removed);
 		}
 
 		else log_info_if(trace, __func__, ": no tuners with valid DVR authorization were discovered; skipping listing discovery");
@@ -510,6 +562,23 @@ void addon::discover_recordings(scalar_condition<bool> const&, bool& changed)
 	catch(...) { m_discovered_recordings = true; throw; }
 }
 
+//---------------------------------------------------------------------------
+// addon::find_recordedstream (private)
+//
+// Locates an open recorded stream by stream id
+//
+// Arguments:
+//
+//	streamid	- ID of the recorded stream to locate
+
+std::shared_ptr<struct addon::recordedstream> addon::find_recordedstream(int64_t streamid) const
+{
+	std::unique_lock<std::mutex> lock(m_recordedstreams_lock);
+
+	auto found = m_recordedstreams.find(streamid);
+	return (found != m_recordedstreams.end()) ? found->second : nullptr;
+}
+
 //---------------------------------------------------------------------------
 // addon::handle_generalexception (private)
 //
@@ -856,6 +925,45 @@ void addon::log_warning_if(bool flag, _args&&... args) const
 	if(flag) log_message(ADDON_LOG::ADDON_LOG_WARNING, std::forward<_args>(args)...);
 }
 
+//---------------------------------------------------------------------------
+// addon::openlivestream (private)
+//
+// Attempts to open a live stream using the available stream sources
+//
+// Arguments:
+//
+//	settings	- Current addon settings
+//	dbhandle	- Active database connection to use
+//	channelid	- Channel identifier
+//	vchannel	- Virtual channel number
+
+std::unique_ptr<pvrstream> addon::openlivestream(struct settings const& settings, connectionpool::handle const& dbhandle, union channelid channelid, char const* vchannel)
+{
+	std::unique_ptr<pvrstream>		stream;			// Live stream instance
+
+	assert(vchannel != nullptr);
+	if((vchannel == nullptr) || (*vchannel == '\0')) throw std::invalid_argument("vchannel");
+
+	// Determine if the channel is only available via legacy tuner devices
+	bool legacy_only = is_channel_legacy_only(dbhandle, channelid);
+
+	// Determine if HTTP can be used from the storage engine and/or the tuner directly. Tuner HTTP can be used as a fallback
+	// for a failed storage stream or if use_direct_tuning is enabled and HTTP is the preferred protocol
+	bool use_storage_http = ((legacy_only == false) && (settings.use_direct_tuning == false));
+	bool use_tuner_http = ((legacy_only == false) && (use_storage_http || settings.direct_tuning_protocol == tuning_protocol::http));
+
+	// Attempt to create the stream from the storage engine via HTTP if available
+	if(use_storage_http) stream = openlivestream_storage_http(settings, dbhandle, channelid, vchannel);
+	
+	// Attempt to create the stream from the tuner via HTTP if available
+	if((!stream) && (use_tuner_http)) stream = openlivestream_tuner_http(settings, dbhandle, channelid, vchannel);
+	
+	// Attempt to create the stream from the tuner via RTP/UDP (always available)
+	if(!stream) stream = openlivestream_tuner_device(settings, dbhandle, channelid, vchannel);
+
+	return stream;
+}
+
 //---------------------------------------------------------------------------
 // addon::openlivestream_storage_http (private)
 //
@@ -863,11 +971,12 @@ void addon::log_warning_if(bool flag, _args&&... args) const
 //
 // Arguments:
 //
+//	settings	- Current addon settings
 //	dbhandle	- Active database connection to use
 //	channelid	- Channel identifier
 //	vchannel	- Virtual channel number
 
-std::unique_ptr<pvrstream> addon::openlivestream_storage_http(connectionpool::handle const& dbhandle, union channelid channelid, char const* vchannel) const
+std::unique_ptr<pvrstream> addon::openlivestream_storage_http(struct settings const& settings, connectionpool::handle const& dbhandle, union channelid channelid, char const* vchannel) const
 {
 	assert(vchannel != nullptr);
 	if((vchannel == nullptr) || (*vchannel == '\0')) throw std::invalid_argument("vchannel");
@@ -876,13 +985,38 @@ std::unique_ptr<pvrstream> addon::openlivestream_storage_http(connectionpool::ha
 	std::vector<std::string> streamurls = get_storage_stream_urls(dbhandle, channelid);
 	if(streamurls.size() == 0) { log_error(__func__, ": unable to generate storage engine stream url(s) for channel ", vchannel); return nullptr; }
 
+	// If the user wants the sources raced, start all of the storage engine URLs concurrently in order of preference and use
+	// the first one to deliver valid packets instead of waiting for each one to fail in sequence; the tuner sources each lock
+	// a tuner so they are not part of the race, they are only attempted by the caller if none of the storage URLs worked
+	if(settings.race_live_stream_sources) {
+
+		std::vector<streamrace::opener_t> openers;				// Candidate stream sources
+
+		for(auto const& streamurl : streamurls) openers.emplace_back([=]() -> std::unique_ptr<pvrstream> {
+
+			return httpstream::create(streamurl.c_str(), { settings.stream_prefetch, static_cast<size_t>(settings.stream_buffer_min_size), static_cast<size_t>(settings.stream_buffer_max_size), 0, nullptr, 0 });
+		});
+
+		std::unique_ptr<streamrace> race = streamrace::create(openers);
+		std::unique_ptr<pvrstream> stream = race->wait();
+
+		if(stream) log_info(__func__, ": streaming channel ", vchannel, " via first responding storage engine url of ", openers.size());
+		else log_error(__func__, ": unable to stream channel ", vchannel, " via any of the storage engine urls");
+
+		// Losing candidates may still be blocked opening their connections; let the reaper wait for them to finish rather
+		// than delaying the stream that won the race, the task scheduler can't be used as it may be paused while streaming
+		m_reaper->retire(std::move(race));
+
+		return stream;
+	}
+
 	// Attempt to create a stream using the URLs in the order provided, there is currently no way to choose priority here
 	for(auto const& streamurl : streamurls) {
 
 		try {
 
 			// Start the new HTTP stream using the parameters currently specified by the settings
-			std::unique_ptr<pvrstream> stream = httpstream::create(streamurl.c_str());
+			std::unique_ptr<pvrstream> stream = httpstream::create(streamurl.c_str(), { settings.stream_prefetch, static_cast<size_t>(settings.stream_buffer_min_size), static_cast<size_t>(settings.stream_buffer_max_size), 0, nullptr, 0 });
 			log_info(__func__, ": streaming channel ", vchannel, " via storage engine url ", streamurl.c_str());
 
 			return stream;
@@ -902,11 +1036,12 @@ std::unique_ptr<pvrstream> addon::openlivestream_storage_http(connectionpool::ha
 //
 // Arguments:
 //
+//	settings	- Current addon settings
 //	dbhandle	- Active database connection to use
 //	channelid	- Channel identifier
 //	vchannel	- Virtual channel number
 
-std::unique_ptr<pvrstream> addon::openlivestream_tuner_device(connectionpool::handle const& dbhandle, union channelid channelid, char const* vchannel) const
+std::unique_ptr<pvrstream> addon::openlivestream_tuner_device(struct settings const& settings, connectionpool::handle const& dbhandle, union channelid channelid, char const* vchannel) const
 {
 	std::vector<struct devicestream::tuner> tuners;				// vector<> of possible device tuners for the channel
 
@@ -920,7 +1055,7 @@ std::unique_ptr<pvrstream> addon::openlivestream_tuner_device(connectionpool::ha
 	try {
 
 		// Start the new RTP/UDP stream -- devicestream performs its own tuner selection based on the provided collection
-		std::unique_ptr<pvrstream> stream = devicestream::create(tuners);
+		std::unique_ptr<pvrstream> stream = devicestream::create(tuners, settings.stream_batch_receive);
 		log_info(__func__, ": streaming channel ", vchannel, " via tuner device rtp/udp broadcast");
 
 		return stream;
@@ -939,11 +1074,12 @@ std::unique_ptr<pvrstream> addon::openlivestream_tuner_device(connectionpool::ha
 //
 // Arguments:
 //
+//	settings	- Current addon settings
 //	dbhandle	- Active database connection to use
 //	channelid	- Channel identifier
 //	vchannel	- Virtual channel number
 
-std::unique_ptr<pvrstream> addon::openlivestream_tuner_http(connectionpool::handle const& dbhandle, union channelid channelid, char const* vchannel) const
+std::unique_ptr<pvrstream> addon::openlivestream_tuner_http(struct settings const& settings, connectionpool::handle const& dbhandle, union channelid channelid, char const* vchannel) const
 {
 	std::vector<std::string>		tuners;			// vector<> of possible device tuners for the channel
 
@@ -965,7 +1101,7 @@ std::unique_ptr<pvrstream> addon::openlivestream_tuner_http(connectionpool::hand
 	try {
 
 		// Start the new HTTP stream using the parameters currently specified by the settings
-		std::unique_ptr<pvrstream> stream = httpstream::create(streamurl.c_str());
+		std::unique_ptr<pvrstream> stream = httpstream::create(streamurl.c_str(), { settings.stream_prefetch, static_cast<size_t>(settings.stream_buffer_min_size), static_cast<size_t>(settings.stream_buffer_max_size), 0, nullptr, 0 });
 		log_info(__func__, ": streaming channel ", vchannel, " via tuner device url ", streamurl.c_str());
 
 		return stream;
@@ -977,6 +1113,67 @@ std::unique_ptr<pvrstream> addon::openlivestream_tuner_http(connectionpool::hand
 	return nullptr;
 }
 
+//---------------------------------------------------------------------------
+// addon::pretune_next_channel (private)
+//
+// Starts pretuning the channel most likely to be selected after the current one
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+//	settings	- Current addon settings
+//	dbhandle	- Active database connection to use
+//	channelid	- Channel identifier of the current live stream
+//	previous	- Channel identifier of the previous live stream
+
+void addon::pretune_next_channel(std::unique_lock<std::mutex> const& lock, struct settings const& settings, connectionpool::handle const& dbhandle, 
+	union channelid channelid, union channelid previous)
+{
+	std::vector<unsigned int>		channels;		// vector<> of available channel identifiers
+	char							vchannel[64];	// Virtual channel number
+
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	assert(!m_pretuner);
+
+	// Generate a sorted collection of the available channels, the channel identifier values sort
+	// in the same order as the virtual channel numbers (channel in the high bits, subchannel in the low)
+	enumerate_channelids(dbhandle, settings.show_drm_protected_channels, [&](union channelid const& item) -> void { channels.push_back(item.value); });
+	std::sort(channels.begin(), channels.end());
+
+	// The current channel has to be in the lineup and there has to be something else to switch to
+	auto current = std::lower_bound(channels.begin(), channels.end(), channelid.value);
+	if((current == channels.end()) || (*current != channelid.value) || (channels.size() < 2)) return;
+
+	size_t index = static_cast<size_t>(current - channels.begin());
+	union channelid up{}, down{};
+	up.value = channels[(index + 1) % channels.size()];
+	down.value = channels[(index + channels.size() - 1) % channels.size()];
+
+	// If the user is moving through the channels in order, assume they will continue in the same direction, 
+	// otherwise assume they will return to the previous channel.  With no history, assume channel up
+	union channelid next = up;
+	if(previous.value == down.value) next = up;
+	else if(previous.value == up.value) next = down;
+	else if(std::binary_search(channels.begin(), channels.end(), previous.value)) next = previous;
+
+	// Generate a string version of the channel number to represent the virtual channel number
+	if(next.parts.subchannel == 0) snprintf(vchannel, std::extent<decltype(vchannel)>::value, "%d", next.parts.channel);
+	else snprintf(vchannel, std::extent<decltype(vchannel)>::value, "%d.%d", next.parts.channel, next.parts.subchannel);
+
+	log_info(__func__, ": pretuning predicted next channel ", vchannel);
+
+	// The stream is opened on the pretuner's background thread with a dedicated database connection, the
+	// settings and virtual channel number are copied into the lambda since this function will have returned
+	std::string pretunechannel(vchannel);
+	m_pretuner = pretuner::create(next, [=]() -> std::unique_ptr<pvrstream> {
+
+		connectionpool::handle dbhandle(m_connpool);
+		return openlivestream(settings, dbhandle, next, pretunechannel.c_str());
+	});
+}
+
 //-----------------------------------------------------------------------------
 // addon::proxy_changed_task (private)
 //
@@ -1055,13 +1252,44 @@ void addon::proxy_changed_task(scalar_condition<bool> const& /*cancel*/)
 //	cancel		- Condition variable used to cancel the operation
 
 void addon::push_listings(scalar_condition<bool> const& cancel)
+{
+	return push_listings(cancel, 0, std::vector<struct listingid>());
+}
+
+//---------------------------------------------------------------------------
+// addon::push_listings (private)
+//
+// Pushes the changes to the guide listings to Kodi asynchronously
+//
+// Arguments:
+//
+//	cancel		- Condition variable used to cancel the operation
+//	since		- Only push listings discovered at or after this time
+//	removed		- Listings to be removed from the guide
+
+void addon::push_listings(scalar_condition<bool> const& cancel, time_t since, std::vector<struct listingid> const& removed)
 {
 	// Create a copy of the current addon settings structure
 	struct settings settings = copy_settings();
 
 	log_info(__func__, ": begin asynchronous electronic program guide update");
 
-	enumerate_listings(connectionpool::handle(m_connpool), settings.show_drm_protected_channels, m_epgmaxtime.load(),
+	// Remove any listings that are no longer available
+	for(auto const& listingid : removed) {
+
+		if(cancel.test(true) == true) break;
+
+		kodi::addon::PVREPGTag epgtag;				// PVREPGTag to be transferred to Kodi
+
+		epgtag.SetUniqueBroadcastId(listingid.broadcastid);
+		epgtag.SetUniqueChannelId(listingid.channelid);
+
+		EpgEventStateChange(epgtag, EPG_EVENT_STATE::EPG_EVENT_DELETED);
+	}
+
+	log_info_if(!removed.empty(), __func__, ": removed ", removed.size(), " listings from the electronic program guide");
+
+	enumerate_listings(connectionpool::handle(m_connpool), settings.show_drm_protected_channels, m_epgmaxtime.load(), since,
 		[&](struct listing const& item, bool& cancelenum) -> void {
 
 		kodi::addon::PVREPGTag epgtag;				// PVREPGTag to be transferred to Kodi
@@ -1174,6 +1402,68 @@ void addon::push_listings_task(scalar_condition<bool> const& cancel)
 	catch(std::exception& ex) { handle_stdexception(__func__, ex); } 	catch(...) { handle_generalexception(__func__); }
 }
 
+//---------------------------------------------------------------------------
+// addon::read_pvrstream (private)
+//
+// Reads data from the active stream directly into the provided buffer
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t addon::read_pvrstream(uint8_t* buffer, size_t count)
+{
+	size_t			available = 0;			// Number of bytes acquired from the stream
+
+	assert(m_pvrstream);
+
+	// Acquire the next contiguous region of data from the stream and copy it directly into the 
+	// destination buffer; this is the only copy made of the data between the stream and Kodi
+	uint8_t* data = m_pvrstream->acquire(count, &available);
+	if(available > 0) memcpy(buffer, data, available);
+
+	m_pvrstream->release(available);
+	return available;
+}
+
+//---------------------------------------------------------------------------
+// addon::release_pretuner_task (private)
+//
+// Scheduled task implementation to release a pretuned stream that was not claimed
+//
+// Arguments:
+//
+//	cancel		- Condition variable used to cancel the operation
+
+void addon::release_pretuner_task(scalar_condition<bool> const& /*cancel*/)
+{
+	std::unique_lock<std::mutex> lock(m_pretuner_lock);
+
+	if(m_pretuner) {
+
+		log_info(__func__, ": releasing unclaimed pretuned stream");
+		m_reaper->retire(std::move(m_pretuner));
+	}
+}
+
+//---------------------------------------------------------------------------
+// addon::release_recordedstream (private)
+//
+// Releases the stream id of a stream that failed to open
+//
+// Arguments:
+//
+//	streamid	- ID of the stream to release
+
+void addon::release_recordedstream(int64_t streamid)
+{
+	std::unique_lock<std::mutex> lock(m_recordedstreams_lock);
+
+	m_recordedstreams.erase(streamid);
+	if(m_pvrstreamid == streamid) m_pvrstreamid = 0;
+}
+
 //---------------------------------------------------------------------------
 // addon::select_http_tuner (private)
 //
@@ -1336,6 +1626,21 @@ void addon::startup_complete_task(scalar_condition<bool> const& /*cancel*/)
 	m_startup_complete.store(true);
 }
 
+//-----------------------------------------------------------------------------
+// addon::stream_temp_file (private)
+//
+// Generates a unique path for a temporary stream file in the user data folder; a stream
+// retired to the reaper may still be using its file while the next stream is opened
+//
+// Arguments:
+//
+//	name		- Base name of the temporary file
+
+std::string addon::stream_temp_file(char const* name)
+{
+	return UserPath() + "/" + name + "-" + std::to_string(++m_tempfile_serial) + ".tmp";
+}
+
 //-----------------------------------------------------------------------------
 // addon::update_devices_task (private)
 //
@@ -1488,8 +1793,9 @@ void addon::update_lineups_task(scalar_condition<bool> const& cancel)
 
 void addon::update_listings_task(bool force, bool checkchannels, scalar_condition<bool> const& cancel)
 {
-	time_t		lastdiscovery = 0;			// Timestamp indicating the last successful discovery
-	bool		changed = false;			// Flag if the discovery data changed
+	time_t							lastdiscovery = 0;			// Timestamp indicating the last successful discovery
+	bool							changed = false;			// Flag if the discovery data changed
+	std::vector<struct listingid>	removed;					// Listings removed by the discovery
 
 	// Create a copy of the current addon settings structure
 	struct settings settings = copy_settings();
@@ -1521,10 +1827,11 @@ void addon::update_listings_task(bool force, bool checkchannels, scalar_conditio
 
 	try {
 
-		// Update the backend XMLTV listing information (changed will always be true here)
+		// Update the backend XMLTV listing information; only the listings that were added, changed
+		// or removed since this function was called need to be pushed over to Kodi afterwards
 		if(cancel.test(true) == false) {
 
-			if(force) discover_listings(cancel, changed);
+			if(force) discover_listings(cancel, changed, removed);
 			else log_info(__func__, ": listing discovery skipped; data is less than 18 hours old");
 		}
 
@@ -1535,8 +1842,8 @@ void addon::update_listings_task(bool force, bool checkchannels, scalar_conditio
 			TriggerChannelUpdate();
 		}
 
-		// Push all of the updated listings in the database over to Kodi
-		if(changed && (cancel.test(true) == false)) push_listings(cancel);
+		// Push the updated listings in the database over to Kodi
+		if(changed && (cancel.test(true) == false)) push_listings(cancel, now, removed);
 	}
 
 	catch(std::exception& ex) { handle_stdexception(__func__, ex); } 
@@ -1638,6 +1945,25 @@ void addon::update_recordings_task(scalar_condition<bool> const& cancel)
 	else log_info(__func__, ": recording update task was cancelled");
 }
 
+//---------------------------------------------------------------------------
+// addon::update_stream_telemetry (private)
+//
+// Updates the most recently published stream telemetry
+//
+// Arguments:
+//
+//	serial		- Telemetry serial number of the publishing stream
+//	values		- Stream telemetry values
+
+void addon::update_stream_telemetry(unsigned int serial, pvrstream::telemetry_t const& values)
+{
+	std::unique_lock<std::mutex> lock(m_telemetry_lock);
+
+	// Retired streams publish their final telemetry from the reaper thread, possibly after
+	// another stream has been opened; ignore anything that isn't from the current stream
+	if(serial == m_telemetry_serial) m_telemetry = values;
+}
+
 //---------------------------------------------------------------------------
 // addon::wait_for_devices (private)
 //
@@ -1865,7 +2191,18 @@ ADDON_STATUS addon::Create(void)
 			m_settings.use_direct_tuning = kodi::addon::GetSettingBoolean("use_direct_tuning", false);
 			m_settings.direct_tuning_protocol = kodi::addon::GetSettingEnum("direct_tuning_protocol", tuning_protocol::http);
 			m_settings.direct_tuning_allow_drm = kodi::addon::GetSettingBoolean("direct_tuning_allow_drm", false);
+			m_settings.pretune_next_channel = kodi::addon::GetSettingBoolean("pretune_next_channel", false);
+			m_settings.race_live_stream_sources = kodi::addon::GetSettingBoolean("race_live_stream_sources", false);
 			m_settings.stream_read_chunk_size = kodi::addon::GetSettingInt("stream_read_chunk_size_v3", 0);							// Automatic
+			m_settings.stream_prefetch = kodi::addon::GetSettingBoolean("stream_prefetch", false);
+			m_settings.stream_batch_receive = kodi::addon::GetSettingBoolean("stream_batch_receive", false);
+			m_settings.stream_buffer_min_size = kodi::addon::GetSettingInt("stream_buffer_min_size", (1 MiB));
+			m_settings.stream_buffer_max_size = kodi::addon::GetSettingInt("stream_buffer_max_size", 0);
+			m_settings.stream_seek_cache_size = kodi::addon::GetSettingInt("stream_seek_cache_size", 0);
+			m_settings.stream_seek_cache_file_size = kodi::addon::GetSettingInt("stream_seek_cache_file_size", 0);
+			m_settings.stream_range_connections = kodi::addon::GetSettingInt("stream_range_connections", 1);
+			m_settings.stream_demuxing = kodi::addon::GetSettingBoolean("stream_demuxing", false);
+			m_settings.timeshift_buffer_size = kodi::addon::GetSettingInt("timeshift_buffer_size", 0);
 			m_settings.deviceauth_stale_after = kodi::addon::GetSettingInt("deviceauth_stale_after_v2", 72000);						// 20 hours
 
 			// Log the setting values; these are for diagnostic purposes just use the raw values
@@ -1889,11 +2226,13 @@ ADDON_STATUS addon::Create(void)
 			log_info(__func__, ": m_settings.generate_repeat_indicators         = ", m_settings.generate_repeat_indicators);
 			log_info(__func__, ": m_settings.pause_discovery_while_streaming    = ", m_settings.pause_discovery_while_streaming);
 			log_info(__func__, ": m_settings.prepend_channel_numbers            = ", m_settings.prepend_channel_numbers);
+			log_info(__func__, ": m_settings.pretune_next_channel               = ", m_settings.pretune_next_channel);
 			log_info(__func__, ": m_settings.proxy_server_address               = ", m_settings.proxy_server_address);
 #ifdef _DEBUG
 			log_info(__func__, ": m_settings.proxy_server_password              = ", m_settings.proxy_server_password);
 #endif
 			log_info(__func__, ": m_settings.proxy_server_username              = ", m_settings.proxy_server_username);
+			log_info(__func__, ": m_settings.race_live_stream_sources           = ", m_settings.race_live_stream_sources);
 			log_info(__func__, ": m_settings.radio_channel_mapping_file         = ", m_settings.radio_channel_mapping_file);
 			log_info(__func__, ": m_settings.recording_edl_cut_as_comskip       = ", m_settings.recording_edl_cut_as_comskip);
 			log_info(__func__, ": m_settings.recording_edl_end_padding          = ", m_settings.recording_edl_end_padding);
@@ -1903,7 +2242,16 @@ ADDON_STATUS addon::Create(void)
 			log_info(__func__, ": m_settings.recording_edl_folder_is_flat       = ", m_settings.recording_edl_folder_is_flat);
 			log_info(__func__, ": m_settings.recording_edl_start_padding        = ", m_settings.recording_edl_start_padding);
 			log_info(__func__, ": m_settings.show_drm_protected_channels        = ", m_settings.show_drm_protected_channels);
+			log_info(__func__, ": m_settings.stream_batch_receive               = ", m_settings.stream_batch_receive);
+			log_info(__func__, ": m_settings.stream_buffer_max_size             = ", m_settings.stream_buffer_max_size);
+			log_info(__func__, ": m_settings.stream_buffer_min_size             = ", m_settings.stream_buffer_min_size);
+			log_info(__func__, ": m_settings.stream_demuxing                    = ", m_settings.stream_demuxing);
+			log_info(__func__, ": m_settings.stream_prefetch                    = ", m_settings.stream_prefetch);
+			log_info(__func__, ": m_settings.stream_range_connections           = ", m_settings.stream_range_connections);
 			log_info(__func__, ": m_settings.stream_read_chunk_size             = ", m_settings.stream_read_chunk_size);
+			log_info(__func__, ": m_settings.stream_seek_cache_file_size        = ", m_settings.stream_seek_cache_file_size);
+			log_info(__func__, ": m_settings.stream_seek_cache_size             = ", m_settings.stream_seek_cache_size);
+			log_info(__func__, ": m_settings.timeshift_buffer_size              = ", m_settings.timeshift_buffer_size);
 			log_info(__func__, ": m_settings.use_actual_timer_times             = ", m_settings.use_actual_timer_times);
 			log_info(__func__, ": m_settings.use_airdate_as_recordingdate       = ", m_settings.use_airdate_as_recordingdate);
 			log_info(__func__, ": m_settings.use_backend_genre_strings          = ", m_settings.use_backend_genre_strings);
@@ -1919,6 +2267,7 @@ ADDON_STATUS addon::Create(void)
 			AddMenuHook(kodi::addon::PVRMenuhook(MENUHOOK_SETTING_SHOWDEVICENAMES, 30312, PVR_MENUHOOK_SETTING));
 			AddMenuHook(kodi::addon::PVRMenuhook(MENUHOOK_SETTING_SHOWRECENTERRORS, 30314, PVR_MENUHOOK_SETTING));
 			AddMenuHook(kodi::addon::PVRMenuhook(MENUHOOK_SETTING_GENERATEDISCOVERYDIAGNOSTICS, 30315, PVR_MENUHOOK_SETTING));
+			AddMenuHook(kodi::addon::PVRMenuhook(MENUHOOK_SETTING_SHOWSTREAMTELEMETRY, 30316, PVR_MENUHOOK_SETTING));
 			AddMenuHook(kodi::addon::PVRMenuhook(MENUHOOK_SETTING_TRIGGERDEVICEDISCOVERY, 30303, PVR_MENUHOOK_SETTING));
 			AddMenuHook(kodi::addon::PVRMenuhook(MENUHOOK_SETTING_TRIGGERLINEUPDISCOVERY, 30304, PVR_MENUHOOK_SETTING));
 			AddMenuHook(kodi::addon::PVRMenuhook(MENUHOOK_SETTING_TRIGGERLISTINGDISCOVERY, 30313, PVR_MENUHOOK_SETTING));
@@ -1955,9 +2304,12 @@ ADDON_STATUS addon::Create(void)
 				if(!proxy.empty()) log_info(__func__, ": discovery http proxy server set to ", proxy.c_str());
 			}
 
+			// Create the reaper used to destroy the closed streams in the background
+			m_reaper = streamreaper::create();
+
 			// Attempt to start the task scheduler
 			try { m_scheduler.start(); } 
-			catch(...) { m_connpool.reset(); throw; }
+			catch(...) { m_reaper.reset(); m_connpool.reset(); throw; }
 		}
 
 		catch(std::exception& ex) { handle_stdexception(__func__, ex); throw; } 
@@ -1989,9 +2341,16 @@ void addon::Destroy(void) noexcept
 		// Throw a message out to the Kodi log indicating that the add-on is being unloaded
 		log_info(__func__, ": ", VERSION_PRODUCTNAME_ANSI, " v", VERSION_VERSION3_ANSI, " unloading");
 
+		m_demuxer.reset();						// Destroy any active stream demuxer
+		m_pcrclock = nullptr;					// Release the active stream clock
+		m_psiprobe = nullptr;					// Release the active stream probe
+		m_streammeter = nullptr;				// Release the active stream meter
 		m_pvrstream.reset();					// Destroy any active stream instance
+		m_recordedstreams.clear();				// Destroy any additional recorded streams
 		m_scheduler.stop();						// Stop the task scheduler
 		m_scheduler.clear();					// Clear all tasks from the scheduler
+		m_pretuner.reset();						// Destroy any pretuned stream instance
+		m_reaper.reset();						// Destroy any retired stream instances
 
 		// Check for more than just the global connection pool reference during shutdown,
 		// there shouldn't still be any active callbacks running during ADDON_Destroy
@@ -2392,6 +2751,33 @@ ADDON_STATUS addon::SetSetting(std::string const& settingName, kodi::addon::CSet
 		}
 	}
 
+	// pretune_next_channel
+	//
+	else if(settingName == "pretune_next_channel") {
+
+		bool bvalue = settingValue.GetBoolean();
+		if(bvalue != m_settings.pretune_next_channel) {
+
+			m_settings.pretune_next_channel = bvalue;
+			log_info(__func__, ": setting pretune_next_channel changed to ", bvalue);
+
+			// If pretuning has been disabled, release any pretuned stream immediately
+			if(!bvalue) m_scheduler.add(RELEASE_PRETUNER_TASK, &addon::release_pretuner_task, this);
+		}
+	}
+
+	// race_live_stream_sources
+	//
+	else if(settingName == "race_live_stream_sources") {
+
+		bool bvalue = settingValue.GetBoolean();
+		if(bvalue != m_settings.race_live_stream_sources) {
+
+			m_settings.race_live_stream_sources = bvalue;
+			log_info(__func__, ": setting race_live_stream_sources changed to ", bvalue);
+		}
+	}
+
 	// stream_read_chunk_size
 	//
 	else if(settingName == "stream_read_chunk_size_v3") {
@@ -2401,10 +2787,121 @@ ADDON_STATUS addon::SetSetting(std::string const& settingName, kodi::addon::CSet
 
 			m_settings.stream_read_chunk_size = nvalue;
 			if(m_settings.stream_read_chunk_size == 0) log_info(__func__, ": setting stream_read_chunk_size changed to Automatic");
+			else if(m_settings.stream_read_chunk_size < 0) log_info(__func__, ": setting stream_read_chunk_size changed to Adaptive");
 			else log_info(__func__, ": setting stream_read_chunk_size changed to ", nvalue, " bytes");
 		}
 	}
 
+	// stream_prefetch
+	//
+	else if(settingName == "stream_prefetch") {
+
+		bool bvalue = settingValue.GetBoolean();
+		if(bvalue != m_settings.stream_prefetch) {
+
+			m_settings.stream_prefetch = bvalue;
+			log_info(__func__, ": setting stream_prefetch changed to ", bvalue);
+		}
+	}
+
+	// stream_batch_receive
+	//
+	else if(settingName == "stream_batch_receive") {
+
+		bool bvalue = settingValue.GetBoolean();
+		if(bvalue != m_settings.stream_batch_receive) {
+
+			m_settings.stream_batch_receive = bvalue;
+			log_info(__func__, ": setting stream_batch_receive changed to ", bvalue);
+		}
+	}
+
+	// stream_buffer_min_size
+	//
+	else if(settingName == "stream_buffer_min_size") {
+
+		int nvalue = settingValue.GetInt();
+		if(nvalue != m_settings.stream_buffer_min_size) {
+
+			m_settings.stream_buffer_min_size = nvalue;
+			log_info(__func__, ": setting stream_buffer_min_size changed to ", nvalue, " bytes");
+		}
+	}
+
+	// stream_buffer_max_size
+	//
+	else if(settingName == "stream_buffer_max_size") {
+
+		int nvalue = settingValue.GetInt();
+		if(nvalue != m_settings.stream_buffer_max_size) {
+
+			m_settings.stream_buffer_max_size = nvalue;
+			log_info(__func__, ": setting stream_buffer_max_size changed to ", nvalue, " bytes");
+		}
+	}
+
+	// stream_seek_cache_size
+	//
+	else if(settingName == "stream_seek_cache_size") {
+
+		int nvalue = settingValue.GetInt();
+		if(nvalue != m_settings.stream_seek_cache_size) {
+
+			m_settings.stream_seek_cache_size = nvalue;
+			log_info(__func__, ": setting stream_seek_cache_size changed to ", nvalue, " bytes");
+		}
+	}
+
+	// stream_seek_cache_file_size
+	//
+	else if(settingName == "stream_seek_cache_file_size") {
+
+		int nvalue = settingValue.GetInt();
+		if(nvalue != m_settings.stream_seek_cache_file_size) {
+
+			m_settings.stream_seek_cache_file_size = nvalue;
+			log_info(__func__, ": setting stream_seek_cache_file_size changed to ", nvalue, " bytes");
+		}
+	}
+
+	// stream_range_connections
+	//
+	else if(settingName == "stream_range_connections") {
+
+		int nvalue = settingValue.GetInt();
+		if(nvalue != m_settings.stream_range_connections) {
+
+			m_settings.stream_range_connections = nvalue;
+			log_info(__func__, ": setting stream_range_connections changed to ", nvalue);
+		}
+	}
+
+	// stream_demuxing
+	//
+	else if(settingName == "stream_demuxing") {
+
+		bool bvalue = settingValue.GetBoolean();
+		if(bvalue != m_settings.stream_demuxing) {
+
+			// Kodi only queries the addon capabilities when it's loaded, the addon has to be restarted
+			m_settings.stream_demuxing = bvalue;
+			log_info(__func__, ": setting stream_demuxing changed to ", bvalue, "; addon restart required");
+			return ADDON_STATUS::ADDON_STATUS_NEED_RESTART;
+		}
+	}
+
+	// timeshift_buffer_size
+	//
+	else if(settingName == "timeshift_buffer_size") {
+
+		int nvalue = settingValue.GetInt();
+		if(nvalue != m_settings.timeshift_buffer_size) {
+
+			m_settings.timeshift_buffer_size = nvalue;
+			log_info(__func__, ": setting timeshift_buffer_size changed to ", nvalue, " bytes");
+		}
+	}
+
 	// deviceauth_stale_after
 	//
 	else if(settingName == "deviceauth_stale_after_v2") {
@@ -2873,6 +3370,23 @@ PVR_ERROR addon::CallSettingsMenuHook(kodi::addon::PVRMenuhook const& menuhook)
 			kodi::gui::dialogs::TextViewer::Show("Recent error messages", errors);
 		}
 
+		// MENUHOOK_SETTING_SHOWSTREAMTELEMETRY
+		//
+		else if(menuhook.GetHookId() == MENUHOOK_SETTING_SHOWSTREAMTELEMETRY) {
+
+			std::string telemetry;		// Constructed string for the TextViewer dialog
+
+			// The telemetry is published by the active stream about once per second and retains the
+			// final values of the most recent stream after it has been closed
+			std::unique_lock<std::mutex> lock(m_telemetry_lock);
+			for(auto const& iterator : m_telemetry) telemetry.append(iterator.first + " = " + std::to_string(iterator.second) + "\r\n");
+			lock.unlock();
+
+			if(telemetry.empty()) telemetry.assign("No stream telemetry is available");
+
+			kodi::gui::dialogs::TextViewer::Show("Stream telemetry", telemetry);
+		}
+
 		// MENUHOOK_SETTING_GENERATEDISCOVERYDIAGNOSTICS
 		//
 		else if(menuhook.GetHookId() == MENUHOOK_SETTING_GENERATEDISCOVERYDIAGNOSTICS) {
@@ -2884,8 +3398,15 @@ PVR_ERROR addon::CallSettingsMenuHook(kodi::addon::PVRMenuhook const& menuhook)
 
 				try {
 
+					// Generate a JSON object from the most recent stream telemetry, if there is any
+					std::string telemetry;
+					std::unique_lock<std::mutex> lock(m_telemetry_lock);
+					for(auto const& iterator : m_telemetry) telemetry.append((telemetry.empty()) ? "{" : ",").append("\"" + iterator.first + "\":" + std::to_string(iterator.second));
+					if(!telemetry.empty()) telemetry.append("}");
+					lock.unlock();
+
 					// The database module handles this; just have to tell it where to write the file
-					generate_discovery_diagnostic_file(connectionpool::handle(m_connpool), folderpath.c_str());
+					generate_discovery_diagnostic_file(connectionpool::handle(m_connpool), folderpath.c_str(), (telemetry.empty()) ? nullptr : telemetry.c_str());
 
 					// Inform the user that the operation was successful
 					kodi::gui::dialogs::OK::ShowAndGetInput("Discovery Diagnostic Data", "The discovery diagnostic data was exported successfully");
@@ -2993,10 +3514,48 @@ void addon::CloseLiveStream(void)
 
 	try {
 		
-		m_pvrstream.reset();							// Close the active stream instance
+		m_demuxer.reset();								// Destroy any active stream demuxer
+		m_pcrclock = nullptr;							// Release the active stream clock
+		m_psiprobe = nullptr;							// Release the active stream probe
+
+		// Remember the rate at which a live channel was consumed, it's the best estimate of the bitrate to use for
+		// the adaptive read chunk size the next time that channel is streamed; only the most recent channels are kept
+		uint64_t bitrate = (m_streammeter) ? m_streammeter->bytespersecond() : 0;
+		if((m_streamchannelid.value != 0) && (bitrate > 0)) {
+
+			unsigned int const channel = m_streamchannelid.value;
+			m_channelbitrates.erase(std::remove_if(m_channelbitrates.begin(), m_channelbitrates.end(), 
+				[&](std::pair<unsigned int, long long> const& item) -> bool { return item.first == channel; }), m_channelbitrates.end());
+
+			m_channelbitrates.emplace_front(channel, static_cast<long long>(bitrate));
+			if(m_channelbitrates.size() > ADAPTIVE_CHUNK_CHANNEL_BITRATES) m_channelbitrates.pop_back();
+		}
+
+		m_streammeter = nullptr;						// Release the active stream meter
+		m_streambitrate = 0;							// Reset the stream bitrate estimate
+		m_streamchannelid.value = 0;					// Reset the live stream channel
+		m_reaper->retire(std::move(m_pvrstream));		// Destroy the active stream in the background
 		m_scheduler.resume();							// Resume task scheduler
 		m_stream_starttime = m_stream_endtime = 0;		// Reset stream time trackers
 
+		// The next stream to be opened can become the active PVR stream
+		std::unique_lock<std::mutex> streamslock(m_recordedstreams_lock);
+		m_pvrstreamid = 0;
+		streamslock.unlock();
+
+		// Log the most recently published telemetry of the stream for diagnostic purposes
+		std::string telemetry;
+		std::unique_lock<std::mutex> telemetrylock(m_telemetry_lock);
+		for(auto const& iterator : m_telemetry) telemetry.append((telemetry.empty()) ? "" : ", ").append(iterator.first + " = " + std::to_string(iterator.second));
+		telemetrylock.unlock();
+		log_info_if(!telemetry.empty(), __func__, ": stream telemetry: ", telemetry.c_str());
+
+		// Keep any pretuned stream around for a few seconds in case this is a channel change, 
+		// it will be claimed or released by OpenLiveStream if another stream is opened first
+		std::unique_lock<std::mutex> pretunerlock(m_pretuner_lock);
+		if(m_pretuner) m_scheduler.add(RELEASE_PRETUNER_TASK, std::chrono::system_clock::now() + std::chrono::seconds(10), &addon::release_pretuner_task, this);
+		pretunerlock.unlock();
+
 		// If the setting to refresh the recordings immediately after playback, reschedule it
 		// to execute in a few seconds; this prevents doing it multiple times when changing channels
 		if(copy_settings().discover_recordings_after_playback) {
@@ -3019,9 +3578,26 @@ void addon::CloseLiveStream(void)
 //
 //	streamid	- ID of the stream to close
 
-void addon::CloseRecordedStream(int64_t /*streamid*/)
+void addon::CloseRecordedStream(int64_t streamid)
 {
-	return CloseLiveStream();			// Identical implementation
+	std::unique_lock<std::mutex> lock(m_recordedstreams_lock);
+
+	auto found = m_recordedstreams.find(streamid);
+	if(found == m_recordedstreams.end()) return;
+
+	std::shared_ptr<struct recordedstream> recordedstream = found->second;
+	m_recordedstreams.erase(found);
+	lock.unlock();
+
+	// Wait for any operation in progress against the stream to complete before closing it
+	std::unique_lock<std::mutex> streamlock(recordedstream->lock);
+
+	// The active PVR stream is closed the same way as a live stream
+	if(recordedstream->primary) return CloseLiveStream();
+
+	m_reaper->retire(std::move(recordedstream->stream));
+
+	log_info(__func__, ": closed additional recorded stream ", streamid);
 }
 
 //-----------------------------------------------------------------------------
@@ -3111,6 +3687,114 @@ PVR_ERROR addon::DeleteTimer(kodi::addon::PVRTimer const& timer, bool /*forceDel
 	return PVR_ERROR::PVR_ERROR_NO_ERROR;	
 }
 
+//-----------------------------------------------------------------------------
+// addon::DemuxAbort (CInstancePVRClient)
+//
+// Stop reading data from the demultiplexer
+//
+// Arguments:
+//
+//	NONE
+
+void addon::DemuxAbort(void)
+{
+	std::unique_lock<std::mutex> lock(m_demuxer_lock);
+	if(m_demuxer) m_demuxer->reset();
+}
+
+//-----------------------------------------------------------------------------
+// addon::DemuxFlush (CInstancePVRClient)
+//
+// Flush all data that has been read from the demultiplexer
+//
+// Arguments:
+//
+//	NONE
+
+void addon::DemuxFlush(void)
+{
+	std::unique_lock<std::mutex> lock(m_demuxer_lock);
+	if(m_demuxer) m_demuxer->reset();
+}
+
+//-----------------------------------------------------------------------------
+// addon::DemuxRead (CInstancePVRClient)
+//
+// Read the next packet from the demultiplexer
+//
+// Arguments:
+//
+//	NONE
+
+DEMUX_PACKET* addon::DemuxRead(void)
+{
+	struct tsdemuxer::packet		packet;			// Elementary stream packet
+
+	// Kodi calls the other demultiplexer functions from a different thread than this one
+	std::unique_lock<std::mutex> lock(m_demuxer_lock);
+	if((!m_demuxer) || (!m_pvrstream)) return nullptr;
+
+	try {
+
+		if(!m_demuxer->read(packet)) {
+
+			// If a stream with a known length has been read to the end, there is nothing more to demultiplex;
+			// otherwise hand Kodi an empty packet so that it will try again
+			long long length = m_pvrstream->length();
+			if((!m_pvrstream->realtime()) && (length > 0) && (m_pvrstream->position() >= length)) return nullptr;
+
+			return AllocateDemuxPacket(0);
+		}
+
+		// A change to the stream layout is indicated with a special empty packet, this causes Kodi
+		// to call back into GetStreamProperties to get the updated stream layout
+		if(packet.streamchange) {
+
+			DEMUX_PACKET* streamchange = AllocateDemuxPacket(0);
+			if(streamchange != nullptr) streamchange->iStreamId = DMX_SPECIALID_STREAMCHANGE;
+
+			return streamchange;
+		}
+
+		DEMUX_PACKET* demuxpacket = AllocateDemuxPacket(static_cast<int>(packet.data.size()));
+		if(demuxpacket == nullptr) throw string_exception(__func__, ": unable to allocate demultiplexer packet of ", packet.data.size(), " bytes");
+
+		memcpy(demuxpacket->pData, packet.data.data(), packet.data.size());
+		demuxpacket->iSize = static_cast<int>(packet.data.size());
+		demuxpacket->iStreamId = packet.pid;
+		demuxpacket->pts = (packet.pts == tsdemuxer::NO_TIMESTAMP) ? STREAM_NOPTS_VALUE : static_cast<double>(packet.pts);
+		demuxpacket->dts = (packet.dts == tsdemuxer::NO_TIMESTAMP) ? STREAM_NOPTS_VALUE : static_cast<double>(packet.dts);
+
+		return demuxpacket;
+	}
+
+	catch(std::exception& ex) {
+
+		// Log the exception and alert the user of the failure with an error notification
+		log_error(__func__, ": demultiplexer read operation failed with exception: ", ex.what());
+		kodi::QueueFormattedNotification(QueueMsg::QUEUE_ERROR, "Unable to read from stream: %s", ex.what());
+
+		return nullptr;
+	}
+
+	catch(...) { return handle_generalexception(__func__, static_cast<DEMUX_PACKET*>(nullptr)); }
+}
+
+//-----------------------------------------------------------------------------
+// addon::DemuxReset (CInstancePVRClient)
+//
+// Reset the demultiplexer
+//
+// Arguments:
+//
+//	NONE
+
+void addon::DemuxReset(void)
+{
+	std::unique_lock<std::mutex> lock(m_demuxer_lock);
+	if(m_demuxer) m_demuxer->reset();
+}
+
 //-----------------------------------------------------------------------------
 // addon::GetBackendName (CInstancePVRClient)
 //
@@ -3161,11 +3845,12 @@ PVR_ERROR addon::GetCapabilities(kodi::addon::PVRCapabilities& capabilities)
 	capabilities.SetSupportsTimers(true);
 	capabilities.SetSupportsChannelGroups(true);
 	capabilities.SetHandlesInputStream(true);
+	capabilities.SetHandlesDemuxing(copy_settings().stream_demuxing);
 	capabilities.SetSupportsRecordingPlayCount(true);
 	capabilities.SetSupportsLastPlayedPosition(true);
 	capabilities.SetSupportsRecordingEdl(true);
 	capabilities.SetSupportsRecordingsDelete(true);
-	capabilities.SetSupportsMultipleRecordedStreams(false);	// <-- TODO: Look into this
+	capabilities.SetSupportsMultipleRecordedStreams(true);
 
 	return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
@@ -3966,6 +4651,55 @@ PVR_ERROR addon::GetSignalStatus(int channelUid, kodi::addon::PVRSignalStatus& s
 	return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
 
+//-----------------------------------------------------------------------------
+// addon::GetStreamProperties (CInstancePVRClient)
+//
+// Get the stream properties of the stream that's currently being read
+//
+// Arguments:
+//
+//	properties	- Stream properties to be described
+
+PVR_ERROR addon::GetStreamProperties(std::vector<kodi::addon::PVRStreamProperties>& properties)
+{
+	std::vector<mpegts::elementarystream>	streams;		// Elementary stream layout
+
+	if((!m_pvrstream) || (!m_psiprobe)) return PVR_ERROR::PVR_ERROR_NOT_IMPLEMENTED;
+
+	try {
+
+		// Probe the head of the stream for the program map table without consuming any of the data; if the
+		// layout can't be determined quickly let Kodi fall back to probing the stream itself
+		if(!m_psiprobe->probe(*m_pvrstream, streams)) {
+
+			log_info(__func__, ": unable to determine the stream layout from the program map table");
+			return PVR_ERROR::PVR_ERROR_NOT_IMPLEMENTED;
+		}
+
+		for(auto const& stream : streams) {
+
+			// Elementary streams with a codec that isn't known to Kodi cannot be described
+			if(stream.codec == nullptr) continue;
+
+			kodi::addon::PVRCodec codec = GetCodecByName(stream.codec);
+			if(codec.GetCodecType() == PVR_CODEC_TYPE::PVR_CODEC_TYPE_UNKNOWN) continue;
+
+			kodi::addon::PVRStreamProperties property;
+			property.SetPID(stream.pid);
+			property.SetCodecType(codec.GetCodecType());
+			property.SetCodecId(codec.GetCodecId());
+			if(!stream.language.empty()) property.SetLanguage(stream.language);
+
+			properties.emplace_back(std::move(property));
+		}
+	}
+
+	catch(std::exception& ex) { return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED); }
+	catch(...) { return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED); }
+
+	return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
 //-----------------------------------------------------------------------------
 // addon::GetStreamReadChunkSize (CInstancePVRClient)
 //
@@ -3981,6 +4715,22 @@ PVR_ERROR addon::GetStreamReadChunkSize(int& chunksize)
 	int stream_read_chunk_size = copy_settings().stream_read_chunk_size;
 	if(stream_read_chunk_size == 0) return PVR_ERROR_NOT_IMPLEMENTED;
 
+	// 'Adaptive' sizes the chunk from the active stream; Kodi asks for this whenever it (re)opens
+	// the stream demuxer, so the size follows the stream as it changes over the session
+	if(stream_read_chunk_size < 0) {
+
+		try { 
+			
+			chunksize = static_cast<int>(adaptive_chunk_size());
+			log_info(__func__, ": adaptive stream read chunk size = ", chunksize, " bytes");
+		}
+
+		catch(std::exception& ex) { return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED); }
+		catch(...) { return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED); }
+
+		return PVR_ERROR::PVR_ERROR_NO_ERROR;
+	}
+
 	chunksize = stream_read_chunk_size;
 	return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
@@ -4010,12 +4760,35 @@ PVR_ERROR addon::GetStreamTimes(kodi::addon::PVRStreamTimes& times)
 	times.SetStartTime((m_stream_endtime == std::numeric_limits<time_t>::max()) ? m_stream_starttime : 0);
 
 	times.SetPTSStart(0);						// Starting PTS gets set to zero
-	times.SetPTSBegin(0);						// Timeshift buffer start PTS also gets set to zero
 
 	// Set the timeshift duration to the delta between the start time and the lesser of the 
 	// current wall clock time or the known stream end time
 	time_t now = time(nullptr);
-	times.SetPTSEnd(static_cast<int64_t>(((now < m_stream_endtime) ? now : m_stream_endtime) - m_stream_starttime) * STREAM_TIME_BASE);
+	int64_t ptsend = static_cast<int64_t>(((now < m_stream_endtime) ? now : m_stream_endtime) - m_stream_starttime) * STREAM_TIME_BASE;
+
+	long long length = m_pvrstream->length();
+	long long minposition = m_pvrstream->minposition();
+
+	// If the length of the stream is known and the program clock reference of the stream has been established,
+	// use that instead of the recording metadata to determine the duration; the clock times are in microseconds
+	if((m_pcrclock) && (length > 0)) {
+
+		long long clockend = m_pcrclock->timeof(length);
+		if(clockend > 0) ptsend = static_cast<int64_t>((static_cast<double>(clockend) / 1000000) * STREAM_TIME_BASE);
+	}
+
+	times.SetPTSEnd(ptsend);
+
+	// If the beginning of the stream is no longer available (timeshift buffer), determine the starting PTS of the
+	// available data from the clock, or estimate it proportionally from the minimum seekable position
+	int64_t ptsbegin = ((length > 0) && (minposition > 0)) ? static_cast<int64_t>(ptsend * (static_cast<double>(minposition) / length)) : 0;
+	if((m_pcrclock) && (minposition > 0)) {
+
+		long long clockbegin = m_pcrclock->timeof(minposition);
+		if(clockbegin >= 0) ptsbegin = std::min(static_cast<int64_t>((static_cast<double>(clockbegin) / 1000000) * STREAM_TIME_BASE), ptsend);
+	}
+
+	times.SetPTSBegin(ptsbegin);
 
 	return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
@@ -4337,9 +5110,21 @@ int64_t addon::LengthLiveStream(void)
 //
 //	streamid	- ID of the stream to get the length for
 
-int64_t addon::LengthRecordedStream(int64_t /*streamid*/)
+int64_t addon::LengthRecordedStream(int64_t streamid)
 {
-	return LengthLiveStream();			// Identical implementation
+	try {
+
+		std::shared_ptr<struct recordedstream> recordedstream = find_recordedstream(streamid);
+		if(!recordedstream) return -1;
+
+		std::unique_lock<std::mutex> lock(recordedstream->lock);
+		if(recordedstream->primary) return LengthLiveStream();
+
+		return (recordedstream->stream) ? recordedstream->stream->length() : -1;
+	}
+
+	catch(std::exception& ex) { return handle_stdexception(__func__, ex, -1); }
+	catch(...) { return handle_generalexception(__func__, -1); }
 }
 
 //-----------------------------------------------------------------------------
@@ -4430,6 +5215,9 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
 {
 	char				vchannel[64];		// Virtual channel number
 
+	// Note the time the stream was requested for the stream telemetry
+	std::chrono::steady_clock::time_point opened = std::chrono::steady_clock::now();
+
 	// Create a copy of the current addon settings structure
 	struct settings settings = copy_settings();
 
@@ -4453,27 +5241,41 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
 	if(channelid.parts.subchannel == 0) snprintf(vchannel, std::extent<decltype(vchannel)>::value, "%d", channelid.parts.channel);
 	else snprintf(vchannel, std::extent<decltype(vchannel)>::value, "%d.%d", channelid.parts.channel, channelid.parts.subchannel);
 
+	// Claim the active PVR stream so that any recorded streams opened in the meantime are opened as additional streams;
+	// it's released when the live stream is closed, or below if the stream could not be created
+	std::unique_lock<std::mutex> streamslock(m_recordedstreams_lock);
+	int64_t id = m_pvrstreamid = m_nextstreamid++;
+	streamslock.unlock();
+
 	try {
 
 		// Pull a database connection out from the connection pool
 		connectionpool::handle dbhandle(m_connpool);
 
-		// Determine if the channel is only available via legacy tuner devices
-		bool legacy_only = is_channel_legacy_only(dbhandle, channelid);
+		// If the requested channel has been pretuned, claim that stream instead of opening a new one.  Any
+		// other pretuned stream, or one that is still being opened, is handed to the reaper before opening the
+		// new stream so that its tuner becomes available without blocking this thread while it's released
+		std::unique_lock<std::mutex> pretunerlock(m_pretuner_lock);
+		m_scheduler.remove(RELEASE_PRETUNER_TASK);
 
-		// Determine if HTTP can be used from the storage engine and/or the tuner directly. Tuner HTTP can be used as a fallback
-		// for a failed storage stream or if use_direct_tuning is enabled and HTTP is the preferred protocol
-		bool use_storage_http = ((legacy_only == false) && (settings.use_direct_tuning == false));
-		bool use_tuner_http = ((legacy_only == false) && (use_storage_http || settings.direct_tuning_protocol == tuning_protocol::http));
+		if((m_pretuner) && (m_pretuner->channel().value == channelid.value)) {
 
-		// Attempt to create the stream from the storage engine via HTTP if available
-		if(use_storage_http) m_pvrstream = openlivestream_storage_http(dbhandle, channelid, vchannel);
-		
-		// Attempt to create the stream from the tuner via HTTP if available
-		if((!m_pvrstream) && (use_tuner_http)) m_pvrstream = openlivestream_tuner_http(dbhandle, channelid, vchannel);
-		
-		// Attempt to create the stream from the tuner via RTP/UDP (always available)
-		if(!m_pvrstream) m_pvrstream = openlivestream_tuner_device(dbhandle, channelid, vchannel);
+			m_pvrstream = m_pretuner->claim();
+			log_info_if(static_cast<bool>(m_pvrstream), __func__, ": streaming channel ", vchannel, " via pretuned stream");
+		}
+
+		m_reaper->retire(std::move(m_pretuner));
+
+		// Attempt to create the stream using the available stream sources
+		if(!m_pvrstream) m_pvrstream = openlivestream(settings, dbhandle, channelid, vchannel);
+
+		// A previously closed stream may still be releasing its tuner in the background; if any retired
+		// streams had to be waited on, the stream sources are worth trying again before giving up
+		if((!m_pvrstream) && (m_reaper->wait())) {
+
+			log_info(__func__, ": retrying channel ", vchannel, " after waiting for closed stream(s) to be released");
+			m_pvrstream = openlivestream(settings, dbhandle, channelid, vchannel);
+		}
 
 		// If none of the above methods generated a valid stream, there is nothing left to try
 		if(!m_pvrstream) throw string_exception(__func__, ": unable to create a valid stream instance for channel ", vchannel);
@@ -4482,9 +5284,48 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
 		if(channel.GetIsRadio() && m_settings.enable_radio_channel_mapping && m_settings.block_radio_channel_video_streams) {
 
 			log_info(__func__, ": channel is marked as radio, applying MPEG-TS video stream filter");
-			m_pvrstream = radiofilter::create(std::move(m_pvrstream));
+			m_pvrstream = radiofilter::create(tsaligner::create(std::move(m_pvrstream)));
+		}
+
+		// Parse the program specific information of the stream to describe the stream layout
+		std::unique_ptr<psiprobe> probe = psiprobe::create(std::move(m_pvrstream));
+		m_psiprobe = probe.get();
+		m_pvrstream = std::move(probe);
+
+		// Track the program clock reference of the stream to determine the stream times; this is
+		// applied before any timeshift buffer so that the clock sees all of the live stream data
+		std::unique_ptr<pcrclock> clock = pcrclock::create(std::move(m_pvrstream));
+		m_pcrclock = clock.get();
+		m_pvrstream = std::move(clock);
+
+		// If the stream cannot be seeked, check to see if the user wants it spooled into a timeshift buffer
+		if((!m_pvrstream->canseek()) && (settings.timeshift_buffer_size > 0)) {
+
+			std::string timeshiftfile = stream_temp_file("timeshift");
+			log_info(__func__, ": stream cannot be seeked, applying ", settings.timeshift_buffer_size, " byte timeshift buffer ", timeshiftfile.c_str());
+			m_pvrstream = timeshiftbuffer::create(std::move(m_pvrstream), timeshiftfile.c_str(), static_cast<size_t>(settings.timeshift_buffer_size));
 		}
 
+		// Measure how the stream is consumed and collect the telemetry from all of the stream layers
+		std::unique_lock<std::mutex> telemetrylock(m_telemetry_lock);
+		m_telemetry.clear();
+		unsigned int serial = ++m_telemetry_serial;
+		telemetrylock.unlock();
+		std::unique_ptr<streammeter> meter = streammeter::create(std::move(m_pvrstream), opened, std::bind(&addon::update_stream_telemetry, this, serial, std::placeholders::_1));
+		m_streammeter = meter.get();
+		m_pvrstream = std::move(meter);
+
+		// Estimate the bitrate of the stream for the adaptive read chunk size; use the rate measured the last time the channel
+		// was streamed if there is one, otherwise assume the ATSC maximum for television and the minimum chunk size for radio
+		auto const measured = std::find_if(m_channelbitrates.begin(), m_channelbitrates.end(), 
+			[&](std::pair<unsigned int, long long> const& item) -> bool { return item.first == channelid.value; });
+		if(measured != m_channelbitrates.end()) m_streambitrate = measured->second;
+		else m_streambitrate = (channel.GetIsRadio()) ? 0 : ADAPTIVE_CHUNK_LIVE_BITRATE;
+		m_streamchannelid = channelid;
+
+		// Demultiplex the stream in the addon rather than letting Kodi do it, if the user wants that functionality
+		if(settings.stream_demuxing) m_demuxer = tsdemuxer::create(*m_pvrstream);
+
 		// Pause the scheduler if the user wants that functionality disabled during streaming
 		if(settings.pause_discovery_while_streaming) m_scheduler.pause();
 
@@ -4502,7 +5343,18 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
 			log_info(__func__, ": starttime = ", m_stream_starttime, " (epoch) = ", strtok(asctime(localtime(&m_stream_starttime)), "\n"), " (local)");
 		}
 
-		catch(...) { m_pvrstream.reset(); m_scheduler.resume(); throw; }
+		catch(...) { m_demuxer.reset(); m_pcrclock = nullptr; m_psiprobe = nullptr; m_streammeter = nullptr; m_pvrstream.reset(); m_scheduler.resume(); throw; }
+
+		// Keep a spare tuner warm on the predicted next channel if the user wants that functionality; failure
+		// to pretune is not fatal, the next channel change will just have to open the stream normally
+		union channelid previous = m_lastchannelid;
+		m_lastchannelid = channelid;
+
+		if(settings.pretune_next_channel) {
+
+			try { pretune_next_channel(pretunerlock, settings, dbhandle, channelid, previous); }
+			catch(std::exception& ex) { log_error(__func__, ": unable to pretune the predicted next channel: ", ex.what()); }
+		}
 
 		return true;
 	}
@@ -4510,11 +5362,12 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
 	// Queue a notification for the user when a live stream cannot be opened, don't just silently log it
 	catch(std::exception& ex) { 
 		
+		if(!m_pvrstream) release_recordedstream(id);
 		kodi::QueueFormattedNotification(QueueMsg::QUEUE_ERROR, "Live Stream creation failed (%s).", ex.what());
 		return handle_stdexception(__func__, ex, false); 
 	}
 
-	catch(...) { return handle_generalexception(__func__, false); }
+	catch(...) { if(!m_pvrstream) release_recordedstream(id); return handle_generalexception(__func__, false); }
 }
 
 //-----------------------------------------------------------------------------
@@ -4527,11 +5380,32 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
 //	recording	- Recording stream to be opened
 //  streamid	- ID for the opened stream
 
-bool addon::OpenRecordedStream(kodi::addon::PVRRecording const& recording, int64_t& /*streamid*/)
+bool addon::OpenRecordedStream(kodi::addon::PVRRecording const& recording, int64_t& streamid)
 {
+	// Note the time the stream was requested for the stream telemetry
+	std::chrono::steady_clock::time_point opened = std::chrono::steady_clock::now();
+
 	// Create a copy of the current addon settings structure
 	struct settings settings = copy_settings();
 
+	// Kodi may open more than one recorded stream at a time for previews, thumbnail extraction and so on. Only
+	// a stream opened while no other stream is active becomes the active PVR stream that the stream-level functions
+	// like GetStreamTimes() operate against, any others are opened as additional streams. All of them are tracked
+	// by stream id so that the operations against each one are serialized by the lock of that stream
+	std::shared_ptr<struct recordedstream> recordedstream = std::make_shared<struct recordedstream>();
+
+	std::unique_lock<std::mutex> streamslock(m_recordedstreams_lock);
+	int64_t id = m_nextstreamid++;
+	bool additional = (m_pvrstreamid != 0);
+	if(!additional) {
+
+		// Claim the active PVR stream while the lock is held; it's released when the stream is closed or fails to open
+		recordedstream->primary = true;
+		m_recordedstreams.emplace(id, recordedstream);
+		m_pvrstreamid = id;
+	}
+	streamslock.unlock();
+
 	try {
 
 		// Pull a database connection out from the connection pool
@@ -4541,6 +5415,23 @@ bool addon::OpenRecordedStream(kodi::addon::PVRRecording const& recording, int64
 		std::string streamurl = get_recording_stream_url(dbhandle, recording.GetRecordingId().c_str());
 		if(streamurl.length() == 0) throw string_exception(__func__, ": unable to determine the URL for specified recording");
 
+		// Additional recorded streams are standalone HTTP streams; the seek cache, telemetry and everything
+		// else layered on top of the stream are reserved for the active PVR stream
+		if(additional) {
+
+			log_info(__func__, ": streaming recording '", recording.GetTitle().c_str(), "' via url ", streamurl.c_str(), " as additional stream ", id);
+
+			recordedstream->stream = httpstream::create(streamurl.c_str(), { settings.stream_prefetch, static_cast<size_t>(settings.stream_buffer_min_size), 
+				static_cast<size_t>(settings.stream_buffer_max_size), 0, nullptr, 0 });
+
+			streamslock.lock();
+			m_recordedstreams.emplace(id, std::move(recordedstream));
+			streamslock.unlock();
+
+			streamid = id;
+			return true;
+		}
+
 		// Pause the scheduler if the user wants that functionality disabled during streaming
 		if(settings.pause_discovery_while_streaming) m_scheduler.pause();
 
@@ -4548,16 +5439,63 @@ bool addon::OpenRecordedStream(kodi::addon::PVRRecording const& recording, int64
 
 			// Start the new recording stream using the tuning parameters currently specified by the settings
 			log_info(__func__, ": streaming recording '", recording.GetTitle().c_str(), "' via url ", streamurl.c_str());
-			m_pvrstream = httpstream::create(streamurl.c_str());
+
+			// If multiple connections have been allowed, attempt to read ahead by transferring ranges of the
+			// recording in parallel.  This requires the length of the recording to be known, so it will fail
+			// for a recording that is still in progress; fall back to a standard HTTP stream in that case
+			std::unique_ptr<pvrstream> stream;
+			if(settings.stream_range_connections > 1) {
+
+				try { stream = rangestream::create(streamurl.c_str(), static_cast<size_t>(settings.stream_range_connections)); }
+				catch(std::exception& ex) { log_info(__func__, ": unable to transfer recording over multiple connections: ", ex.what()); }
+			}
+
+			if(!stream) {
+
+				std::string seekcachefile = stream_temp_file("seekcache");
+				stream = httpstream::create(streamurl.c_str(), { settings.stream_prefetch, static_cast<size_t>(settings.stream_buffer_min_size), static_cast<size_t>(settings.stream_buffer_max_size),
+					static_cast<size_t>(settings.stream_seek_cache_size), seekcachefile.c_str(), static_cast<size_t>(settings.stream_seek_cache_file_size) });
+			}
+
+			m_pvrstream = std::move(stream);
 
 			// If this is a radio channel, check to see if the user wants to remove the video stream(s)
 			if(recording.GetChannelType() == PVR_RECORDING_CHANNEL_TYPE::PVR_RECORDING_CHANNEL_TYPE_RADIO && 
 				m_settings.enable_radio_channel_mapping && m_settings.block_radio_channel_video_streams) {
 
 				log_info(__func__, ": channel is marked as radio, applying MPEG-TS video stream filter");
-				m_pvrstream = radiofilter::create(std::move(m_pvrstream));
+				m_pvrstream = radiofilter::create(tsaligner::create(std::move(m_pvrstream)));
 			}
 
+			// Parse the program specific information of the stream to describe the stream layout
+			std::unique_ptr<psiprobe> probe = psiprobe::create(std::move(m_pvrstream));
+			m_psiprobe = probe.get();
+			m_pvrstream = std::move(probe);
+
+			// Track the program clock reference of the stream to determine the stream times
+			std::unique_ptr<pcrclock> clock = pcrclock::create(std::move(m_pvrstream));
+			m_pcrclock = clock.get();
+			m_pvrstream = std::move(clock);
+
+			// Measure how the stream is consumed and collect the telemetry from all of the stream layers
+			std::unique_lock<std::mutex> telemetrylock(m_telemetry_lock);
+			m_telemetry.clear();
+			unsigned int serial = ++m_telemetry_serial;
+			telemetrylock.unlock();
+			std::unique_ptr<streammeter> meter = streammeter::create(std::move(m_pvrstream), opened, std::bind(&addon::update_stream_telemetry, this, serial, std::placeholders::_1));
+			m_streammeter = meter.get();
+			m_pvrstream = std::move(meter);
+
+			// Estimate the bitrate of the stream for the adaptive read chunk size from the size and duration of the recording,
+			// a recording that is still in progress doesn't have a final size so assume the ATSC maximum for those
+			long long length = m_pvrstream->length();
+			bool complete = ((!m_pvrstream->realtime()) && (length > 0) && (recording.GetDuration() > 0));
+			m_streambitrate = (complete) ? (length / recording.GetDuration()) : ADAPTIVE_CHUNK_LIVE_BITRATE;
+			m_streamchannelid.value = 0;
+
+			// Demultiplex the stream in the addon rather than letting Kodi do it, if the user wants that functionality
+			if(settings.stream_demuxing) m_demuxer = tsdemuxer::create(*m_pvrstream);
+
 			// For recorded streams, set the start and end times based on the recording metadata. Don't use the
 			// start time value in PVR_RECORDING; that may have been altered for display purposes
 			m_stream_starttime = get_recording_time(dbhandle, recording.GetRecordingId().c_str());
@@ -4572,17 +5510,20 @@ bool addon::OpenRecordedStream(kodi::addon::PVRRecording const& recording, int64
 			log_info(__func__, ": endtime   = ", m_stream_endtime, " (epoch) = ", strtok(asctime(localtime(&m_stream_endtime)), "\n"), " (local)");
 		}
 
-		catch(...) { m_pvrstream.reset(); m_scheduler.resume(); throw; }
+		catch(...) { m_demuxer.reset(); m_pcrclock = nullptr; m_psiprobe = nullptr; m_streammeter = nullptr; m_pvrstream.reset(); m_scheduler.resume(); throw; }
+
+		streamid = id;
 	}
 
 	// Queue a notification for the user when a recorded stream cannot be opened, don't just silently log it
 	catch(std::exception& ex) { 
 		
+		if(!additional) release_recordedstream(id);
 		kodi::QueueFormattedNotification(QueueMsg::QUEUE_ERROR, "Recorded Stream creation failed (%s).", ex.what());
 		return handle_stdexception(__func__, ex, false); 
 	}
 
-	catch(...) { return handle_generalexception(__func__, false); }
+	catch(...) { if(!additional) release_recordedstream(id); return handle_generalexception(__func__, false); }
 
 	return true;
 }
@@ -4602,7 +5543,7 @@ int addon::ReadLiveStream(unsigned char* buffer, unsigned int size)
 	try { 
 	
 		// Attempt to read the requested number of bytes from the stream
-		int result = (m_pvrstream) ? static_cast<int>(m_pvrstream->read(buffer, size)) : -1;
+		int result = (m_pvrstream) ? static_cast<int>(read_pvrstream(buffer, size)) : -1;
 
 		// Live streams should always return data, log an error on any zero-length read
 		if(result == 0) log_error(__func__, ": zero-length read on stream at position ", m_pvrstream->position());
@@ -4636,12 +5577,26 @@ int addon::ReadLiveStream(unsigned char* buffer, unsigned int size)
 //	buffer		- The buffer to store the data in
 //	size		- The number of bytes to read into the buffer
 
-int addon::ReadRecordedStream(int64_t /*streamid*/, unsigned char* buffer, unsigned int size)
+int addon::ReadRecordedStream(int64_t streamid, unsigned char* buffer, unsigned int size)
 {
+	std::shared_ptr<struct recordedstream> recordedstream = find_recordedstream(streamid);
+	if(!recordedstream) return -1;
+
+	// Operations against each recorded stream, including the active PVR stream, are serialized by its own lock
+	std::unique_lock<std::mutex> lock(recordedstream->lock);
+
+	// Additional recorded streams are read directly
+	if(!recordedstream->primary) {
+
+		try { return (recordedstream->stream) ? static_cast<int>(recordedstream->stream->read(buffer, size)) : -1; }
+		catch(std::exception& ex) { return handle_stdexception(__func__, ex, -1); }
+		catch(...) { return handle_generalexception(__func__, -1); }
+	}
+
 	try { 
 	
 		// Attempt to read the requested number of bytes from the stream
-		int result = (m_pvrstream) ? static_cast<int>(m_pvrstream->read(buffer, size)) : -1;
+		int result = (m_pvrstream) ? static_cast<int>(read_pvrstream(buffer, size)) : -1;
 
 		// Recorded streams may be real-time if they were in progress when started, but it
 		// is still normal for them to end at some point and return no data.  If no data was 
@@ -4709,8 +5664,22 @@ int64_t addon::SeekLiveStream(int64_t position, int whence)
 //	position	- Delta within the stream to seek, relative to whence
 //	whence		- Starting position from which to apply the delta
 
-int64_t addon::SeekRecordedStream(int64_t /*streamid*/, int64_t position, int whence)
+int64_t addon::SeekRecordedStream(int64_t streamid, int64_t position, int whence)
 {
+	std::shared_ptr<struct recordedstream> recordedstream = find_recordedstream(streamid);
+	if(!recordedstream) return -1;
+
+	// Operations against each recorded stream, including the active PVR stream, are serialized by its own lock
+	std::unique_lock<std::mutex> lock(recordedstream->lock);
+
+	// Additional recorded streams are seeked directly
+	if(!recordedstream->primary) {
+
+		try { return (recordedstream->stream) ? recordedstream->stream->seek(position, whence) : -1; }
+		catch(std::exception& ex) { return handle_stdexception(__func__, ex, -1); }
+		catch(...) { return handle_generalexception(__func__, -1); }
+	}
+
 	try { return (m_pvrstream) ? m_pvrstream->seek(position, whence) : -1; }
 
 	catch(std::exception& ex) {
@@ -4725,6 +5694,68 @@ int64_t addon::SeekRecordedStream(int64_t /*streamid*/, int64_t position, int wh
 	catch(...) { return handle_generalexception(__func__, -1); }
 }
 
+//-----------------------------------------------------------------------------
+// addon::SeekTime (CInstancePVRClient)
+//
+// Seek the demultiplexed stream to a specific time
+//
+// Arguments:
+//
+//	time		- Time to seek to, in milliseconds
+//	backwards	- Flag indicating the seek direction
+//	startpts	- Set to the presentation timestamp at the new position
+
+bool addon::SeekTime(double time, bool /*backwards*/, double& startpts)
+{
+	std::unique_lock<std::mutex> lock(m_demuxer_lock);
+	if((!m_demuxer) || (!m_pvrstream) || (!m_pvrstream->canseek())) return false;
+
+	try {
+
+		long long length = m_pvrstream->length();
+		if(length <= 0) return false;
+
+		// Use the program clock reference of the stream to determine the duration if it has been established, 
+		// otherwise fall back to the wall clock time elapsed since the start of the stream; the clock times
+		// and the demultiplexer timestamps are both in microseconds
+		long long duration = (m_pcrclock) ? m_pcrclock->timeof(length) : -1;
+		if(duration <= 0) {
+
+			time_t now = time(nullptr);
+			duration = static_cast<long long>(((now < m_stream_endtime) ? now : m_stream_endtime) - m_stream_starttime) * 1000000;
+		}
+
+		if(duration <= 0) return false;
+
+		// Locate the requested time with the program clock reference samples if possible, otherwise estimate
+		// the position proportionally; align it to a packet boundary, the demultiplexer will resynchronize
+		// on the next PES packet that starts after the new position
+		long long target = std::min(std::max(static_cast<long long>(time * 1000), 0LL), duration);
+		long long position = (m_pcrclock) ? m_pcrclock->positionof(target) : -1;
+		if(position < 0) position = static_cast<long long>(length * (static_cast<double>(target) / duration));
+
+		position = std::min(position, length);
+		position = std::max(position - (position % static_cast<long long>(mpegts::PACKET_LENGTH)), m_pvrstream->minposition());
+
+		if(m_pvrstream->seek(position, SEEK_SET) < 0) return false;
+		m_demuxer->reset();
+
+		startpts = static_cast<double>(target);
+		return true;
+	}
+
+	catch(std::exception& ex) {
+
+		// Log the exception and alert the user of the failure with an error notification
+		log_error(__func__, ": seek operation failed with exception: ", ex.what());
+		kodi::QueueFormattedNotification(QueueMsg::QUEUE_ERROR, "Unable to seek stream: %s", ex.what());
+
+		return false;
+	}
+
+	catch(...) { return handle_generalexception(__func__, false); }
+}
+
 //-----------------------------------------------------------------------------
 // addon::SetEPGMaxFutureDays (CInstancePVRClient)
 //
@@ -24,19 +24,28 @@
 #define __ADDON_H_
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <kodi/addon-instance/PVR.h>
+#include <map>
 #include <mutex>
 #include <random>
 #include <string>
 #include <vector>
 
 #include "database.h"
+#include "pcrclock.h"
+#include "pretuner.h"
+#include "psiprobe.h"
 #include "pvrstream.h"
 #include "pvrtypes.h"
 #include "scalar_condition.h"
 #include "scheduler.h"
+#include "streammeter.h"
+#include "streamrace.h"
+#include "streamreaper.h"
+#include "tsdemuxer.h"
 
 #pragma warning(push, 4)
 
@@ -124,6 +133,26 @@ public:
 	//
 	// Delete a timer on the backend
 	PVR_ERROR DeleteTimer(kodi::addon::PVRTimer const& timer, bool forceDelete) override;
+
+	// DemuxAbort
+	//
+	// Stop reading data from the demultiplexer
+	void DemuxAbort(void) override;
+
+	// DemuxFlush
+	//
+	// Flush all data that has been read from the demultiplexer
+	void DemuxFlush(void) override;
+
+	// DemuxRead
+	//
+	// Read the next packet from the demultiplexer
+	DEMUX_PACKET* DemuxRead(void) override;
+
+	// DemuxReset
+	//
+	// Reset the demultiplexer
+	void DemuxReset(void) override;
 		
 	// GetBackendName
 	//
@@ -215,6 +244,11 @@ public:
 	// Get the signal status of the stream that's currently open
 	PVR_ERROR GetSignalStatus(int channelUid, kodi::addon::PVRSignalStatus& signalStatus) override;
 
+	// GetStreamProperties
+	//
+	// Get the stream properties of the stream that's currently being read
+	PVR_ERROR GetStreamProperties(std::vector<kodi::addon::PVRStreamProperties>& properties) override;
+
 	// GetStreamReadChunkSize
 	//
 	// Obtain the chunk size to use when reading streams
@@ -300,6 +334,11 @@ public:
 	// Seek in a recorded stream
 	int64_t SeekRecordedStream(int64_t streamid, int64_t position, int whence) override;
 
+	// SeekTime
+	//
+	// Seek the demultiplexed stream to a specific time
+	bool SeekTime(double time, bool backwards, double& startpts) override;
+
 	// SetEPGMaxFutureDays
 	//
 	// Tell the client the future time frame to use when notifying epg events back to Kodi
@@ -343,6 +382,21 @@ private:
 	// Defines a vector<> used to collect ranges of channel identifiers
 	using channelranges_t = std::vector<channelrange_t>;
 
+	// recordedstream
+	//
+	// Structure used to track an open recorded stream
+	struct recordedstream {
+
+		std::mutex						lock;				// Synchronization object
+		bool							primary = false;	// Flag if this is the active PVR stream
+		std::unique_ptr<pvrstream>		stream;				// Additional recorded stream instance
+	};
+
+	// recordedstreams_t
+	//
+	// Defines a map<> of open recorded streams keyed by stream id
+	using recordedstreams_t = std::map<int64_t, std::shared_ptr<struct recordedstream>>;
+
 	//-------------------------------------------------------------------------
 	// Private Member Functions
 
@@ -356,11 +410,12 @@ private:
 	void discover_devices(scalar_condition<bool> const& cancel, bool& changed);
 	void discover_episodes(scalar_condition<bool> const& cancel, bool& changed);
 	void discover_lineups(scalar_condition<bool> const& cancel, bool& changed);
-	void discover_listings(scalar_condition<bool> const& cancel, bool& changed);
+	void discover_listings(scalar_condition<bool> const& cancel, bool& changed, std::vector<struct listingid>& removed);
 	void discover_mappings(scalar_condition<bool> const& cancel, bool& changed);
 	void discover_recordingrules(scalar_condition<bool> const& cancel, bool& changed);
 	void discover_recordings(scalar_condition<bool> const& cancel, bool& changed);
 	void push_listings(scalar_condition<bool> const& cancel);
+	void push_listings(scalar_condition<bool> const& cancel, time_t since, std::vector<struct listingid> const& removed);
 	void start_discovery(void) noexcept;
 	void wait_for_devices(void) noexcept;
 	void wait_for_channels(void) noexcept;
@@ -399,6 +454,7 @@ private:
 	//
 	void proxy_changed_task(scalar_condition<bool> const& cancel);
 	void push_listings_task(scalar_condition<bool> const& cancel);
+	void release_pretuner_task(scalar_condition<bool> const& cancel);
 	void startup_alerts_task(scalar_condition<bool> const& cancel);
 	void startup_complete_task(scalar_condition<bool> const& cancel);
 	void update_devices_task(scalar_condition<bool> const& cancel);
@@ -413,12 +469,21 @@ private:
 	//
 	static char const* PROXY_CHANGED_TASK;
 	static char const* PUSH_LISTINGS_TASK;
+	static char const* RELEASE_PRETUNER_TASK;
 	static char const* UPDATE_DEVICES_TASK;
 	static char const* UPDATE_EPISODES_TASK;
 	static char const* UPDATE_LINEUPS_TASK;
 	static char const* UPDATE_LISTINGS_TASK;
 	static char const* UPDATE_RECORDINGRULES_TASK;
 	static char const* UPDATE_RECORDINGS_TASK;
+
+	// Adaptive Stream Read Chunk Size
+	//
+	static size_t const ADAPTIVE_CHUNK_CHANNEL_BITRATES;
+	static long long const ADAPTIVE_CHUNK_LIVE_BITRATE;
+	static size_t const ADAPTIVE_CHUNK_MAX_SIZE;
+	static size_t const ADAPTIVE_CHUNK_MIN_SIZE;
+	static size_t const ADAPTIVE_CHUNK_READS_PER_SECOND;
 	
 	// Settings Helpers
 	//
@@ -426,17 +491,30 @@ private:
 
 	// Stream Helpers
 	//
-	std::unique_ptr<pvrstream> openlivestream_storage_http(connectionpool::handle const& dbhandle,
+	size_t adaptive_chunk_size(void) const;
+	std::unique_ptr<pvrstream> openlivestream(struct settings const& settings, connectionpool::handle const& dbhandle,
+		union channelid channelid, char const* vchannel);
+	std::unique_ptr<pvrstream> openlivestream_storage_http(struct settings const& settings, connectionpool::handle const& dbhandle,
 		union channelid channelid, char const* vchannel) const;
-	std::unique_ptr<pvrstream> openlivestream_tuner_device(connectionpool::handle const& dbhandle,
+	std::unique_ptr<pvrstream> openlivestream_tuner_device(struct settings const& settings, connectionpool::handle const& dbhandle,
 		union channelid channelid, char const* vchannel) const;
-	std::unique_ptr<pvrstream> openlivestream_tuner_http(connectionpool::handle const& dbhandle,
+	std::unique_ptr<pvrstream> openlivestream_tuner_http(struct settings const& settings, connectionpool::handle const& dbhandle,
 		union channelid channelid, char const* vchannel) const;
+	void pretune_next_channel(std::unique_lock<std::mutex> const& lock, struct settings const& settings, connectionpool::handle const& dbhandle,
+		union channelid channelid, union channelid previous);
+	std::shared_ptr<struct recordedstream> find_recordedstream(int64_t streamid) const;
+	size_t read_pvrstream(uint8_t* buffer, size_t count);
+	void release_recordedstream(int64_t streamid);
+	std::string stream_temp_file(char const* name);
+	void update_stream_telemetry(unsigned int serial, pvrstream::telemetry_t const& values);
 
 	//-------------------------------------------------------------------------
 	// Member Variables
 
+	std::deque<std::pair<unsigned int, long long>> m_channelbitrates;	// Measured live channel bitrates
 	std::shared_ptr<connectionpool>	m_connpool;						// Database connection pool
+	std::unique_ptr<tsdemuxer>		m_demuxer;						// Active PVR stream demuxer
+	std::mutex						m_demuxer_lock;					// Synchronization object
 	scalar_condition<bool>			m_discovered_devices;			// Discovery flag
 	scalar_condition<bool>			m_discovered_episodes;			// Discovery flag
 	scalar_condition<bool>			m_discovered_lineups;			// Discovery flag
@@ -447,17 +525,34 @@ private:
 	std::atomic<int>				m_epgmaxtime;					// Maximum EPG time frame
 	mutable std::deque<std::string>	m_errorlog;						// Recent error log
 	mutable std::mutex				m_errorlog_lock;				// Synchronization object
+	union channelid					m_lastchannelid;				// Last opened live channel
+	int64_t							m_nextstreamid;					// Next recorded stream id
+	pcrclock*						m_pcrclock;						// Active PVR stream clock
+	std::unique_ptr<pretuner>		m_pretuner;						// Pretuned live stream
+	std::mutex						m_pretuner_lock;				// Synchronization object
+	psiprobe*						m_psiprobe;						// Active PVR stream layout probe
 	std::unique_ptr<pvrstream>		m_pvrstream;					// Active PVR stream instance
+	int64_t							m_pvrstreamid;					// Active PVR stream id
 	channelranges_t					m_radiomappings_cable;			// Ranges of radio channels
 	channelranges_t					m_radiomappings_ota;			// Ranges of radio channels
 	mutable std::mutex				m_radiomappings_lock;			// Synchronization object
 	std::default_random_engine		m_randomengine;					// Pseudo-random number generator 
+	std::unique_ptr<streamreaper>	m_reaper;						// Retired stream reaper
+	recordedstreams_t				m_recordedstreams;				// Open recorded streams
+	mutable std::mutex				m_recordedstreams_lock;			// Synchronization object
 	scheduler						m_scheduler;					// Background task scheduler
 	struct settings					m_settings;						// Custom addon settings
 	mutable std::mutex				m_settings_lock;				// Synchronization object
 	std::atomic<bool>				m_startup_complete;				// Startup completed flag
 	time_t							m_stream_starttime;				// Current stream start time
 	time_t							m_stream_endtime;				// Current stream end time
+	long long						m_streambitrate;				// Current stream estimated bitrate
+	union channelid					m_streamchannelid;				// Current live stream channel
+	streammeter*					m_streammeter;					// Active PVR stream meter
+	pvrstream::telemetry_t			m_telemetry;					// Most recent stream telemetry
+	mutable std::mutex				m_telemetry_lock;				// Synchronization object
+	unsigned int					m_telemetry_serial;				// Current stream telemetry serial
+	std::atomic<unsigned int>		m_tempfile_serial;				// Stream temporary file serial
 	std::atomic<bool>				m_useproxy;						// Flag to use a proxy server
 };
 
@@ -0,0 +1,138 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __BITRATEMETER_H_
+#define __BITRATEMETER_H_
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+#pragma warning(push, 4)
+
+//-----------------------------------------------------------------------------
+// bitratemeter
+//
+// Implements a simple data rate meter that maintains an exponential moving
+// average of the bytes per second passed through it.  Data can be added from
+// one thread while the measurement is sampled from another thread, and the
+// measurement can be read from any thread
+
+class bitratemeter
+{
+public:
+
+	// Instance Constructor
+	//
+	explicit bitratemeter(std::chrono::milliseconds interval) : m_interval(interval), m_sampletime(std::chrono::steady_clock::now()) {}
+
+	// Destructor
+	//
+	~bitratemeter()=default;
+
+	//-------------------------------------------------------------------------
+	// Member Functions
+
+	// add
+	//
+	// Adds a number of bytes to the meter
+	void add(size_t bytes)
+	{
+		m_total += bytes;
+	}
+
+	// bytespersecond
+	//
+	// Gets the most recent measurement, in bytes per second
+	uint64_t bytespersecond(void) const
+	{
+		return m_bytespersecond;
+	}
+
+	// reset
+	//
+	// Resets the meter back to the initial state
+	void reset(void)
+	{
+		m_sampled = m_total;
+		m_sampletime = std::chrono::steady_clock::now();
+		m_bytespersecond = 0;
+		m_samples = 0;
+	}
+
+	// sample
+	//
+	// Updates the measurement if the sampling interval has elapsed
+	bool sample(void)
+	{
+		using namespace std::chrono;
+
+		// Only update the measurement once per sampling interval
+		steady_clock::time_point now = steady_clock::now();
+		milliseconds elapsed = duration_cast<milliseconds>(now - m_sampletime);
+		if(elapsed < m_interval) return false;
+
+		// Calculate the rate for this sampling interval
+		uint64_t total = m_total;
+		uint64_t rate = ((total - m_sampled) * 1000) / static_cast<uint64_t>(elapsed.count());
+
+		// The first sample seeds the moving average, subsequent samples are weighted at 25%
+		uint64_t average = m_bytespersecond;
+		m_bytespersecond = (m_samples == 0) ? rate : (average - (average / 4)) + (rate / 4);
+
+		m_sampled = total;
+		m_sampletime = now;
+		m_samples++;
+
+		return true;
+	}
+
+	// samples
+	//
+	// Gets the number of measurements that have been taken
+	unsigned int samples(void) const
+	{
+		return m_samples;
+	}
+
+private:
+
+	bitratemeter(bitratemeter const&)=delete;
+	bitratemeter& operator=(bitratemeter const&)=delete;
+
+	//-------------------------------------------------------------------------
+	// Member Variables
+
+	std::chrono::milliseconds const			m_interval;				// Sampling interval
+	std::atomic<uint64_t>					m_total{0};				// Total bytes added
+	uint64_t								m_sampled = 0;			// Total at last sample
+	std::chrono::steady_clock::time_point	m_sampletime;			// Time of last sample
+	std::atomic<uint64_t>					m_bytespersecond{0};	// Current measurement
+	std::atomic<unsigned int>				m_samples{0};			// Number of samples
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __BITRATEMETER_H_
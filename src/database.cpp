@@ -24,6 +24,9 @@
 #include "database.h"
 
 #include <cstddef>
+#include <cstdio>
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 #include "genremap.h"
@@ -65,10 +68,60 @@ struct xmltv_channel_element {
 	std::string		iconsrc;			// Channel icon URL
 };
 
+// STATEMENT_CACHE_KEY
+//
+// Client data key used to attach a prepared statement cache to a connection
+static char const STATEMENT_CACHE_KEY[] = "statementcache";
+
+// STATEMENT_CACHE_SIZE
+//
+// Maximum number of prepared statements to cache for a single connection
+static size_t const STATEMENT_CACHE_SIZE = 32;
+
+// statementcache
+//
+// Prepared statements cached for a pooled connection, keyed by the SQL text and kept in
+// most recently used order so the least recently used statement is evicted when it's full
+struct statementcache {
+
+	using entry_t = std::pair<std::string, sqlite3_stmt*>;
+
+	std::list<entry_t>												entries;	// Statements, most recently used first
+	std::unordered_map<std::string, std::list<entry_t>::iterator>	index;		// Statements keyed by the SQL text
+};
+
+// preparedstatement
+//
+// RAII class to take a prepared statement from the connection's statement cache, or to
+// prepare a new one, and to return it to the cache (or finalize it) when it goes out of scope
+class preparedstatement
+{
+public:
+
+	// Constructor / Destructor
+	//
+	preparedstatement(sqlite3* instance, char const* sql);
+	~preparedstatement();
+
+	// sqlite3_stmt* type conversion operator
+	//
+	operator sqlite3_stmt*(void) const { return m_statement; }
+
+private:
+
+	preparedstatement(preparedstatement const&)=delete;
+	preparedstatement& operator=(preparedstatement const&)=delete;
+
+	statementcache*				m_cache;			// Connection statement cache
+	std::string const			m_sql;				// Statement SQL text
+	sqlite3_stmt*				m_statement;		// Prepared statement
+};
+
 //---------------------------------------------------------------------------
 // FUNCTION PROTOTYPES
 //---------------------------------------------------------------------------
 
+static void attach_statement_cache(sqlite3* instance);
 static void bind_parameter(sqlite3_stmt* statement, int& paramindex, const char* value);
 static void bind_parameter(sqlite3_stmt* statement, int& paramindex, uint32_t value);
 static void bind_parameter(sqlite3_stmt* statement, int& paramindex, int32_t value);
@@ -103,6 +156,7 @@ connectionpool::connectionpool(char const* connstring, size_t poolsize, int flag
 
 	// Create and pool an initial connection to initialize the database
 	handle = open_database(m_connstr.c_str(), m_flags, true);
+	attach_statement_cache(handle);
 	m_connections.push_back(handle);
 	m_queue.push(handle);
 
@@ -113,6 +167,7 @@ connectionpool::connectionpool(char const* connstring, size_t poolsize, int flag
 
 			handle = open_database(m_connstr.c_str(), m_flags, false);
 			m_connections.push_back(handle);
+			attach_statement_cache(handle);
 			m_queue.push(handle);
 		}
 	}
@@ -156,6 +211,7 @@ sqlite3* connectionpool::acquire(void)
 		// No connections are available, open a new one using the same flags
 		handle = open_database(m_connstr.c_str(), m_flags, false);
 		m_connections.push_back(handle);
+		attach_statement_cache(handle);
 	}
 
 	// At least one connection is available for reuse
@@ -182,6 +238,82 @@ void connectionpool::release(sqlite3* handle)
 	m_queue.push(handle);
 }
 
+//---------------------------------------------------------------------------
+// PREPAREDSTATEMENT IMPLEMENTATION
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// preparedstatement Constructor
+//
+// Arguments:
+//
+//	instance		- Database instance
+//	sql				- SQL statement to be prepared
+
+preparedstatement::preparedstatement(sqlite3* instance, char const* sql) : 
+	m_cache(nullptr), m_sql((sql) ? sql : ""), m_statement(nullptr)
+{
+	if(instance == nullptr) throw std::invalid_argument("instance");
+	if(sql == nullptr) throw std::invalid_argument("sql");
+
+	// Connections that were not opened by a connection pool do not have a statement cache
+	m_cache = reinterpret_cast<statementcache*>(sqlite3_get_clientdata(instance, STATEMENT_CACHE_KEY));
+
+	// Take ownership of a cached instance of the statement if there is one; it's removed from
+	// the cache while in use in case the same statement is needed again before this one is done
+	if(m_cache != nullptr) {
+
+		auto found = m_cache->index.find(m_sql);
+		if(found != m_cache->index.end()) {
+
+			m_statement = found->second->second;
+			m_cache->entries.erase(found->second);
+			m_cache->index.erase(found);
+			return;
+		}
+	}
+
+	int result = sqlite3_prepare_v3(instance, sql, -1, (m_cache != nullptr) ? SQLITE_PREPARE_PERSISTENT : 0, &m_statement, nullptr);
+	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
+}
+
+//---------------------------------------------------------------------------
+// preparedstatement Destructor
+
+preparedstatement::~preparedstatement()
+{
+	// Reset the statement and clear the bindings before it goes back into the cache; this releases
+	// any locks it holds and any references to the bound parameter values. If the cache already has
+	// an instance of the same statement, just finalize this one instead
+	if((m_cache != nullptr) && (m_cache->index.find(m_sql) == m_cache->index.end())) {
+
+		sqlite3_reset(m_statement);
+		sqlite3_clear_bindings(m_statement);
+
+		try {
+
+			// Insert the statement as the most recently used one and evict the least
+			// recently used statement if that puts the cache over its size limit
+			m_cache->entries.emplace_front(m_sql, m_statement);
+			try { m_cache->index.emplace(m_sql, m_cache->entries.begin()); }
+			catch(...) { m_cache->entries.pop_front(); throw; }
+
+			if(m_cache->entries.size() > STATEMENT_CACHE_SIZE) {
+
+				sqlite3_finalize(m_cache->entries.back().second);
+				m_cache->index.erase(m_cache->entries.back().first);
+				m_cache->entries.pop_back();
+			}
+
+			return;
+		}
+
+		catch(...) { /* DO NOTHING */ }
+	}
+
+	sqlite3_finalize(m_statement);
+}
+
 //---------------------------------------------------------------------------
 // add_recordingrule
 //
@@ -246,6 +378,30 @@ void add_recordingrule(sqlite3* instance, char const* deviceauth, struct recordi
 		"where json_extract(data, '$.StorageURL') is not null");
 }
 
+//---------------------------------------------------------------------------
+// attach_statement_cache (local)
+//
+// Attaches an empty prepared statement cache to a pooled database connection
+//
+// Arguments:
+//
+//	instance		- Database instance
+
+static void attach_statement_cache(sqlite3* instance)
+{
+	assert(instance != nullptr);
+
+	// The cache is destroyed along with the connection, but the cached statements have
+	// to be finalized before that can happen; see close_database()
+	int result = sqlite3_set_clientdata(instance, STATEMENT_CACHE_KEY, new statementcache(), [](void* cache) -> void {
+
+		for(auto const& iterator : reinterpret_cast<statementcache*>(cache)->entries) sqlite3_finalize(iterator.second);
+		delete reinterpret_cast<statementcache*>(cache);
+	});
+
+	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
+}
+
 //---------------------------------------------------------------------------
 // bind_parameter (local)
 //
@@ -349,7 +505,12 @@ void clear_authorization_strings(sqlite3* instance, int expiry)
 
 void close_database(sqlite3* instance)
 {
-	if(instance) sqlite3_close(instance);
+	if(instance == nullptr) return;
+
+	// Destroy any prepared statement cache first, the connection cannot be closed until
+	// all of the statements that were prepared against it have been finalized
+	sqlite3_set_clientdata(instance, STATEMENT_CACHE_KEY, nullptr, nullptr);
+	sqlite3_close(instance);
 }
 
 //---------------------------------------------------------------------------
@@ -825,7 +986,8 @@ void discover_lineups(sqlite3* instance, bool& changed)
 void discover_listings(sqlite3* instance, char const* deviceauth)
 {
 	bool ignored;
-	return discover_listings(instance, deviceauth, ignored);
+	std::vector<struct listingid> removed;
+	return discover_listings(instance, deviceauth, ignored, removed);
 }
 
 //---------------------------------------------------------------------------
@@ -838,16 +1000,17 @@ void discover_listings(sqlite3* instance, char const* deviceauth)
 //	instance	- SQLite database instance
 //	deviceauth	- Device authorization string to use
 //	changed		- Flag indicating if the data has changed
+//	removed		- Receives the upcoming listings that were removed
 
-void discover_listings(sqlite3* instance, char const* deviceauth, bool& changed)
+void discover_listings(sqlite3* instance, char const* deviceauth, bool& changed, std::vector<struct listingid>& removed)
 {
 	sqlite3_stmt*		statement;				// SQL statement to execute
 	int					result;					// Result from SQLite function
 
-	if((instance == nullptr) || (deviceauth == nullptr)) return;
+	changed = false;							// Initialize [ref] argument
+	removed.clear();							// Initialize [ref] argument
 
-	// This operation always causes changes to both the listing and guide tables
-	changed = true;
+	if((instance == nullptr) || (deviceauth == nullptr)) return;
 
 	// As the XMLTV data is processed, a callback method passed to the virtual table
 	// will provide the details about the channel elements as they are processed
@@ -867,18 +1030,36 @@ void discover_listings(sqlite3* instance, char const* deviceauth, bool& changed)
 		});
 	};
 
-	// This is a multi-step operation, perform it in the context of a database transaction
-	execute_non_query(instance, "begin immediate transaction");
-	
-	try {
+	// Stage the XMLTV data in a separate database file attached next to the main database so that building the staging
+	// tables does not require the write lock on the main database. The temporary database of the connection isn't used
+	// for this since SQLITE_TEMP_STORE=3 keeps it in memory and the listings can be quite large. If the main database is
+	// in memory, an unnamed staging database is attached instead, which is stored wherever the temporary database is
+	char const* dbfile = sqlite3_db_filename(instance, "main");
+	std::string stagingfile = ((dbfile != nullptr) && (*dbfile != '\0')) ? std::string(dbfile).append("-discover") : std::string();
+	execute_non_query(instance, "attach database ?1 as discover", stagingfile.c_str());
 
-		// Truncate both the listing and guide tables
-		execute_non_query(instance, "delete from listing");
-		execute_non_query(instance, "delete from guide");
+	try {
 
-		// Reload the listing table directly from the xmltv virtual table, passing in an onchannel
-		// callback pointer to gather the channel information as the data is processed
-		auto sql = "insert into listing select "
+		// The staging database is discarded afterwards, there is no need to journal or sync it
+		execute_non_query(instance, "pragma discover.journal_mode = off");
+		execute_non_query(instance, "pragma discover.synchronous = off");
+
+		execute_non_query(instance, "drop table if exists discover.discover_listing");
+		execute_non_query(instance, "drop table if exists discover.discover_listing_stale");
+		execute_non_query(instance, "drop table if exists discover.discover_guide");
+		execute_non_query(instance, "drop table if exists discover.discover_guide_changed");
+		execute_non_query(instance, "create table discover.discover_listing as select * from listing limit 0");
+		execute_non_query(instance, "create table discover.discover_guide as select * from guide limit 0");
+
+		// Load the discovered listings directly from the xmltv virtual table, passing in an onchannel callback pointer
+		// to gather the channel information as the data is processed. Each listing gets a hash of its content so that
+		// it only has to be rewritten if it has actually changed
+		auto sql = "insert into discover_listing select xmltvlisting.*, "
+			"fnv_hash(xmltvlisting.channelid, xmltvlisting.starttime, xmltvlisting.endtime, xmltvlisting.seriesid, xmltvlisting.title, "
+			"xmltvlisting.episodename, xmltvlisting.synopsis, xmltvlisting.year, xmltvlisting.originalairdate, xmltvlisting.iconurl, "
+			"xmltvlisting.programtype, xmltvlisting.primarygenre, xmltvlisting.genres, xmltvlisting.episodenumber, xmltvlisting.isnew, "
+			"xmltvlisting.isrepeat, xmltvlisting.islive, xmltvlisting.starrating) as hash, "
+			"cast(strftime('%s', 'now') as integer) as discovered from (select "
 			"xmltv.channel as channelid, "
 			"cast(coalesce(strftime('%s', xmltv_time_to_w3c(xmltv.start)), 0) as integer) as starttime, "
 			"cast(coalesce(strftime('%s', xmltv_time_to_w3c(xmltv.stop)), 0) as integer) as endtime, "
@@ -897,67 +1078,161 @@ void discover_listings(sqlite3* instance, char const* deviceauth, bool& changed)
 			"cast(coalesce(xmltv.isrepeat, 0) as integer) as isrepeat, "
 			"cast(coalesce(xmltv.islive, 0) as integer) as islive, "
 			"xmltv.starrating as starrating "
-			"from xmltv where xmltv.uri = 'https://api.hdhomerun.com/api/xmltv?DeviceAuth=' || ?1 and onchannel = ?2";
+			"from xmltv where xmltv.uri = 'https://api.hdhomerun.com/api/xmltv?DeviceAuth=' || ?1 and onchannel = ?2) as xmltvlisting";
 
 		// Prepare the statement
 		result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
 		if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
 
-		// Bind the query parameters
-		result = sqlite3_bind_text(statement, 1, deviceauth, -1, SQLITE_STATIC);
-		if(result == SQLITE_OK) result = sqlite3_bind_pointer(statement, 2, &callback, typeid(xmltv_onchannel_callback).name(), nullptr);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+		try {
 
-		// Execute the query - no result set is expected
-		result = sqlite3_step(statement);
-		if(result == SQLITE_ROW) throw string_exception(__func__, ": unexpected result set returned from non-query");
-		if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
+			// Bind the query parameters
+			result = sqlite3_bind_text(statement, 1, deviceauth, -1, SQLITE_STATIC);
+			if(result == SQLITE_OK) result = sqlite3_bind_pointer(statement, 2, &callback, typeid(xmltv_onchannel_callback).name(), nullptr);
+			if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Finalize the statement
-		sqlite3_finalize(statement);
+			// Execute the query - no result set is expected
+			result = sqlite3_step(statement);
+			if(result == SQLITE_ROW) throw string_exception(__func__, ": unexpected result set returned from non-query");
+			if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+			// Finalize the statement
+			sqlite3_finalize(statement);
+		}
 
-		// Now reload the guide table from the enumerated channel information
-		sql = "insert into guide values(?1, ?2, ?3, ?4, ?5, ?6)";
+		catch(...) { sqlite3_finalize(statement); throw; }
+
+		execute_non_query(instance, "create index discover.discover_listing_channelid_starttime_endtime_index on discover_listing(channelid, starttime, endtime)");
+
+		// Now load the discovered guide from the enumerated channel information
+		sql = "insert into discover_guide values(?1, ?2, ?3, ?4, ?5, ?6)";
 
 		// Prepare the statement
 		result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
 		if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
 
-		// Iterate over all of the enumerated channels and insert them
-		for(auto const& channel : channels) {
-
-			// (Re)bind the query parameters
-			result = sqlite3_bind_text(statement, 1, channel.id.c_str(), -1, SQLITE_STATIC);
-			if(result == SQLITE_OK) result = sqlite3_bind_text(statement, 2, channel.number.c_str(), -1, SQLITE_STATIC);
-			if(result == SQLITE_OK) result = (channel.name.empty() ? sqlite3_bind_null(statement, 3) : 
-				sqlite3_bind_text(statement, 3, channel.name.c_str(), -1, SQLITE_STATIC));
-			if(result == SQLITE_OK) result = (channel.altname.empty() ? sqlite3_bind_null(statement, 4) : 
-				sqlite3_bind_text(statement, 4, channel.altname.c_str(), -1, SQLITE_STATIC));
-			if(result == SQLITE_OK) result = (channel.network.empty() ? sqlite3_bind_null(statement, 5) : 
-				sqlite3_bind_text(statement, 5, channel.network.c_str(), -1, SQLITE_STATIC));
-			if(result == SQLITE_OK) result = (channel.iconsrc.empty() ? sqlite3_bind_null(statement, 6) : 
-				sqlite3_bind_text(statement, 6, channel.iconsrc.c_str(), -1, SQLITE_STATIC));
-			if(result != SQLITE_OK) throw sqlite_exception(result);
+		try {
 
-			// Execute the query - no result set is expected
-			result = sqlite3_step(statement);
-			if(result == SQLITE_ROW) throw string_exception(__func__, ": unexpected result set returned from non-query");
-			if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
+			// Iterate over all of the enumerated channels and insert them
+			for(auto const& channel : channels) {
+
+				// (Re)bind the query parameters
+				result = sqlite3_bind_text(statement, 1, channel.id.c_str(), -1, SQLITE_STATIC);
+				if(result == SQLITE_OK) result = sqlite3_bind_text(statement, 2, channel.number.c_str(), -1, SQLITE_STATIC);
+				if(result == SQLITE_OK) result = (channel.name.empty() ? sqlite3_bind_null(statement, 3) : 
+					sqlite3_bind_text(statement, 3, channel.name.c_str(), -1, SQLITE_STATIC));
+				if(result == SQLITE_OK) result = (channel.altname.empty() ? sqlite3_bind_null(statement, 4) : 
+					sqlite3_bind_text(statement, 4, channel.altname.c_str(), -1, SQLITE_STATIC));
+				if(result == SQLITE_OK) result = (channel.network.empty() ? sqlite3_bind_null(statement, 5) : 
+					sqlite3_bind_text(statement, 5, channel.network.c_str(), -1, SQLITE_STATIC));
+				if(result == SQLITE_OK) result = (channel.iconsrc.empty() ? sqlite3_bind_null(statement, 6) : 
+					sqlite3_bind_text(statement, 6, channel.iconsrc.c_str(), -1, SQLITE_STATIC));
+				if(result != SQLITE_OK) throw sqlite_exception(result);
+
+				// Execute the query - no result set is expected
+				result = sqlite3_step(statement);
+				if(result == SQLITE_ROW) throw string_exception(__func__, ": unexpected result set returned from non-query");
+				if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+				// Reset the prepared statement so that it can be executed again
+				result = sqlite3_reset(statement);
+				if(result != SQLITE_OK) throw sqlite_exception(result);
+			}
 
-			// Reset the prepared statement so that it can be executed again
-			result = sqlite3_reset(statement);
-			if(result != SQLITE_OK) throw sqlite_exception(result);
+			// Finalize the statement
+			sqlite3_finalize(statement);
 		}
 
-		// Finalize the statement
-		sqlite3_finalize(statement);
-	
-		// Commit the database transaction
-		execute_non_query(instance, "commit transaction");
+		catch(...) { sqlite3_finalize(statement); throw; }
+
+		// Work out the differences between the discovered and the current listings before taking the write lock; only this
+		// function writes to the listing and guide tables so the differences will still be valid when they are applied:
+		//
+		//	discover_listing_stale	- rowids of the current listings that either no longer exist or have changed
+		//	discover_listing		- trimmed down to only the discovered listings that are new or have changed
+		//	discover_guide_changed	- channel identifiers that have been added, removed or changed in the guide
+		execute_non_query(instance, "create table discover.discover_listing_stale as select listing.rowid as listingid from listing where not exists(select 1 from discover_listing "
+			"where discover_listing.channelid = listing.channelid and discover_listing.starttime = listing.starttime and discover_listing.endtime = listing.endtime "
+			"and discover_listing.hash = listing.hash)");
+
+		execute_non_query(instance, "create table discover.discover_guide_changed as select channelid from (select * from guide except select * from discover_guide) "
+			"union select channelid from (select * from discover_guide except select * from guide)");
+
+		// Collect the upcoming listings that no longer exist so that they can be removed from the guide; listings
+		// that have already ended are left for the client to expire on its own
+		sql = "select fnv_hash(encode_channel_id(guide.number), listing.starttime, listing.endtime) as broadcastid, "
+			"encode_channel_id(guide.number) as channelid from listing inner join guide on listing.channelid = guide.channelid "
+			"where listing.endtime > cast(strftime('%s', 'now') as integer) and not exists(select 1 from discover_listing "
+			"where discover_listing.channelid = listing.channelid and discover_listing.starttime = listing.starttime and discover_listing.endtime = listing.endtime)";
+
+		// Prepare the statement
+		result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
+		if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+		try {
+
+			// Execute the query and iterate over all returned rows
+			while(sqlite3_step(statement) == SQLITE_ROW) {
+
+				struct listingid item{};
+				item.broadcastid = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+				item.channelid = static_cast<unsigned int>(sqlite3_column_int(statement, 1));
+
+				removed.push_back(item);
+			}
+
+			// Finalize the statement
+			sqlite3_finalize(statement);
+		}
+
+		catch(...) { sqlite3_finalize(statement); throw; }
+
+		execute_non_query(instance, "delete from discover_listing where exists(select 1 from listing where listing.channelid = discover_listing.channelid "
+			"and listing.starttime = discover_listing.starttime and listing.endtime = discover_listing.endtime and listing.hash = discover_listing.hash)");
+
+		bool guidechanged = (execute_scalar_int(instance, "select count(channelid) from discover_guide_changed") > 0);
+
+		// Publish the differences in a single short transaction; everything that needs to be written has already been
+		// staged in the separate staging database, which doesn't require the write lock on the main database to be built
+		execute_non_query(instance, "begin immediate transaction");
+
+		try {
+
+			// Remove all of the listings that either no longer exist or have changed
+			if(execute_non_query(instance, "delete from listing where rowid in (select listingid from discover_listing_stale)") > 0) changed = true;
+
+			// Insert all of the listings that are new or have changed
+			if(execute_non_query(instance, "insert into listing select * from discover_listing") > 0) changed = true;
+
+			// The guide table is small enough to simply be replaced if anything about it has changed, but the listings for any of
+			// the affected channels have to be marked as discovered again since their broadcast identifiers depend on the guide
+			if(guidechanged) {
+
+				execute_non_query(instance, "update listing set discovered = cast(strftime('%s', 'now') as integer) where channelid in (select channelid from discover_guide_changed)");
+				execute_non_query(instance, "delete from guide");
+				execute_non_query(instance, "insert into guide select * from discover_guide");
+
+				changed = true;
+			}
+
+			// Commit the database transaction
+			execute_non_query(instance, "commit transaction");
+		}
+
+		// Rollback the transaction on any exception
+		catch(...) { try_execute_non_query(instance, "rollback transaction"); throw; }
+
+		// Detach and delete the staging database
+		execute_non_query(instance, "detach database discover");
+		if(!stagingfile.empty()) std::remove(stagingfile.c_str());
 	}
 
-	// Rollback the transaction on any exception
-	catch(...) { try_execute_non_query(instance, "rollback transaction"); throw; }
+	catch(...) { 
+		
+		try_execute_non_query(instance, "detach database discover");
+		if(!stagingfile.empty()) std::remove(stagingfile.c_str());
+		throw; 
+	}
 }
 
 //---------------------------------------------------------------------------
@@ -1190,7 +1465,6 @@ static void discover_series_recordings(sqlite3* instance, char const* seriesid)
 
 void enumerate_channels(sqlite3* instance, bool prependnumbers, bool showdrm, enum channel_name_source namesource, enumerate_channels_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1209,33 +1483,26 @@ void enumerate_channels(sqlite3* instance, bool prependnumbers, bool showdrm, en
 		"where nullif(json_extract(entry.value, '$.DRM'), ?3) is null "
 		"order by channelid";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (prependnumbers) ? 1 : 0);
-		if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, static_cast<int>(namesource));
-		if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 3, (showdrm) ? 1 : 0);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (prependnumbers) ? 1 : 0);
+	if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, static_cast<int>(namesource));
+	if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 3, (showdrm) ? 1 : 0);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-			struct channel item{};
-			item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
-			item.channelname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
-			item.iconurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
-			item.drm = (sqlite3_column_int(statement, 3) != 0);
+		struct channel item{};
+		item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+		item.channelname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
+		item.iconurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
+		item.drm = (sqlite3_column_int(statement, 3) != 0);
 
-			callback(item);						// Invoke caller-supplied callback
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		callback(item);						// Invoke caller-supplied callback
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1251,7 +1518,6 @@ void enumerate_channels(sqlite3* instance, bool prependnumbers, bool showdrm, en
 
 void enumerate_channelids(sqlite3* instance, bool showdrm, enumerate_channelids_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1260,28 +1526,21 @@ void enumerate_channelids(sqlite3* instance, bool showdrm, enumerate_channelids_
 	auto sql = "select distinct(encode_channel_id(json_extract(entry.value, '$.GuideNumber'))) as channelid "
 		"from lineup, json_each(lineup.data) as entry where nullif(json_extract(entry.value, '$.DRM'), ?1) is null";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-	try {
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
-
-			union channelid channelid{};
-			channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
-			
-			callback(channelid);
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		union channelid channelid{};
+		channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+		
+		callback(channelid);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1297,7 +1556,6 @@ void enumerate_channelids(sqlite3* instance, bool showdrm, enumerate_channelids_
 
 void enumerate_channeltuners(sqlite3* instance, union channelid channelid, enumerate_channeltuners_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1313,31 +1571,24 @@ void enumerate_channeltuners(sqlite3* instance, union channelid channelid, enume
 		"from tuners inner join lineup using(deviceid), json_each(lineup.data) as lineupdata "
 		"where json_extract(lineupdata.value, '$.GuideNumber') = decode_channel_id(?1) order by tunerid desc";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, channelid.value);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, channelid.value);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-			struct channel_tuner channeltuner {};
-			channeltuner.tunerid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			channeltuner.islegacy = sqlite3_column_int(statement, 1) != 0;
-			channeltuner.frequency = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
-			channeltuner.program = reinterpret_cast<char const*>(sqlite3_column_text(statement, 3));
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-			callback(channeltuner);
-		}
+		struct channel_tuner channeltuner {};
+		channeltuner.tunerid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		channeltuner.islegacy = sqlite3_column_int(statement, 1) != 0;
+		channeltuner.frequency = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
+		channeltuner.program = reinterpret_cast<char const*>(sqlite3_column_text(statement, 3));
 
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		callback(channeltuner);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1391,9 +1642,6 @@ static void enumerate_devices_broadcast(enumerate_devices_callback const& callba
 
 void enumerate_device_names(sqlite3* instance, enumerate_device_names_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
-	int							result;				// Result from SQLite function
-	
 	if((instance == nullptr) || (callback == nullptr)) return;
 
 	// name
@@ -1401,24 +1649,17 @@ void enumerate_device_names(sqlite3* instance, enumerate_device_names_callback c
 		"' (version: ' || coalesce(coalesce(json_extract(data, '$.FirmwareVersion'), json_extract(data, '$.Version')), 'unknown') || ')' || "
 		"case when coalesce(dvrauthorized, 0) = 1 then ' (DVR authorized)' else '' end as name from device";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-			struct device_name devicename{};
-			devicename.name = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			
-			callback(devicename);
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		struct device_name devicename{};
+		devicename.name = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		
+		callback(devicename);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1434,7 +1675,6 @@ void enumerate_device_names(sqlite3* instance, enumerate_device_names_callback c
 
 void enumerate_favorite_channelids(sqlite3* instance, bool showdrm, enumerate_channelids_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1444,28 +1684,21 @@ void enumerate_favorite_channelids(sqlite3* instance, bool showdrm, enumerate_ch
 		"from lineup, json_each(lineup.data) as entry where json_extract(entry.value, '$.Favorite') = 1 "
 		"and nullif(json_extract(entry.value, '$.DRM'), ?1) is null";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-			union channelid channelid{};
-			channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
-			
-			callback(channelid);
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		union channelid channelid{};
+		channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+		
+		callback(channelid);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1481,7 +1714,6 @@ void enumerate_favorite_channelids(sqlite3* instance, bool showdrm, enumerate_ch
 
 void enumerate_expired_recordingruleids(sqlite3* instance, int expiry, enumerate_recordingruleids_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (expiry <= 0) || (callback == nullptr)) return;
@@ -1490,22 +1722,15 @@ void enumerate_expired_recordingruleids(sqlite3* instance, int expiry, enumerate
 	auto sql = "select distinct(recordingruleid) as recordingruleid from recordingrule "
 		"where json_extract(data, '$.DateTimeOnly') < (cast(strftime('%s', 'now') as integer) - ?1)";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, expiry);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) callback(static_cast<unsigned int>(sqlite3_column_int(statement, 0)));
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
-	}
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, expiry);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-	catch(...) { sqlite3_finalize(statement); throw; }
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) callback(static_cast<unsigned int>(sqlite3_column_int(statement, 0)));
 }
 
 //---------------------------------------------------------------------------
@@ -1521,7 +1746,6 @@ void enumerate_expired_recordingruleids(sqlite3* instance, int expiry, enumerate
 
 void enumerate_hd_channelids(sqlite3* instance, bool showdrm, enumerate_channelids_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1531,28 +1755,21 @@ void enumerate_hd_channelids(sqlite3* instance, bool showdrm, enumerate_channeli
 		"from lineup, json_each(lineup.data) as entry where json_extract(entry.value, '$.HD') = 1 "
 		"and nullif(json_extract(entry.value, '$.DRM'), ?1) is null";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-	try {
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
-
-			union channelid channelid{};
-			channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
-			
-			callback(channelid);
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		union channelid channelid{};
+		channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+		
+		callback(channelid);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1568,7 +1785,6 @@ void enumerate_hd_channelids(sqlite3* instance, bool showdrm, enumerate_channeli
 
 void enumerate_hevc_channelids(sqlite3* instance, bool showdrm, enumerate_channelids_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1578,28 +1794,21 @@ void enumerate_hevc_channelids(sqlite3* instance, bool showdrm, enumerate_channe
 		"from lineup, json_each(lineup.data) as entry where lower(json_extract(entry.value, '$.VideoCodec')) in ('hevc', 'h265') "
 		"and nullif(json_extract(entry.value, '$.DRM'), ?1) is null";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-			union channelid channelid{};
-			channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-			callback(channelid);
-		}
+		union channelid channelid{};
+		channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
 
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		callback(channelid);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1611,11 +1820,12 @@ void enumerate_hevc_channelids(sqlite3* instance, bool showdrm, enumerate_channe
 //
 //	instance	- Database instance
 //	showdrm		- Flag if DRM channels should be enumerated
+//	maxdays		- Maximum number of days worth of listings to enumerate
+//	since		- Only enumerate listings discovered at or after this time
 //	callback	- Callback function
 
-void enumerate_listings(sqlite3* instance, bool showdrm, int maxdays, enumerate_listings_callback const& callback)
+void enumerate_listings(sqlite3* instance, bool showdrm, int maxdays, time_t since, enumerate_listings_callback const& callback)
 {
-	sqlite3_stmt*			statement;				// SQL statement to execute
 	int						result;					// Result from SQLite function
 	bool					cancel = false;			// Cancellation flag
 
@@ -1651,56 +1861,49 @@ void enumerate_listings(sqlite3* instance, bool showdrm, int maxdays, enumerate_
 		"from listing inner join guide on listing.channelid = guide.channelid "
 		"inner join allchannels on guide.number = allchannels.number "
 		"left outer join genremap on listing.primarygenre like genremap.genre "
-		"where (listing.endtime < (cast(strftime('%s', 'now') as integer) + (?2 * 86400)))";
-
-	// Prepare the statement
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
+		"where (listing.endtime < (cast(strftime('%s', 'now') as integer) + (?2 * 86400))) and (listing.discovered >= ?3)";
 
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
-		if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, maxdays);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the SQL statement
-		result = sqlite3_step(statement);
-		if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-		// Process each row returned from the query
-		while((result == SQLITE_ROW) && (cancel == false)) {
-
-			struct listing item{};
-			item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
-			item.broadcastid = static_cast<unsigned int>(sqlite3_column_int(statement, 2));
-			item.channelid = static_cast<unsigned int>(sqlite3_column_int(statement, 3));
-			item.starttime = sqlite3_column_int64(statement, 4);
-			item.endtime = sqlite3_column_int64(statement, 5);
-			item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 6));
-			item.year = sqlite3_column_int(statement, 7);
-			item.iconurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
-			item.programtype = reinterpret_cast<char const*>(sqlite3_column_text(statement, 9));
-			item.genretype = sqlite3_column_int(statement, 10);
-			item.genres = reinterpret_cast<char const*>(sqlite3_column_text(statement, 11));
-			item.originalairdate = reinterpret_cast<char const*>(sqlite3_column_text(statement, 12));
-			item.seriesnumber = sqlite3_column_int(statement, 13);
-			item.episodenumber = sqlite3_column_int(statement, 14);
-			item.episodename = reinterpret_cast<char const*>(sqlite3_column_text(statement, 15));
-			item.isnew = (sqlite3_column_int(statement, 16) != 0);
-			item.isrepeat = (sqlite3_column_int(statement, 17) != 0);
-			item.islive = (sqlite3_column_int(statement, 18) != 0);
-			item.starrating = sqlite3_column_int(statement, 19);
-
-			callback(item, cancel);					// Invoke caller-supplied callback
-			result = sqlite3_step(statement);		// Move to the next row of data
-		}
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
+	if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, maxdays);
+	if(result == SQLITE_OK) result = sqlite3_bind_int64(statement, 3, static_cast<sqlite3_int64>(since));
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		sqlite3_finalize(statement);				// Finalize the SQLite statement
+	// Execute the SQL statement
+	result = sqlite3_step(statement);
+	if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+	// Process each row returned from the query
+	while((result == SQLITE_ROW) && (cancel == false)) {
+
+		struct listing item{};
+		item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
+		item.broadcastid = static_cast<unsigned int>(sqlite3_column_int(statement, 2));
+		item.channelid = static_cast<unsigned int>(sqlite3_column_int(statement, 3));
+		item.starttime = sqlite3_column_int64(statement, 4);
+		item.endtime = sqlite3_column_int64(statement, 5);
+		item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 6));
+		item.year = sqlite3_column_int(statement, 7);
+		item.iconurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
+		item.programtype = reinterpret_cast<char const*>(sqlite3_column_text(statement, 9));
+		item.genretype = sqlite3_column_int(statement, 10);
+		item.genres = reinterpret_cast<char const*>(sqlite3_column_text(statement, 11));
+		item.originalairdate = reinterpret_cast<char const*>(sqlite3_column_text(statement, 12));
+		item.seriesnumber = sqlite3_column_int(statement, 13);
+		item.episodenumber = sqlite3_column_int(statement, 14);
+		item.episodename = reinterpret_cast<char const*>(sqlite3_column_text(statement, 15));
+		item.isnew = (sqlite3_column_int(statement, 16) != 0);
+		item.isrepeat = (sqlite3_column_int(statement, 17) != 0);
+		item.islive = (sqlite3_column_int(statement, 18) != 0);
+		item.starrating = sqlite3_column_int(statement, 19);
+
+		callback(item, cancel);					// Invoke caller-supplied callback
+		result = sqlite3_step(statement);		// Move to the next row of data
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1719,7 +1922,6 @@ void enumerate_listings(sqlite3* instance, bool showdrm, int maxdays, enumerate_
 
 void enumerate_listings(sqlite3* instance, bool showdrm, union channelid channelid, time_t starttime, time_t endtime, enumerate_listings_callback const& callback)
 {
-	sqlite3_stmt*			statement;				// SQL statement to execute
 	int						result;					// Result from SQLite function
 	bool					cancel = false;			// Cancellation flag
 
@@ -1753,56 +1955,48 @@ void enumerate_listings(sqlite3* instance, bool showdrm, union channelid channel
 		"left outer join genremap on listing.primarygenre like genremap.genre "
 		"where guide.number = decode_channel_id(?2) and listing.starttime >= ?3 and listing.endtime <= ?4";
 
-	// Prepare the statement
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-	try {
-
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
-		if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, channelid.value);
-		if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 3, static_cast<int>(starttime));
-		if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 4, static_cast<int>(endtime));
-		if(result != SQLITE_OK) throw sqlite_exception(result);
-
-		// Execute the SQL statement
-		result = sqlite3_step(statement);
-		if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-		// Process each row returned from the query
-		while((result == SQLITE_ROW) && (cancel == false)) {
-
-			struct listing item{};
-			item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
-			item.broadcastid = static_cast<unsigned int>(sqlite3_column_int(statement, 2));
-			item.channelid = channelid.value;
-			item.starttime = sqlite3_column_int64(statement, 3);
-			item.endtime = sqlite3_column_int64(statement, 4);
-			item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 5));
-			item.year = sqlite3_column_int(statement, 6);
-			item.iconurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 7));
-			item.programtype = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
-			item.genretype = sqlite3_column_int(statement, 9);
-			item.genres = reinterpret_cast<char const*>(sqlite3_column_text(statement, 10));
-			item.originalairdate = reinterpret_cast<char const*>(sqlite3_column_text(statement, 11));
-			item.seriesnumber = sqlite3_column_int(statement, 12);
-			item.episodenumber = sqlite3_column_int(statement, 13);
-			item.episodename = reinterpret_cast<char const*>(sqlite3_column_text(statement, 14));
-			item.isnew = (sqlite3_column_int(statement, 15) != 0);
-			item.isrepeat = (sqlite3_column_int(statement, 16) != 0);
-			item.islive = (sqlite3_column_int(statement, 17) != 0);
-			item.starrating = sqlite3_column_int(statement, 18);
-
-			callback(item, cancel);					// Invoke caller-supplied callback
-			result = sqlite3_step(statement);		// Move to the next row of data
-		}
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
+	if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, channelid.value);
+	if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 3, static_cast<int>(starttime));
+	if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 4, static_cast<int>(endtime));
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		sqlite3_finalize(statement);				// Finalize the SQLite statement
+	// Execute the SQL statement
+	result = sqlite3_step(statement);
+	if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+	// Process each row returned from the query
+	while((result == SQLITE_ROW) && (cancel == false)) {
+
+		struct listing item{};
+		item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
+		item.broadcastid = static_cast<unsigned int>(sqlite3_column_int(statement, 2));
+		item.channelid = channelid.value;
+		item.starttime = sqlite3_column_int64(statement, 3);
+		item.endtime = sqlite3_column_int64(statement, 4);
+		item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 5));
+		item.year = sqlite3_column_int(statement, 6);
+		item.iconurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 7));
+		item.programtype = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
+		item.genretype = sqlite3_column_int(statement, 9);
+		item.genres = reinterpret_cast<char const*>(sqlite3_column_text(statement, 10));
+		item.originalairdate = reinterpret_cast<char const*>(sqlite3_column_text(statement, 11));
+		item.seriesnumber = sqlite3_column_int(statement, 12);
+		item.episodenumber = sqlite3_column_int(statement, 13);
+		item.episodename = reinterpret_cast<char const*>(sqlite3_column_text(statement, 14));
+		item.isnew = (sqlite3_column_int(statement, 15) != 0);
+		item.isrepeat = (sqlite3_column_int(statement, 16) != 0);
+		item.islive = (sqlite3_column_int(statement, 17) != 0);
+		item.starrating = sqlite3_column_int(statement, 18);
+
+		callback(item, cancel);					// Invoke caller-supplied callback
+		result = sqlite3_step(statement);		// Move to the next row of data
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1834,7 +2028,6 @@ void enumerate_recordings(sqlite3* instance, enumerate_recordings_callback const
 
 void enumerate_recordings(sqlite3* instance, bool episodeastitle, bool ignorecategories, enumerate_recordings_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1862,53 +2055,47 @@ void enumerate_recordings(sqlite3* instance, bool episodeastitle, bool ignorecat
 		"coalesce(json_extract(data, '$.Category'), 'series') as category "
 		"from recording";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (episodeastitle) ? 1 : 0);
-		if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, (ignorecategories) ? 1 : 0);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (episodeastitle) ? 1 : 0);
+	if(result == SQLITE_OK) result = sqlite3_bind_int(statement, 2, (ignorecategories) ? 1 : 0);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Execute the query and iterate over all returned rows
-		result = sqlite3_step(statement);
-		while(result == SQLITE_ROW) {
-
-			struct recording item{};
-			item.recordingid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
-			item.episodename = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
-			item.firstairing = sqlite3_column_int(statement, 3);
-			item.originalairdate = sqlite3_column_int64(statement, 4);
-			item.programtype = reinterpret_cast<char const*>(sqlite3_column_text(statement, 5));
-			item.seriesnumber = sqlite3_column_int(statement, 6);
-			item.episodenumber = sqlite3_column_int(statement, 7);
-			item.year = sqlite3_column_int(statement, 8);
-			item.streamurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 9));
-			item.directory = reinterpret_cast<char const*>(sqlite3_column_text(statement, 10));
-			item.plot = reinterpret_cast<char const*>(sqlite3_column_text(statement, 11));
-			item.channelname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 12));
-			item.iconpath = reinterpret_cast<char const*>(sqlite3_column_text(statement, 13));
-			item.thumbnailpath = reinterpret_cast<char const*>(sqlite3_column_text(statement, 14));
-			item.recordingtime = sqlite3_column_int64(statement, 15);
-			item.duration = sqlite3_column_int(statement, 16);
-			item.lastposition = static_cast<uint32_t>(sqlite3_column_int64(statement, 17));
-			item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 18));
-			item.category = reinterpret_cast<char const*>(sqlite3_column_text(statement, 19));
-
-			callback(item);							// Invoke caller-supplied callback
-			result = sqlite3_step(statement);		// Move to the next row in the result set
-		}
-	
-		// If the final result of the query was not SQLITE_DONE, something bad happened
-		if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
-			
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+	// Execute the query and iterate over all returned rows
+	result = sqlite3_step(statement);
+	while(result == SQLITE_ROW) {
+
+		struct recording item{};
+		item.recordingid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
+		item.episodename = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
+		item.firstairing = sqlite3_column_int(statement, 3);
+		item.originalairdate = sqlite3_column_int64(statement, 4);
+		item.programtype = reinterpret_cast<char const*>(sqlite3_column_text(statement, 5));
+		item.seriesnumber = sqlite3_column_int(statement, 6);
+		item.episodenumber = sqlite3_column_int(statement, 7);
+		item.year = sqlite3_column_int(statement, 8);
+		item.streamurl = reinterpret_cast<char const*>(sqlite3_column_text(statement, 9));
+		item.directory = reinterpret_cast<char const*>(sqlite3_column_text(statement, 10));
+		item.plot = reinterpret_cast<char const*>(sqlite3_column_text(statement, 11));
+		item.channelname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 12));
+		item.iconpath = reinterpret_cast<char const*>(sqlite3_column_text(statement, 13));
+		item.thumbnailpath = reinterpret_cast<char const*>(sqlite3_column_text(statement, 14));
+		item.recordingtime = sqlite3_column_int64(statement, 15);
+		item.duration = sqlite3_column_int(statement, 16);
+		item.lastposition = static_cast<uint32_t>(sqlite3_column_int64(statement, 17));
+		item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 18));
+		item.category = reinterpret_cast<char const*>(sqlite3_column_text(statement, 19));
+
+		callback(item);							// Invoke caller-supplied callback
+		result = sqlite3_step(statement);		// Move to the next row in the result set
 	}
 
-	catch(...) { sqlite3_finalize(statement); throw; }
+	// If the final result of the query was not SQLITE_DONE, something bad happened
+	if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
+		
 }
 
 //---------------------------------------------------------------------------
@@ -1923,9 +2110,6 @@ void enumerate_recordings(sqlite3* instance, bool episodeastitle, bool ignorecat
 
 void enumerate_recordingrules(sqlite3* instance, enumerate_recordingrules_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
-	int							result;				// Result from SQLite function
-	
 	if((instance == nullptr) || (callback == nullptr)) return;
 
 	// recordingruleid | type | seriesid | channelid | recentonly | afteroriginalairdateonly | datetimeonly | title | synopsis | startpadding | endpadding
@@ -1943,34 +2127,27 @@ void enumerate_recordingrules(sqlite3* instance, enumerate_recordingrules_callba
 		"coalesce(json_extract(data, '$.EndPadding'), 0) as endpadding "
 		"from recordingrule left outer join guidenumbers on json_extract(data, '$.ChannelOnly') = guidenumbers.guidenumber";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
-
-			struct recordingrule item{};
-			item.recordingruleid = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
-			item.type = static_cast<recordingrule_type>(sqlite3_column_int(statement, 1));
-			item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
-			item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 3));
-			item.recentonly = (sqlite3_column_int(statement, 4) != 0);
-			item.afteroriginalairdateonly = sqlite3_column_int64(statement, 5);
-			item.datetimeonly = sqlite3_column_int64(statement, 6);
-			item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 7));
-			item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
-			item.startpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 9));
-			item.endpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 10));
-
-			callback(item);						// Invoke caller-supplied callback
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
+
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
+
+		struct recordingrule item{};
+		item.recordingruleid = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+		item.type = static_cast<recordingrule_type>(sqlite3_column_int(statement, 1));
+		item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
+		item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 3));
+		item.recentonly = (sqlite3_column_int(statement, 4) != 0);
+		item.afteroriginalairdateonly = sqlite3_column_int64(statement, 5);
+		item.datetimeonly = sqlite3_column_int64(statement, 6);
+		item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 7));
+		item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
+		item.startpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 9));
+		item.endpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 10));
+
+		callback(item);						// Invoke caller-supplied callback
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -1986,7 +2163,6 @@ void enumerate_recordingrules(sqlite3* instance, enumerate_recordingrules_callba
 
 void enumerate_sd_channelids(sqlite3* instance, bool showdrm, enumerate_channelids_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -1996,28 +2172,21 @@ void enumerate_sd_channelids(sqlite3* instance, bool showdrm, enumerate_channeli
 		"from lineup, json_each(lineup.data) as entry where json_extract(entry.value, '$.HD') is null "
 		"and nullif(json_extract(entry.value, '$.DRM'), ?1) is null";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, (showdrm) ? 1 : 0);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
 
-			union channelid channelid{};
-			channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
-			
-			callback(channelid);
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+		union channelid channelid{};
+		channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+		
+		callback(channelid);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -2084,7 +2253,6 @@ void enumerate_series(sqlite3* instance, char const* deviceauth, char const* tit
 
 void enumerate_timers(sqlite3* instance, int maxdays, enumerate_timers_callback const& callback)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							result;				// Result from SQLite function
 	
 	if((instance == nullptr) || (callback == nullptr)) return;
@@ -2117,38 +2285,31 @@ void enumerate_timers(sqlite3* instance, int maxdays, enumerate_timers_callback
 		"(json_extract(value, '$.RecordingRuleExt') like 'RecordIfNotRecorded' and json_extract(value, '$.ProgramID') not in recorded)) and "
 		"(starttime < (cast(strftime('%s', 'now') as integer) + (?1 * 86400)))";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Bind the query parameter(s)
-		result = sqlite3_bind_int(statement, 1, maxdays);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
-
-		// Execute the query and iterate over all returned rows
-		while(sqlite3_step(statement) == SQLITE_ROW) {
-
-			struct timer item{};
-			item.recordingruleid = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
-			item.parenttype = static_cast<enum recordingrule_type>(sqlite3_column_int(statement, 1));
-			item.timerid = static_cast<unsigned int>(sqlite3_column_int(statement, 2));
-			item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 3));
-			item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 4));
-			item.starttime = sqlite3_column_int64(statement, 5);
-			item.endtime = sqlite3_column_int64(statement, 6);
-			item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 7));
-			item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
-			item.startpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 9));
-			item.endpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 10));
+	// Bind the query parameter(s)
+	result = sqlite3_bind_int(statement, 1, maxdays);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-			callback(item);						// Invoke caller-supplied callback
-		}
-	
-		sqlite3_finalize(statement);			// Finalize the SQLite statement
+	// Execute the query and iterate over all returned rows
+	while(sqlite3_step(statement) == SQLITE_ROW) {
+
+		struct timer item{};
+		item.recordingruleid = static_cast<unsigned int>(sqlite3_column_int(statement, 0));
+		item.parenttype = static_cast<enum recordingrule_type>(sqlite3_column_int(statement, 1));
+		item.timerid = static_cast<unsigned int>(sqlite3_column_int(statement, 2));
+		item.channelid.value = static_cast<unsigned int>(sqlite3_column_int(statement, 3));
+		item.seriesid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 4));
+		item.starttime = sqlite3_column_int64(statement, 5);
+		item.endtime = sqlite3_column_int64(statement, 6);
+		item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 7));
+		item.synopsis = reinterpret_cast<char const*>(sqlite3_column_text(statement, 8));
+		item.startpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 9));
+		item.endpadding = static_cast<unsigned int>(sqlite3_column_int(statement, 10));
+
+		callback(item);						// Invoke caller-supplied callback
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -2215,7 +2376,6 @@ static int execute_non_query(sqlite3* instance, char const* sql, _parameters&&..
 template<typename... _parameters>
 static int execute_scalar_int(sqlite3* instance, char const* sql, _parameters&&... parameters)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							paramindex = 1;		// Bound parameter index value
 	int							value = 0;			// Result from the scalar function
 
@@ -2225,30 +2385,21 @@ static int execute_scalar_int(sqlite3* instance, char const* sql, _parameters&&.
 	// Suppress unreferenced local variable warning when there are no parameters to bind
 	(void)paramindex;
 
-	// Prepare the statement
-	int result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Bind the provided query parameter(s) by unpacking the parameter pack
-		int unpack[] = { 0, (static_cast<void>(bind_parameter(statement, paramindex, parameters)), 0) ... };
-		(void)unpack;
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the query; only the first row returned will be used
-		result = sqlite3_step(statement);
+	// Bind the provided query parameter(s) by unpacking the parameter pack
+	int unpack[] = { 0, (static_cast<void>(bind_parameter(statement, paramindex, parameters)), 0) ... };
+	(void)unpack;
 
-		if(result == SQLITE_ROW) value = sqlite3_column_int(statement, 0);
-		else if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-		// Finalize the statement
-		sqlite3_finalize(statement);
+	// Execute the query; only the first row returned will be used
+	int result = sqlite3_step(statement);
 
-		// Return the resultant value from the scalar query
-		return value;
-	}
+	if(result == SQLITE_ROW) value = sqlite3_column_int(statement, 0);
+	else if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
 
-	catch(...) { sqlite3_finalize(statement); throw; }
+	// Return the resultant value from the scalar query
+	return value;
 }
 
 //---------------------------------------------------------------------------
@@ -2265,7 +2416,6 @@ static int execute_scalar_int(sqlite3* instance, char const* sql, _parameters&&.
 template<typename... _parameters>
 static int64_t execute_scalar_int64(sqlite3* instance, char const* sql, _parameters&&... parameters)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							paramindex = 1;		// Bound parameter index value
 	int64_t						value = 0;			// Result from the scalar function
 
@@ -2275,30 +2425,21 @@ static int64_t execute_scalar_int64(sqlite3* instance, char const* sql, _paramet
 	// Suppress unreferenced local variable warning when there are no parameters to bind
 	(void)paramindex;
 
-	// Prepare the statement
-	int result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Bind the provided query parameter(s) by unpacking the parameter pack
-		int unpack[] = { 0, (static_cast<void>(bind_parameter(statement, paramindex, parameters)), 0) ... };
-		(void)unpack;
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the query; only the first row returned will be used
-		result = sqlite3_step(statement);
+	// Bind the provided query parameter(s) by unpacking the parameter pack
+	int unpack[] = { 0, (static_cast<void>(bind_parameter(statement, paramindex, parameters)), 0) ... };
+	(void)unpack;
 
-		if(result == SQLITE_ROW) value = sqlite3_column_int64(statement, 0);
-		else if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Execute the query; only the first row returned will be used
+	int result = sqlite3_step(statement);
 
-		// Finalize the statement
-		sqlite3_finalize(statement);
+	if(result == SQLITE_ROW) value = sqlite3_column_int64(statement, 0);
+	else if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
 
-		// Return the resultant value from the scalar query
-		return value;
-	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
+	// Return the resultant value from the scalar query
+	return value;
 }
 
 //---------------------------------------------------------------------------
@@ -2315,7 +2456,6 @@ static int64_t execute_scalar_int64(sqlite3* instance, char const* sql, _paramet
 template<typename... _parameters>
 static std::string execute_scalar_string(sqlite3* instance, char const* sql, _parameters&&... parameters)
 {
-	sqlite3_stmt*				statement;			// SQL statement to execute
 	int							paramindex = 1;		// Bound parameter index value
 	std::string					value;				// Result from the scalar function
 
@@ -2325,34 +2465,25 @@ static std::string execute_scalar_string(sqlite3* instance, char const* sql, _pa
 	// Suppress unreferenced local variable warning when there are no parameters to bind
 	(void)paramindex;
 
-	// Prepare the statement
-	int result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-	try {
+	// Bind the provided query parameter(s) by unpacking the parameter pack
+	int unpack[] = { 0, (static_cast<void>(bind_parameter(statement, paramindex, parameters)), 0) ... };
+	(void)unpack;
 
-		// Bind the provided query parameter(s) by unpacking the parameter pack
-		int unpack[] = { 0, (static_cast<void>(bind_parameter(statement, paramindex, parameters)), 0) ... };
-		(void)unpack;
-
-		// Execute the query; only the first row returned will be used
-		result = sqlite3_step(statement);
-
-		if(result == SQLITE_ROW) {
-
-			char const* ptr = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			if(ptr != nullptr) value.assign(ptr);
-		}
-		else if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Execute the query; only the first row returned will be used
+	int result = sqlite3_step(statement);
 
-		// Finalize the statement
-		sqlite3_finalize(statement);
+	if(result == SQLITE_ROW) {
 
-		// Return the resultant value from the scalar query
-		return value;
+		char const* ptr = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		if(ptr != nullptr) value.assign(ptr);
 	}
+	else if(result != SQLITE_DONE) throw sqlite_exception(result, sqlite3_errmsg(instance));
 
-	catch(...) { sqlite3_finalize(statement); throw; }
+	// Return the resultant value from the scalar query
+	return value;
 }
 
 //---------------------------------------------------------------------------
@@ -2404,8 +2535,9 @@ std::string find_seriesid(sqlite3* instance, char const* deviceauth, char const*
 //
 //	instance		- SQLite database instance
 //	path			- Location where the diagnostic file will be written
+//	streamtelemetry	- JSON telemetry of the most recent stream, or null
 
-void generate_discovery_diagnostic_file(sqlite3* instance, char const* path)
+void generate_discovery_diagnostic_file(sqlite3* instance, char const* path, char const* streamtelemetry)
 {
 	if(instance == nullptr || path == nullptr) return;
 
@@ -2479,6 +2611,10 @@ void generate_discovery_diagnostic_file(sqlite3* instance, char const* path)
 		execute_non_query(instance, "update discovery_diagnostics set data = json_remove(data, '$.DeviceAuth') where type = 'device'");
 		execute_non_query(instance, "update discovery_diagnostics set data = json_remove(data, '$.AccountEmail') where type = 'account'");
 
+		// STREAM TELEMETRY
+		//
+		if(streamtelemetry != nullptr) execute_non_query(instance, "insert into discovery_diagnostics values('streamtelemetry', null, ?1)", streamtelemetry);
+
 		// Create the output .zip file as a temporary virtual table [hdhomerundvr-diag-yyyymmdd-hhmmss.zip]
 		execute_non_query(instance, "drop table if exists temp.diagnostics_file");
 		std::string zipfile = execute_scalar_string(instance, "select ?1 || '/hdhomerundvr-diag-' || strftime('%Y%m%d-%H%M%S') || '.zip'", path);
@@ -2826,7 +2962,6 @@ std::string get_recordingrule_seriesid(sqlite3* instance, unsigned int recording
 
 void get_signal_status(sqlite3* instance, union channelid channelid, signal_status_callback const& callback)
 {
-	sqlite3_stmt*				statement;				// Database query statement
 	std::vector<std::string>	urls;					// Generated vector<> of URLs
 	int							result;					// Result from SQLite function call
 
@@ -2856,43 +2991,36 @@ void get_signal_status(sqlite3* instance, union channelid channelid, signal_stat
 		"from metadata, json_each(json_get(metadata.url)) as signaldata "
 		"where json_extract(signaldata.value, '$.VctNumber') = decode_channel_id(?1) limit 1";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, channelid.value);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the SQL statement
-		result = sqlite3_step(statement);
-		if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, channelid.value);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Process only the first row returned from the query
-		if(result == SQLITE_ROW) {
-			
-			struct signal_status status{};
-
-			status.deviceid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			status.friendlyname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
-			status.modelnumber = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
-			status.resource = reinterpret_cast<char const*>(sqlite3_column_text(statement, 3));
-			status.vctnumber = reinterpret_cast<char const*>(sqlite3_column_text(statement, 4));
-			status.vctname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 5));
-			status.modulation = reinterpret_cast<char const*>(sqlite3_column_text(statement, 6));
-			status.frequency = sqlite3_column_int64(statement, 7);
-			status.program = sqlite3_column_int(statement, 8);
-			status.signalstrength = sqlite3_column_int(statement, 9);
-			status.signalquality = sqlite3_column_int(statement, 10);
-
-			callback(status);
-		}
+	// Execute the SQL statement
+	result = sqlite3_step(statement);
+	if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
 
-		sqlite3_finalize(statement);				// Finalize the SQLite statement
+	// Process only the first row returned from the query
+	if(result == SQLITE_ROW) {
+		
+		struct signal_status status{};
+
+		status.deviceid = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		status.friendlyname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 1));
+		status.modelnumber = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
+		status.resource = reinterpret_cast<char const*>(sqlite3_column_text(statement, 3));
+		status.vctnumber = reinterpret_cast<char const*>(sqlite3_column_text(statement, 4));
+		status.vctname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 5));
+		status.modulation = reinterpret_cast<char const*>(sqlite3_column_text(statement, 6));
+		status.frequency = sqlite3_column_int64(statement, 7);
+		status.program = sqlite3_column_int(statement, 8);
+		status.signalstrength = sqlite3_column_int(statement, 9);
+		status.signalquality = sqlite3_column_int(statement, 10);
+
+		callback(status);
 	}
-
-	catch(...) { sqlite3_finalize(statement); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -2907,7 +3035,6 @@ void get_signal_status(sqlite3* instance, union channelid channelid, signal_stat
 
 std::vector<std::string> get_storage_stream_urls(sqlite3* instance, union channelid channelid)
 {
-	sqlite3_stmt*				statement;				// Database query statement
 	std::vector<std::string>	urls;					// Generated vector<> of URLs
 	int							result;					// Result from SQLite function call
 
@@ -2917,33 +3044,26 @@ std::vector<std::string> get_storage_stream_urls(sqlite3* instance, union channe
 	auto sql = "select json_extract(device.data, '$.BaseURL') || '/auto/v' || decode_channel_id(?1) || '?ClientID=' || (select clientid from client limit 1) "
 		"|| '&SessionID=0x' || hex(randomblob(4)) from device where json_extract(device.data, '$.StorageURL') is not null order by json_extract(device.data, '$.StorageID') asc";
 
-	result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
-	if(result != SQLITE_OK) throw sqlite_exception(result, sqlite3_errmsg(instance));
-
-	try {
-
-		// Bind the query parameters
-		result = sqlite3_bind_int(statement, 1, channelid.value);
-		if(result != SQLITE_OK) throw sqlite_exception(result);
+	// Prepare the statement, reusing the previously prepared instance if one has been cached
+	preparedstatement statement(instance, sql);
 
-		// Execute the SQL statement
-		result = sqlite3_step(statement);
-		if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
+	// Bind the query parameters
+	result = sqlite3_bind_int(statement, 1, channelid.value);
+	if(result != SQLITE_OK) throw sqlite_exception(result);
 
-		// Process each row returned from the query
-		while(result == SQLITE_ROW) {
+	// Execute the SQL statement
+	result = sqlite3_step(statement);
+	if((result != SQLITE_DONE) && (result != SQLITE_ROW)) throw sqlite_exception(result, sqlite3_errmsg(instance));
 
-			char const* url = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
-			if(url != nullptr) urls.emplace_back(url);
+	// Process each row returned from the query
+	while(result == SQLITE_ROW) {
 
-			result = sqlite3_step(statement);		// Move to the next row of data
-		}
+		char const* url = reinterpret_cast<char const*>(sqlite3_column_text(statement, 0));
+		if(url != nullptr) urls.emplace_back(url);
 
-		sqlite3_finalize(statement);				// Finalize the SQLite statement
+		result = sqlite3_step(statement);		// Move to the next row of data
 	}
 
-	catch(...) { sqlite3_finalize(statement); throw; }
-
 	return urls;
 }
 
@@ -3241,10 +3361,10 @@ sqlite3* open_database(char const* connstring, int flags, bool initialize)
 
 			// table: listing
 			//
-			// channelid | starttime | endtime | seriesid | title | episodename | synopsis | year | originalairdate | iconurl | programtype | primarygenre | genres | episodenumber | isnew | isrepeat | islive | starrating
+			// channelid | starttime | endtime | seriesid | title | episodename | synopsis | year | originalairdate | iconurl | programtype | primarygenre | genres | episodenumber | isnew | isrepeat | islive | starrating | hash | discovered
 			execute_non_query(instance, "create table if not exists listing(channelid text not null, starttime integer not null, endtime integer not null, seriesid text, title text, "
 				"episodename text, synopsis text, year integer, originalairdate text, iconurl text, programtype text, primarygenre text, genres text, episodenumber text, isnew integer, "
-				"isrepeat integer, islive integer, starrating text)");
+				"isrepeat integer, islive integer, starrating text, hash integer, discovered integer not null)");
 			execute_non_query(instance, "create index if not exists listing_channelid_starttime_endtime_index on listing(channelid, starttime, endtime)");
 
 			// table: recording
@@ -100,7 +100,8 @@ using signal_status_callback = std::function<void(struct signal_status const& st
 //---------------------------------------------------------------------------
 // connectionpool
 //
-// Implements a connection pool for the SQLite database connections
+// Implements a connection pool for the SQLite database connections; each pooled
+// connection has its own cache of prepared statements
 
 class connectionpool
 {
@@ -231,7 +232,7 @@ void discover_lineups(sqlite3* instance, bool& changed);
 //
 // Reloads the information about the available listings
 void discover_listings(sqlite3* instance, char const* deviceauth);
-void discover_listings(sqlite3* instance, char const* deviceauth, bool& changed);
+void discover_listings(sqlite3* instance, char const* deviceauth, bool& changed, std::vector<struct listingid>& removed);
 
 // discover_recordingrules
 //
@@ -288,7 +289,7 @@ void enumerate_hevc_channelids(sqlite3* instance, bool showdrm, enumerate_channe
 // enumerate_listings
 //
 // Enumerates the available listings in the database
-void enumerate_listings(sqlite3* instance, bool showdrm, int maxdays, enumerate_listings_callback const& callback);
+void enumerate_listings(sqlite3* instance, bool showdrm, int maxdays, time_t since, enumerate_listings_callback const& callback);
 void enumerate_listings(sqlite3* instance, bool showdrm, union channelid channelid, time_t starttime, time_t endtime, enumerate_listings_callback const& callback);
 
 // enumerate_recordings
@@ -320,7 +321,7 @@ void enumerate_timers(sqlite3* instance, int maxdays, enumerate_timers_callback
 // generate_discovery_diagnostic_file
 //
 // Generates a zip file containing all of the discovery information for diagnostic purposes
-void generate_discovery_diagnostic_file(sqlite3* instance, char const* path);
+void generate_discovery_diagnostic_file(sqlite3* instance, char const* path, char const* streamtelemetry);
 
 // find_seriesid
 //
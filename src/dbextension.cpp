@@ -23,20 +23,27 @@
 #include "stdafx.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <inttypes.h>
 #include <kodi/addon-instance/PVR.h>
-#include <libxml/xmlreader.h>
+#include <libxml/parser.h>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <sqlite3ext.h>
 #include <string>
+#include <thread>
 #include <vector>
 #include <version.h>
 
@@ -75,6 +82,20 @@ int xmltv_next(sqlite3_vtab_cursor* cursor);
 int xmltv_open(sqlite3_vtab* vtab, sqlite3_vtab_cursor** cursor);
 int xmltv_rowid(sqlite3_vtab_cursor* cursor, sqlite_int64* rowid);
 
+//---------------------------------------------------------------------------
+// CONSTANTS
+//---------------------------------------------------------------------------
+
+// XMLTV_BATCH_COUNT
+//
+// Number of batches that can be in flight between the xmltv worker thread and SQLite
+static size_t const XMLTV_BATCH_COUNT = 4;
+
+// XMLTV_BATCH_SIZE
+//
+// Number of <programme> elements that are passed to SQLite in each batch
+static size_t const XMLTV_BATCH_SIZE = 256;
+
 //---------------------------------------------------------------------------
 // TYPE DECLARATIONS
 //---------------------------------------------------------------------------
@@ -129,6 +150,45 @@ enum class xmltv_vtab_columns {
 	starrating,				// starrating text
 };
 
+// xmltv_text
+//
+// Nullable text value parsed from an XMLTV element; the string retains its capacity when reused
+struct xmltv_text {
+
+	bool				null = true;			// Flag indicating a NULL value
+	std::string			value;					// Text value
+};
+
+// xmltv_channel_record
+//
+// Values parsed from an XMLTV <channel> element
+struct xmltv_channel_record {
+
+	struct xmltv_text	id;						// id attribute
+	struct xmltv_text	number;					// <lcn> element
+	struct xmltv_text	name;					// First <display-name> element
+	struct xmltv_text	altname;				// Fifth <display-name> element
+	struct xmltv_text	network;				// Sixth <display-name> element
+	struct xmltv_text	iconsrc;				// <icon> element src attribute
+};
+
+// xmltv_programme_record
+//
+// Values parsed from an XMLTV <programme> element, indexed by xmltv_vtab_columns
+using xmltv_programme_record = std::array<struct xmltv_text, static_cast<size_t>(xmltv_vtab_columns::starrating) + 1>;
+
+// xmltv_batch
+//
+// Batch of parsed XMLTV elements passed from the xmltv worker thread to SQLite; batches
+// are recycled rather than reallocated so the records are only ever constructed once
+struct xmltv_batch {
+
+	std::vector<struct xmltv_channel_record>	channels;				// Parsed <channel> elements
+	size_t										channelcount = 0;		// Number of valid channels
+	std::vector<xmltv_programme_record>			programmes;				// Parsed <programme> elements
+	size_t										programmecount = 0;		// Number of valid programmes
+};
+
 // xmltv_vtab
 //
 // Subclassed version of sqlite3_vtab for the xmltv virtual table
@@ -160,84 +220,42 @@ struct xmltv_vtab_cursor : public sqlite3_vtab_cursor
 	bool						eof = false;			// EOF flag
 	channelmap_t				channelmap;				// Channel mapping collection
 	std::unique_ptr<xmlstream>	stream;					// xmlstream instance
-	xmlParserInputBufferPtr		buffer = nullptr;		// xmlParserInputBuffer instance
-	xmlTextReaderPtr			reader = nullptr;		// xmlTextReader instance
-};
 
-//---------------------------------------------------------------------------
-// LIBXML2 HELPER FUNCTIONS
-//---------------------------------------------------------------------------
-
-// xmlNodeGetChildElement (local)
-//
-// Helper method to access a child element of the specified XML node
-static xmlNodePtr xmlNodeGetChildElement(xmlNodePtr node, xmlChar const* element)
-{
-	if((node == nullptr) || (element == nullptr)) return nullptr;
-
-	node = node->children;
-	while((node != nullptr) && (xmlStrcmp(node->name, element) != 0)) node = node->next;
-	return node;
+	std::thread					worker;					// Download and parse worker thread
+	std::mutex					lock;					// Synchronization object
+	std::condition_variable		cv;						// Batch queue condition variable
+	std::atomic<bool>			stop{ false };			// Flag to stop the worker thread
+	bool						done = false;			// Flag that the worker thread has finished
+	int							status = SQLITE_OK;		// Final worker thread result code
+	std::string					error;					// Final worker thread error message
+	std::deque<std::unique_ptr<struct xmltv_batch>>		ready;		// Batches ready to be consumed
+	std::vector<std::unique_ptr<struct xmltv_batch>>	spare;		// Batches available to be filled
+	std::unique_ptr<struct xmltv_batch>					batch;		// Batch being consumed
+	size_t						index = 0;				// Current programme within the batch
 };
 
-// xmlTextReaderForEachChildElement (local)
-//
-// Helper method to iterate over each child element of the current XML reader element
-static void xmlTextReaderForEachChildElement(xmlTextReaderPtr reader, xmlChar const* element, std::function<void(xmlNodePtr)> const& callback)
-{
-	if((reader == nullptr) || (element == nullptr)) return;
-
-	xmlNodePtr node = xmlTextReaderExpand(reader);
-	if(node != nullptr) node = node->children;
-
-	while(node != nullptr) {
-
-		if(xmlStrcmp(node->name, element) == 0) callback(node);
-		node = node->next;
-	}
-}
-
-// xmlTextReaderGetChildElement (local)
+// xmltv_parser_state
 //
-// Helper method to access a child element of the current XML reader element
-static xmlNodePtr xmlTextReaderGetChildElement(xmlTextReaderPtr reader, xmlChar const* element)
+// State of the SAX2 push parser used by the xmltv worker thread
+struct xmltv_parser_state
 {
-	if((reader == nullptr) || (element == nullptr)) return nullptr;
-
-	xmlNodePtr node = xmlTextReaderExpand(reader);
-	if(node != nullptr) node = node->children;
-
-	while((node != nullptr) && (xmlStrcmp(node->name, element) != 0)) node = node->next;
-	return node;
-};
-
-// xmlTextReaderGetChildElementWithAttribute (local)
-//
-// Helper method to access a child element of the current XML reader element
-static xmlNodePtr xmlTextReaderGetChildElementWithAttribute(xmlTextReaderPtr reader, xmlChar const* element, xmlChar const* attribute, xmlChar const* value)
-{
-	if((reader == nullptr) || (element == nullptr) || (attribute == nullptr)) return nullptr;
-
-	xmlNodePtr node = xmlTextReaderExpand(reader);
-	if(node != nullptr) node = node->children;
-
-	while(node != nullptr) {
-
-		if(xmlStrcmp(node->name, element) == 0) {
-
-			xmlChar* prop = xmlGetProp(node, attribute);
-			if(prop != nullptr) {
-
-				int comparison = xmlStrcmp(prop, value);
-				xmlFree(prop);
-				if(comparison == 0) return node;
-			}
-		}
-
-		node = node->next;
-	}
-
-	return node;
+	xmltv_vtab_cursor*					cursor = nullptr;			// Owning cursor instance
+	xmlParserCtxtPtr					context = nullptr;			// Push parser context
+	std::unique_ptr<struct xmltv_batch>	batch;						// Batch being filled
+	std::exception_ptr					exception;					// Exception thrown by a callback
+	int									depth = 0;					// Current element depth
+	int									elementdepth = 0;			// Depth of <channel>/<programme>
+	struct xmltv_channel_record*		channel = nullptr;			// <channel> record being filled
+	xmltv_programme_record*				programme = nullptr;		// <programme> record being filled
+	size_t								displaynames = 0;			// Number of <display-name> elements
+	size_t								categories = 0;				// Number of <category> elements
+	size_t								starratings = 0;			// Number of <star-rating> elements
+	bool								instarrating = false;		// Flag if in first <star-rating>
+	bool								cseries = false;			// Flag if cseries <series-id> found
+	bool								capture = false;			// Flag if capturing character data
+	int									capturedepth = 0;			// Depth of the captured element
+	bool								capturecseries = false;		// Flag if capturing cseries <series-id>
+	std::string							text;						// Captured character data
 };
 
 //---------------------------------------------------------------------------
@@ -339,6 +357,90 @@ static sqlite3_module g_xmltv_module = {
 // HELPER FUNCTIONS
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// assign_xmltv_text (local)
+//
+// Assigns a value to an xmltv_text value, reusing the existing string capacity
+//
+// Arguments:
+//
+//	text		- xmltv_text value to be assigned
+//	value		- Value to assign, or nullptr to assign NULL
+//	length		- Length of the value to assign
+
+static void assign_xmltv_text(struct xmltv_text& text, char const* value, size_t length)
+{
+	text.null = (value == nullptr);
+
+	if(value != nullptr) text.value.assign(value, length);
+	else text.value.clear();
+}
+
+//-----------------------------------------------------------------------------
+// assign_xmltv_text (local)
+//
+// Assigns a value to an xmltv_text value, reusing the existing string capacity
+//
+// Arguments:
+//
+//	text		- xmltv_text value to be assigned
+//	value		- Value to assign
+
+static void assign_xmltv_text(struct xmltv_text& text, std::string const& value)
+{
+	text.null = false;
+	text.value.assign(value);
+}
+
+//-----------------------------------------------------------------------------
+// assign_xmltv_attribute (local)
+//
+// Assigns the value of a SAX2 element attribute to an xmltv_text value
+//
+// Arguments:
+//
+//	text		- xmltv_text value to be assigned; NULL if the attribute is not present
+//	count		- Number of SAX2 element attributes
+//	attributes	- SAX2 element attributes (localname, prefix, uri, value, end)
+//	name		- Local name of the attribute
+
+static void assign_xmltv_attribute(struct xmltv_text& text, int count, xmlChar const** attributes, char const* name)
+{
+	for(int index = 0; index < count; index++, attributes += 5) {
+
+		if(xmlStrcmp(attributes[0], BAD_CAST(name)) == 0)
+			return assign_xmltv_text(text, reinterpret_cast<char const*>(attributes[3]), static_cast<size_t>(attributes[4] - attributes[3]));
+	}
+
+	assign_xmltv_text(text, nullptr, 0);
+}
+
+//-----------------------------------------------------------------------------
+// compare_xmltv_attribute (local)
+//
+// Determines if a SAX2 element attribute is present and has the specified value
+//
+// Arguments:
+//
+//	count		- Number of SAX2 element attributes
+//	attributes	- SAX2 element attributes (localname, prefix, uri, value, end)
+//	name		- Local name of the attribute
+//	value		- Value to compare against the attribute
+
+static bool compare_xmltv_attribute(int count, xmlChar const** attributes, char const* name, char const* value)
+{
+	for(int index = 0; index < count; index++, attributes += 5) {
+
+		if(xmlStrcmp(attributes[0], BAD_CAST(name)) == 0) {
+
+			size_t const length = static_cast<size_t>(attributes[4] - attributes[3]);
+			return ((length == strlen(value)) && (memcmp(attributes[3], value, length) == 0));
+		}
+	}
+
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // format_proxy_address (local)
 //
@@ -369,6 +471,434 @@ static std::string format_proxy_address(void)
 	return formatted;
 }
 
+//-----------------------------------------------------------------------------
+// xmltv_acquire_batch (local)
+//
+// Waits for an empty batch to become available to the xmltv worker thread; there are
+// a fixed number of batches so this keeps the worker thread from getting too far ahead
+//
+// Arguments:
+//
+//	cursor		- Virtual table cursor instance
+
+static std::unique_ptr<struct xmltv_batch> xmltv_acquire_batch(xmltv_vtab_cursor* cursor)
+{
+	assert(cursor != nullptr);
+
+	std::unique_lock<std::mutex> lock(cursor->lock);
+	cursor->cv.wait(lock, [&]() -> bool { return (cursor->stop) || (!cursor->spare.empty()); });
+
+	// A null batch is returned if the worker thread has been asked to stop
+	if(cursor->stop) return nullptr;
+
+	std::unique_ptr<struct xmltv_batch> batch = std::move(cursor->spare.back());
+	cursor->spare.pop_back();
+
+	batch->channelcount = 0;
+	batch->programmecount = 0;
+
+	return batch;
+}
+
+//-----------------------------------------------------------------------------
+// xmltv_queue_batch (local)
+//
+// Queues a filled batch from the xmltv worker thread to be consumed by SQLite
+//
+// Arguments:
+//
+//	cursor		- Virtual table cursor instance
+//	batch		- Batch to be queued
+
+static void xmltv_queue_batch(xmltv_vtab_cursor* cursor, std::unique_ptr<struct xmltv_batch> batch)
+{
+	assert(cursor != nullptr);
+
+	std::unique_lock<std::mutex> lock(cursor->lock);
+	cursor->ready.push_back(std::move(batch));
+	cursor->cv.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// xmltv_sax_characters (local)
+//
+// SAX2 callback for character and CDATA data in the XMLTV document
+//
+// Arguments:
+//
+//	context		- xmltv_parser_state instance
+//	characters	- Character data (not null-terminated)
+//	length		- Length of the character data
+
+static void xmltv_sax_characters(void* context, xmlChar const* characters, int length)
+{
+	struct xmltv_parser_state* state = reinterpret_cast<struct xmltv_parser_state*>(context);
+	assert(state != nullptr);
+
+	// Character data is only collected for an element that is being captured
+	if(!state->capture) return;
+
+	try { state->text.append(reinterpret_cast<char const*>(characters), static_cast<size_t>(length)); }
+	catch(...) { state->exception = std::current_exception(); xmlStopParser(state->context); }
+}
+
+//-----------------------------------------------------------------------------
+// xmltv_sax_endelement (local)
+//
+// SAX2 callback for the end of an element in the XMLTV document
+//
+// Arguments:
+//
+//	context		- xmltv_parser_state instance
+//	localname	- Local name of the element
+//	prefix		- Namespace prefix of the element
+//	uri			- Namespace URI of the element
+
+static void xmltv_sax_endelement(void* context, xmlChar const* localname, xmlChar const* /*prefix*/, xmlChar const* /*uri*/)
+{
+	struct xmltv_parser_state* state = reinterpret_cast<struct xmltv_parser_state*>(context);
+	assert(state != nullptr);
+
+	int const depth = state->depth--;
+	if(!state->batch) return;
+
+	try {
+
+		// Captured <channel> child elements
+		if((state->capture) && (depth == state->capturedepth) && (state->channel != nullptr)) {
+
+			state->capture = false;
+
+			// The virtual channel number is in the <lcn> element
+			if(xmlStrcmp(localname, BAD_CAST("lcn")) == 0) {
+
+				if(state->channel->number.null) assign_xmltv_text(state->channel->number, state->text);
+			}
+
+			// Process the <display-name> elements that are present for this channel
+			//
+			// [0] - GUIDENAME
+			// [1] - CHANNELNUMBER GUIDENAME
+			// [2] - CHANNELNUMBER ALTERNATEGUIDENAME
+			// [3] - CHANNELNUMBER
+			// [4] - ALTERNATEGUIDENAME
+			// [5] - NETWORKNAME
+			else if(xmlStrcmp(localname, BAD_CAST("display-name")) == 0) {
+
+				size_t index = state->displaynames++;
+				if(index == 0) assign_xmltv_text(state->channel->name, state->text);
+				else if(index == 4) assign_xmltv_text(state->channel->altname, state->text);
+				else if(index == 5) assign_xmltv_text(state->channel->network, state->text);
+			}
+		}
+
+		// Captured <programme> child elements
+		else if((state->capture) && (depth == state->capturedepth) && (state->programme != nullptr)) {
+
+			xmltv_programme_record& programme = *state->programme;
+			state->capture = false;
+
+			// assign_first (local)
+			//
+			// Assigns the captured text to a column unless an earlier element has already been assigned
+			auto assign_first = [&](xmltv_vtab_columns column) -> void {
+
+				struct xmltv_text& text = programme[static_cast<size_t>(column)];
+				if(text.null) assign_xmltv_text(text, state->text);
+			};
+
+			if(xmlStrcmp(localname, BAD_CAST("title")) == 0) assign_first(xmltv_vtab_columns::title);
+			else if(xmlStrcmp(localname, BAD_CAST("sub-title")) == 0) assign_first(xmltv_vtab_columns::subtitle);
+			else if(xmlStrcmp(localname, BAD_CAST("desc")) == 0) assign_first(xmltv_vtab_columns::desc);
+			else if(xmlStrcmp(localname, BAD_CAST("date")) == 0) assign_first(xmltv_vtab_columns::date);
+			else if(xmlStrcmp(localname, BAD_CAST("language")) == 0) assign_first(xmltv_vtab_columns::language);
+			else if(xmlStrcmp(localname, BAD_CAST("episode-num")) == 0) assign_first(xmltv_vtab_columns::episodenum);
+			else if(xmlStrcmp(localname, BAD_CAST("value")) == 0) assign_first(xmltv_vtab_columns::starrating);
+
+			// Special case: the first <category> element is the progType, the rest are concatenated into a comma-delimited string
+			else if(xmlStrcmp(localname, BAD_CAST("category")) == 0) {
+
+				if(state->categories++ == 0) assign_first(xmltv_vtab_columns::programtype);
+				else {
+
+					struct xmltv_text& categories = programme[static_cast<size_t>(xmltv_vtab_columns::categories)];
+					if(!categories.value.empty()) categories.value.append(",");
+					categories.value.append(state->text);
+				}
+			}
+
+			// Special case: the series-id tag will typically be qualified with system=cseries, but some items like Movies (programtype MV) will
+			// not be qualified with that attribute.  Use the first system=cseries node if there is one, otherwise use the first series-id node
+			else if(xmlStrcmp(localname, BAD_CAST("series-id")) == 0) {
+
+				if((state->capturecseries) && (!state->cseries)) {
+
+					assign_xmltv_text(programme[static_cast<size_t>(xmltv_vtab_columns::seriesid)], state->text);
+					state->cseries = true;
+				}
+
+				else assign_first(xmltv_vtab_columns::seriesid);
+			}
+		}
+
+		// End of the <star-rating> element that may have provided the <value> to capture
+		if((state->programme != nullptr) && (depth == state->elementdepth + 1)) state->instarrating = false;
+
+		// End of a <channel> element; the record remains in the batch for the callback
+		if((state->channel != nullptr) && (depth == state->elementdepth)) {
+
+			state->channel = nullptr;
+			++state->batch->channelcount;
+		}
+
+		// End of a <programme> element; this is the next row for the result set
+		else if((state->programme != nullptr) && (depth == state->elementdepth)) {
+
+			struct xmltv_text& categories = (*state->programme)[static_cast<size_t>(xmltv_vtab_columns::categories)];
+			categories.null = categories.value.empty();
+
+			state->programme = nullptr;
+
+			// Hand the batch off to SQLite once it's full and start filling the next one
+			if(++state->batch->programmecount == state->batch->programmes.size()) {
+
+				xmltv_queue_batch(state->cursor, std::move(state->batch));
+
+				state->batch = xmltv_acquire_batch(state->cursor);
+				if(!state->batch) xmlStopParser(state->context);
+			}
+		}
+	}
+
+	catch(...) { state->exception = std::current_exception(); xmlStopParser(state->context); }
+}
+
+//-----------------------------------------------------------------------------
+// xmltv_sax_startelement (local)
+//
+// SAX2 callback for the start of an element in the XMLTV document
+//
+// Arguments:
+//
+//	context			- xmltv_parser_state instance
+//	localname		- Local name of the element
+//	prefix			- Namespace prefix of the element
+//	uri				- Namespace URI of the element
+//	namespacecount	- Number of namespace definitions on the element
+//	namespaces		- Namespace definitions
+//	attributecount	- Number of attributes on the element
+//	defaultedcount	- Number of defaulted attributes
+//	attributes		- Attributes (localname, prefix, uri, value, end)
+
+static void xmltv_sax_startelement(void* context, xmlChar const* localname, xmlChar const* /*prefix*/, xmlChar const* /*uri*/, int /*namespacecount*/,
+	xmlChar const** /*namespaces*/, int attributecount, int /*defaultedcount*/, xmlChar const** attributes)
+{
+	struct xmltv_parser_state* state = reinterpret_cast<struct xmltv_parser_state*>(context);
+	assert(state != nullptr);
+
+	int const depth = ++state->depth;
+	if(!state->batch) return;
+
+	// capture (local)
+	//
+	// Starts capturing the character data of the current element
+	auto capture = [&]() -> void {
+
+		state->capture = true;
+		state->capturedepth = depth;
+		state->text.clear();
+	};
+
+	try {
+
+		// <channel> element - only required if there is a callback to pass it to
+		if((state->channel == nullptr) && (state->programme == nullptr)) {
+
+			if((xmlStrcmp(localname, BAD_CAST("channel")) == 0) && (state->cursor->onchannel)) {
+
+				if(state->batch->channelcount == state->batch->channels.size()) state->batch->channels.emplace_back();
+				state->channel = &state->batch->channels[state->batch->channelcount];
+
+				assign_xmltv_attribute(state->channel->id, attributecount, attributes, "id");
+				assign_xmltv_text(state->channel->number, nullptr, 0);
+				assign_xmltv_text(state->channel->name, nullptr, 0);
+				assign_xmltv_text(state->channel->altname, nullptr, 0);
+				assign_xmltv_text(state->channel->network, nullptr, 0);
+				assign_xmltv_text(state->channel->iconsrc, nullptr, 0);
+
+				state->elementdepth = depth;
+				state->displaynames = 0;
+			}
+
+			// <programme> element - reset the next record in the batch and collect the attributes
+			else if(xmlStrcmp(localname, BAD_CAST("programme")) == 0) {
+
+				state->programme = &state->batch->programmes[state->batch->programmecount];
+				for(auto& text : *state->programme) assign_xmltv_text(text, nullptr, 0);
+
+				xmltv_programme_record& programme = *state->programme;
+				assign_xmltv_attribute(programme[static_cast<size_t>(xmltv_vtab_columns::channel)], attributecount, attributes, "channel");
+				assign_xmltv_attribute(programme[static_cast<size_t>(xmltv_vtab_columns::start)], attributecount, attributes, "start");
+				assign_xmltv_attribute(programme[static_cast<size_t>(xmltv_vtab_columns::stop)], attributecount, attributes, "stop");
+
+				state->elementdepth = depth;
+				state->categories = 0;
+				state->starratings = 0;
+				state->instarrating = false;
+				state->cseries = false;
+			}
+		}
+
+		// <channel> child elements; the channel id attribute is required to process any of them
+		else if((state->channel != nullptr) && (depth == state->elementdepth + 1) && (!state->channel->id.null)) {
+
+			if(xmlStrcmp(localname, BAD_CAST("lcn")) == 0) capture();
+			else if(xmlStrcmp(localname, BAD_CAST("display-name")) == 0) capture();
+
+			// Get the icon source URL for the channel logo
+			else if((xmlStrcmp(localname, BAD_CAST("icon")) == 0) && (state->channel->iconsrc.null))
+				assign_xmltv_attribute(state->channel->iconsrc, attributecount, attributes, "src");
+		}
+
+		// <programme> child elements
+		else if((state->programme != nullptr) && (depth == state->elementdepth + 1)) {
+
+			xmltv_programme_record& programme = *state->programme;
+
+			if((xmlStrcmp(localname, BAD_CAST("title")) == 0) || (xmlStrcmp(localname, BAD_CAST("sub-title")) == 0) ||
+				(xmlStrcmp(localname, BAD_CAST("desc")) == 0) || (xmlStrcmp(localname, BAD_CAST("date")) == 0) ||
+				(xmlStrcmp(localname, BAD_CAST("language")) == 0) || (xmlStrcmp(localname, BAD_CAST("category")) == 0)) capture();
+
+			else if(xmlStrcmp(localname, BAD_CAST("series-id")) == 0) {
+
+				state->capturecseries = compare_xmltv_attribute(attributecount, attributes, "system", "cseries");
+				capture();
+			}
+
+			else if(xmlStrcmp(localname, BAD_CAST("episode-num")) == 0) {
+
+				if(compare_xmltv_attribute(attributecount, attributes, "system", "onscreen")) capture();
+			}
+
+			// Flag columns are non-NULL if the element is present at all
+			else if(xmlStrcmp(localname, BAD_CAST("new")) == 0) programme[static_cast<size_t>(xmltv_vtab_columns::isnew)].null = false;
+			else if(xmlStrcmp(localname, BAD_CAST("previously-shown")) == 0) programme[static_cast<size_t>(xmltv_vtab_columns::isrepeat)].null = false;
+			else if(xmlStrcmp(localname, BAD_CAST("live")) == 0) programme[static_cast<size_t>(xmltv_vtab_columns::islive)].null = false;
+
+			else if(xmlStrcmp(localname, BAD_CAST("icon")) == 0) {
+
+				struct xmltv_text& iconsrc = programme[static_cast<size_t>(xmltv_vtab_columns::iconsrc)];
+				if(iconsrc.null) assign_xmltv_attribute(iconsrc, attributecount, attributes, "src");
+			}
+
+			// Only the first <star-rating> element is used
+			else if(xmlStrcmp(localname, BAD_CAST("star-rating")) == 0) state->instarrating = (state->starratings++ == 0);
+		}
+
+		// <value> element of the first <programme> <star-rating> element
+		else if((state->programme != nullptr) && (depth == state->elementdepth + 2) && (state->instarrating)) {
+
+			if(xmlStrcmp(localname, BAD_CAST("value")) == 0) capture();
+		}
+	}
+
+	catch(...) { state->exception = std::current_exception(); xmlStopParser(state->context); }
+}
+
+//-----------------------------------------------------------------------------
+// xmltv_worker (local)
+//
+// Worker thread for an xmltv virtual table cursor; the XMLTV document is fed into a SAX2
+// push parser as it's received, which fills batches of records consumed by xmltv_next
+//
+// Arguments:
+//
+//	cursor		- Virtual table cursor instance
+
+static void xmltv_worker(xmltv_vtab_cursor* cursor)
+{
+	xmlSAXHandler					handler;			// SAX2 parser callbacks
+	struct xmltv_parser_state		state;				// SAX2 parser state
+
+	assert(cursor != nullptr);
+
+	memset(&handler, 0, sizeof(xmlSAXHandler));
+	handler.initialized = XML_SAX2_MAGIC;
+	handler.startElementNs = xmltv_sax_startelement;
+	handler.endElementNs = xmltv_sax_endelement;
+	handler.characters = xmltv_sax_characters;
+	handler.cdataBlock = xmltv_sax_characters;
+
+	state.cursor = cursor;
+
+	try {
+
+		// Create the push parser; no document tree is built since only the SAX2 callbacks have been provided
+		state.context = xmlCreatePushParserCtxt(&handler, &state, nullptr, 0, nullptr);
+		if(state.context == nullptr) throw string_exception(__func__, ": xmlCreatePushParserCtxt() failed");
+
+		// Entities need to be substituted, otherwise attribute values will contain the raw references
+		xmlCtxtUseOptions(state.context, XML_PARSE_NOENT | XML_PARSE_NONET);
+
+		try {
+
+			int result = XML_ERR_OK;
+
+			state.batch = xmltv_acquire_batch(cursor);
+			if(state.batch) {
+
+				// Feed the data into the parser directly from the transfer as it's received
+				bool completed = cursor->stream->transfer([&](uint8_t const* data, size_t count) -> bool {
+
+					result = xmlParseChunk(state.context, reinterpret_cast<char const*>(data), static_cast<int>(count), 0);
+					if(state.exception) std::rethrow_exception(state.exception);
+
+					return ((result == XML_ERR_OK) && (!cursor->stop));
+				});
+
+				// Terminate the document once all of the data has been received
+				if(completed) result = xmlParseChunk(state.context, nullptr, 0, 1);
+				if(state.exception) std::rethrow_exception(state.exception);
+
+				// Queue the final batch for SQLite, flagging the result of the parser
+				if(!cursor->stop) {
+
+					xmltv_queue_batch(cursor, std::move(state.batch));
+
+					std::unique_lock<std::mutex> lock(cursor->lock);
+
+					cursor->status = (result == XML_ERR_OK) ? SQLITE_OK : SQLITE_INTERNAL;
+					cursor->done = true;
+					cursor->cv.notify_all();
+				}
+			}
+
+			xmlFreeParserCtxt(state.context);
+		}
+
+		catch(...) { xmlFreeParserCtxt(state.context); throw; }
+	}
+
+	catch(std::exception const& ex) {
+
+		std::unique_lock<std::mutex> lock(cursor->lock);
+
+		cursor->status = SQLITE_ERROR;
+		cursor->error.assign(ex.what());
+		cursor->done = true;
+		cursor->cv.notify_all();
+	}
+
+	catch(...) {
+
+		std::unique_lock<std::mutex> lock(cursor->lock);
+
+		cursor->status = SQLITE_ERROR;
+		cursor->done = true;
+		cursor->cv.notify_all();
+	}
+}
+
 //---------------------------------------------------------------------------
 // clean_filename
 //
@@ -1493,9 +2023,18 @@ int xmltv_close(sqlite3_vtab_cursor* cursor)
 	xmltv_vtab_cursor* xmltvcursor = reinterpret_cast<xmltv_vtab_cursor*>(cursor);
 	assert(xmltvcursor != nullptr);
 
-	// Free the embedded text reader and input buffer instances
-	if(xmltvcursor->reader != nullptr) xmlFreeTextReader(xmltvcursor->reader);
-	if(xmltvcursor->buffer != nullptr) xmlFreeParserInputBuffer(xmltvcursor->buffer);
+	// Stop the worker thread before releasing anything that it may still be using
+	if(xmltvcursor->worker.joinable()) {
+
+		std::unique_lock<std::mutex> lock(xmltvcursor->lock);
+		xmltvcursor->stop = true;
+		xmltvcursor->cv.notify_all();
+		lock.unlock();
+
+		// The worker thread may be waiting on the transfer rather than the condition variable
+		if(xmltvcursor->stream) xmltvcursor->stream->abort();
+		xmltvcursor->worker.join();
+	}
 
 	// Ensure the underlying xmlstream instance has been closed
 	if(xmltvcursor->stream) xmltvcursor->stream->close();
@@ -1518,16 +2057,19 @@ int xmltv_close(sqlite3_vtab_cursor* cursor)
 
 int xmltv_column(sqlite3_vtab_cursor* cursor, sqlite3_context* context, int ordinal)
 {
-	xmlNodePtr			node = nullptr;			// Pointer for accessing child elements
-
 	// Cast the provided generic cursor instance back into an xmltv_vtab_cursor instance
 	xmltv_vtab_cursor* xmltvcursor = reinterpret_cast<xmltv_vtab_cursor*>(cursor);
 	assert(xmltvcursor != nullptr);
+	assert(xmltvcursor->batch);
 
 	// Assume that the result will be NULL to avoid adding this for each column test below
 	sqlite3_result_null(context);
 
-	// Extract the requested value from the current <programme> element in the XML document
+	// The current <programme> element has already been parsed into a record by the worker thread
+	xmltv_programme_record const& programme = xmltvcursor->batch->programmes[xmltvcursor->index];
+	if((ordinal < 0) || (static_cast<size_t>(ordinal) >= programme.size())) return SQLITE_OK;
+	struct xmltv_text const& text = programme[static_cast<size_t>(ordinal)];
+
 	switch(static_cast<xmltv_vtab_columns>(ordinal)) {
 
 		case xmltv_vtab_columns::uri:
@@ -1538,109 +2080,15 @@ int xmltv_column(sqlite3_vtab_cursor* cursor, sqlite3_context* context, int ordi
 		case xmltv_vtab_columns::onchannel:
 			break;
 
-		case xmltv_vtab_columns::channel:
-			sqlite3_result_text(context, reinterpret_cast<char*>(xmlTextReaderGetAttribute(xmltvcursor->reader, BAD_CAST("channel"))), -1, xmlFree); 
-			break;
-
-		case xmltv_vtab_columns::start:
-			sqlite3_result_text(context, reinterpret_cast<char*>(xmlTextReaderGetAttribute(xmltvcursor->reader, BAD_CAST("start"))), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::stop:
-			sqlite3_result_text(context, reinterpret_cast<char*>(xmlTextReaderGetAttribute(xmltvcursor->reader, BAD_CAST("stop"))), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::title:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("title"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::subtitle:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("sub-title"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::desc:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("desc"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::date:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("date"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
-		// Special case: concatenate all of the <category> element values into a comma-delimted string
-		case xmltv_vtab_columns::categories: 
-		{
-			std::string collector;				// Collector for the disparate strings
-			bool progtype = false;				// Flag to skip progType <category> element
-
-			xmlTextReaderForEachChildElement(xmltvcursor->reader, BAD_CAST("category"), [&](xmlNodePtr node) -> void {
-
-				// The first <category> element is the progType, which we don't want to use for anything
-				if(!progtype) { progtype = true; return; }
-
-				xmlChar* value = xmlNodeGetContent(node);
-				if(value != nullptr) {
-
-					if(!collector.empty()) collector.append(",");
-					collector.append(reinterpret_cast<char*>(value));
-					xmlFree(value);
-				}
-			});
-
-			if(!collector.empty()) sqlite3_result_text(context, collector.c_str(), -1, SQLITE_TRANSIENT);
-		}
-		break;
-
-		case xmltv_vtab_columns::language:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("language"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::iconsrc:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("icon"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlGetProp(node, BAD_CAST("src"))), -1, xmlFree);
-			break;
-
-		// Special case: the series-id tag will typically be qualified with system=cseries, but some items like Movies (programtype MV) will
-		// not be qualified with that attribute.  Try system=cseries first, then use any series-id node
-		case xmltv_vtab_columns::seriesid:
-			node = xmlTextReaderGetChildElementWithAttribute(xmltvcursor->reader, BAD_CAST("series-id"), BAD_CAST("system"), BAD_CAST("cseries"));
-			if(node == nullptr) node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("series-id"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::episodenum:
-			node = xmlTextReaderGetChildElementWithAttribute(xmltvcursor->reader, BAD_CAST("episode-num"), BAD_CAST("system"), BAD_CAST("onscreen"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
-		case xmltv_vtab_columns::programtype:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("category"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
-			break;
-
+		// Special case: the flag columns are either 1 or NULL depending on the presence of the element
 		case xmltv_vtab_columns::isnew:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("new"));
-			if(node != nullptr) sqlite3_result_int(context, 1);
-			break;
-
 		case xmltv_vtab_columns::isrepeat:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("previously-shown"));
-			if(node != nullptr) sqlite3_result_int(context, 1);
-			break;
-
 		case xmltv_vtab_columns::islive:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("live"));
-			if(node != nullptr) sqlite3_result_int(context, 1);
+			if(!text.null) sqlite3_result_int(context, 1);
 			break;
 
-		case xmltv_vtab_columns::starrating:
-			node = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("star-rating"));
-			if(node != nullptr) node = xmlNodeGetChildElement(node, BAD_CAST("value"));
-			if(node != nullptr) sqlite3_result_text(context, reinterpret_cast<char*>(xmlNodeGetContent(node)), -1, xmlFree);
+		default:
+			if(!text.null) sqlite3_result_text(context, text.value.c_str(), static_cast<int>(text.value.size()), SQLITE_TRANSIENT);
 			break;
 	}
 
@@ -1730,31 +2178,39 @@ int xmltv_filter(sqlite3_vtab_cursor* cursor, int /*indexnum*/, char const* /*in
 	xmltv_vtab_cursor* xmltvcursor = reinterpret_cast<xmltv_vtab_cursor*>(cursor);
 	assert(xmltvcursor != nullptr);
 
-	// input_read_callback (local)
-	//
-	// xmlParserInputBuffer callback function
-	auto input_read_callback = [](void* context, char* buffer, int len) -> int
-	{
-		xmltv_vtab_cursor* xmltvcursor = reinterpret_cast<xmltv_vtab_cursor*>(context);
-		assert(xmltvcursor != nullptr);
-
-		try { return static_cast<int>(xmltvcursor->stream->read(reinterpret_cast<uint8_t*>(buffer), len)); } 
-		catch(...) { return -1; }
-	};
+	try {
 
-	// input_close_callback (local)
-	//
-	// xmlParserInputBuffer callback function
-	auto input_close_callback = [](void* context) -> int
-	{
-		xmltv_vtab_cursor* xmltvcursor = reinterpret_cast<xmltv_vtab_cursor*>(context);
-		assert(xmltvcursor != nullptr);
-
-		xmltvcursor->stream->close();
-		return 0;
-	};
+		// xFilter can be called more than once for the same cursor; stop the worker thread from any
+		// previous call and close its stream before the state it was using is reset
+		if(xmltvcursor->worker.joinable()) {
 
-	try {
+			std::unique_lock<std::mutex> lock(xmltvcursor->lock);
+			xmltvcursor->stop = true;
+			xmltvcursor->cv.notify_all();
+			lock.unlock();
+
+			// The worker thread may be waiting on the transfer rather than the condition variable
+			if(xmltvcursor->stream) xmltvcursor->stream->abort();
+			xmltvcursor->worker.join();
+		}
+
+		if(xmltvcursor->stream) xmltvcursor->stream->close();
+
+		// Reset the cursor back to its initial state
+		xmltvcursor->stream.reset();
+		xmltvcursor->uri.clear();
+		xmltvcursor->onchannel = nullptr;
+		xmltvcursor->rowid = 0;
+		xmltvcursor->eof = false;
+		xmltvcursor->channelmap.clear();
+		xmltvcursor->stop = false;
+		xmltvcursor->done = false;
+		xmltvcursor->status = SQLITE_OK;
+		xmltvcursor->error.clear();
+		xmltvcursor->ready.clear();
+		xmltvcursor->spare.clear();
+		xmltvcursor->batch.reset();
+		xmltvcursor->index = 0;
 
 		// The uri argument must have been specified by xBestIndex
 		if(argc < 1) throw string_exception(__func__, ": invalid argument count provided by xBestIndex");
@@ -1783,9 +2239,17 @@ int xmltv_filter(sqlite3_vtab_cursor* cursor, int /*indexnum*/, char const* /*in
 		// proxy string; this disables cURL's ability to use environment variables
 		xmltvcursor->stream = xmlstream::create(uri, g_useragent.c_str(), format_proxy_address().c_str(), g_curlshare);
 
-		// Set up the xmlParserInputBuffer and the xmlTextReader instances around the XMLTV stream
-		xmltvcursor->buffer = xmlParserInputBufferCreateIO(input_read_callback, input_close_callback, xmltvcursor, xmlCharEncoding::XML_CHAR_ENCODING_UTF8);
-		xmltvcursor->reader = xmlNewTextReader(xmltvcursor->buffer, nullptr);
+		// Allocate the batches that will be passed between the worker thread and SQLite up front
+		for(size_t index = 0; index < XMLTV_BATCH_COUNT; index++) {
+
+			std::unique_ptr<struct xmltv_batch> batch(new xmltv_batch());
+			batch->programmes.resize(XMLTV_BATCH_SIZE);
+			xmltvcursor->spare.push_back(std::move(batch));
+		}
+
+		// Download and parse the XMLTV data on a worker thread so that the network transfer and parsing
+		// overlap with SQLite processing the rows; xmltv_next() consumes the batches as they are produced
+		xmltvcursor->worker = std::thread(xmltv_worker, xmltvcursor);
 	}
 	
 	catch(std::exception const& ex) { xmltvcursor->pVtab->zErrMsg = sqlite3_mprintf("%s", ex.what()); return SQLITE_ERROR; } 
@@ -1810,87 +2274,63 @@ int xmltv_next(sqlite3_vtab_cursor* cursor)
 	xmltv_vtab_cursor* xmltvcursor = reinterpret_cast<xmltv_vtab_cursor*>(cursor);
 	assert(xmltvcursor != nullptr);
 
-	// Move the text reader to the start of the next element
-	int result = xmlTextReaderRead(xmltvcursor->reader);
-	while(result == 1) {
+	// text (local)
+	//
+	// Converts an xmltv_text value back into a nullable C string
+	auto text = [](struct xmltv_text const& value) -> char const* { return (value.null) ? nullptr : value.value.c_str(); };
+
+	// Move to the next <programme> record in the current batch, if there is one
+	if((xmltvcursor->batch) && (++xmltvcursor->index < xmltvcursor->batch->programmecount)) { ++xmltvcursor->rowid; return SQLITE_OK; }
 
-		if(xmlTextReaderNodeType(xmltvcursor->reader) == xmlReaderTypes::XML_READER_TYPE_ELEMENT) {
+	try {
 
-			bool ischannel = false;				// Flag indicating a <channel> element
-			bool isprogramme = false;			// Flag indicating a <programme> element
+		while(true) {
 
-			// Figure out if this is a <channel> or a <programme> element
-			xmlChar* element = xmlTextReaderName(xmltvcursor->reader);
-			if(element != nullptr) {
+			std::unique_lock<std::mutex> lock(xmltvcursor->lock);
 
-				ischannel = (xmlStrcmp(element, BAD_CAST("channel")) == 0);
-				isprogramme = ((!ischannel) && (xmlStrcmp(element, BAD_CAST("programme")) == 0));
-				xmlFree(element);
+			// Hand the consumed batch back to the worker thread so that it can be refilled
+			if(xmltvcursor->batch) {
+
+				xmltvcursor->spare.push_back(std::move(xmltvcursor->batch));
+				xmltvcursor->cv.notify_all();
 			}
 
-			// <channel> element - invoke the callback (if present) to map the channel
-			if((ischannel) && (xmltvcursor->onchannel)) {
+			// Wait for the worker thread to queue the next batch or finish
+			xmltvcursor->cv.wait(lock, [&]() -> bool { return (xmltvcursor->done) || (!xmltvcursor->ready.empty()); });
 
-				struct xmltv_channel channel = { 0 };
-				std::vector<xmlChar*> displayNames;
+			// Unsucessful states - set end-of-file if applicable or the worker thread result code on error
+			if(xmltvcursor->ready.empty()) {
 
-				xmlNodePtr node = xmlTextReaderExpand(xmltvcursor->reader);
-				if(node != nullptr) {
+				if(xmltvcursor->status == SQLITE_OK) { xmltvcursor->eof = true; return SQLITE_OK; }
 
-					xmlChar* channelid = xmlGetProp(node, BAD_CAST("id"));
-					if(channelid != nullptr) {
+				if(!xmltvcursor->error.empty()) xmltvcursor->pVtab->zErrMsg = sqlite3_mprintf("%s", xmltvcursor->error.c_str());
+				return xmltvcursor->status;
+			}
 
-						// The channel id attribute is passed into the callback as-is
-						channel.id = reinterpret_cast<char*>(channelid);
+			xmltvcursor->batch = std::move(xmltvcursor->ready.front());
+			xmltvcursor->ready.pop_front();
+			xmltvcursor->index = 0;
 
-						// The virtual channel number is in the <lcn> element
-						xmlNodePtr channelnumber = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("lcn"));
-						if(channelnumber != nullptr) channel.number = reinterpret_cast<char*>(xmlNodeGetContent(channelnumber));
+			lock.unlock();
 
-						// Collect all of the <display-name> element values into a vector<>
-						xmlTextReaderForEachChildElement(xmltvcursor->reader, BAD_CAST("display-name"), [&](xmlNodePtr node) -> void {
-							displayNames.emplace_back(xmlNodeGetContent(node));
-						});
+			// Pass any channel information from the batch back via the specified callback function
+			for(size_t index = 0; index < xmltvcursor->batch->channelcount; index++) {
 
-						// Get the icon source URL for the channel logo
-						xmlNodePtr iconsrc = xmlTextReaderGetChildElement(xmltvcursor->reader, BAD_CAST("icon"));
-						if(iconsrc != nullptr) channel.iconsrc = reinterpret_cast<char*>(xmlGetProp(iconsrc, BAD_CAST("src")));
-					}
-				}
+				struct xmltv_channel_record const& record = xmltvcursor->batch->channels[index];
 
-				// Process the <display-name> elements that are present for this channel
-				//
-				// [0] - GUIDENAME
-				// [1] - CHANNELNUMBER GUIDENAME
-				// [2] - CHANNELNUMBER ALTERNATEGUIDENAME
-				// [3] - CHANNELNUMBER
-				// [4] - ALTERNATEGUIDENAME
-				// [5] - NETWORKNAME
-				if(displayNames.size() >= 1) channel.name = reinterpret_cast<char*>(displayNames[0]);
-				if(displayNames.size() >= 5) channel.altname = reinterpret_cast<char*>(displayNames[4]);
-				if(displayNames.size() >= 6) channel.network = reinterpret_cast<char*>(displayNames[5]);
-
-				// Pass the channel information back via the specified callback function
-				xmltvcursor->onchannel(channel);
+				struct xmltv_channel channel = { text(record.id), text(record.number), text(record.name), text(record.altname),
+					text(record.network), text(record.iconsrc) };
 
-				// Chase down any libxml pointers passed to the callback
-				if(channel.id) xmlFree(const_cast<char*>(channel.id));
-				if(channel.number) xmlFree(const_cast<char*>(channel.number));
-				if(channel.iconsrc) xmlFree(const_cast<char*>(channel.iconsrc));
-				for(auto it : displayNames) if(it) xmlFree(it);
+				xmltvcursor->onchannel(channel);
 			}
 
-			// <programme> element - this is the next row for the result set; break
-			else if(isprogramme) break;
+			// <programme> records are the rows for the result set; batches may only contain channels
+			if(xmltvcursor->batch->programmecount > 0) break;
 		}
+	}
 
-		// Move to the next node in the XML document
-		result = xmlTextReaderRead(xmltvcursor->reader);
-	};
-
-	// Unsucessful states - set end-of-file if applicable or SQLITE_INTERNAL on error
-	if(result == 0) { xmltvcursor->eof = true; return SQLITE_OK; }
-	else if(result == -1) return SQLITE_INTERNAL;
+	catch(std::exception const& ex) { xmltvcursor->pVtab->zErrMsg = sqlite3_mprintf("%s", ex.what()); return SQLITE_ERROR; } 
+	catch(...) { return SQLITE_ERROR; }
 
 	// Increment the ROWID value to be returned to SQLite when asked
 	++xmltvcursor->rowid;
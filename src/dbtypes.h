@@ -41,7 +41,7 @@ static size_t const DATABASE_CONNECTIONPOOL_SIZE = 5;
 // DATABASE_SCHEMA_VERSION
 //
 // This value needs to be incremented with any database schema change
-static char const DATABASE_SCHEMA_VERSION[] = "14";
+static char const DATABASE_SCHEMA_VERSION[] = "15";
 
 //---------------------------------------------------------------------------
 // DATA TYPES
@@ -145,6 +145,15 @@ struct listing {
 	int					starrating;
 };
 
+// listingid
+//
+// Identifies a single listing that has been removed from the database
+struct listingid {
+
+	unsigned int		broadcastid;
+	unsigned int		channelid;
+};
+
 // recording
 //
 // Information about a single recording enumerated from the database
@@ -24,6 +24,16 @@
 #include "devicestream.h"
 
 #include <algorithm>
+#include <chrono>
+
+#if !defined(_WINDOWS) && !defined(WINAPI_FAMILY)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
 
 #include "align.h"
 #include "string_exception.h"
@@ -40,10 +50,61 @@ char const* devicestream::DEFAULT_MEDIA_TYPE = "video/mp2t";
 // The maximum amount of time to wait for stream data
 uint64_t const devicestream::MAXIMUM_WAIT_TIME = 1000;
 
-// devicestream::WAIT_INTERVAL (static)
+// devicestream::MAXIMUM_SOCKET_BUFFER_SIZE (static)
+//
+// Maximum size of the socket receive buffer
+int const devicestream::MAXIMUM_SOCKET_BUFFER_SIZE = (32 MiB);
+
+// devicestream::MINIMUM_SOCKET_BUFFER_SIZE (static)
+//
+// Minimum size of the socket receive buffer
+int const devicestream::MINIMUM_SOCKET_BUFFER_SIZE = VIDEO_DATA_BUFFER_SIZE_1S;
+
+// devicestream::MPEGTS_PACKET_LENGTH (static)
+//
+// Length of a single mpeg-ts data packet
+size_t const devicestream::MPEGTS_PACKET_LENGTH = 188;
+
+// devicestream::RECEIVE_BATCH_SIZE (static)
+//
+// Maximum number of datagrams to receive in a single batch
+size_t const devicestream::RECEIVE_BATCH_SIZE = 64;
+
+// devicestream::RECEIVE_BUFFER_SIZE (static)
+//
+// Size of the stream data receive buffer
+size_t const devicestream::RECEIVE_BUFFER_SIZE = (VIDEO_DATA_BUFFER_SIZE_1S * 2);
+
+// devicestream::RTP_HEADER_LENGTH (static)
+//
+// Length of the fixed RTP datagram header
+size_t const devicestream::RTP_HEADER_LENGTH = 12;
+
+// devicestream::SOCKET_BUFFER_TARGET_SECONDS (static)
+//
+// Amount of data the socket receive buffer is sized to hold
+unsigned int const devicestream::SOCKET_BUFFER_TARGET_SECONDS = 4;
+
+//---------------------------------------------------------------------------
+// close_socket (local)
+//
+// Closes a native socket handle
+//
+// Arguments:
 //
-// The amount of time to wait at once for stream data
-uint64_t const devicestream::WAIT_INTERVAL = 15;
+//	sock		- Socket handle to be closed
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+static void close_socket(SOCKET sock)
+{
+	if(sock != INVALID_SOCKET) closesocket(sock);
+}
+#else
+static void close_socket(int sock)
+{
+	if(sock != -1) ::close(sock);
+}
+#endif
 
 //---------------------------------------------------------------------------
 // devicestream Constructor (private)
@@ -51,18 +112,68 @@ uint64_t const devicestream::WAIT_INTERVAL = 15;
 // Arguments:
 //
 //	selector	- HDHomeRun device selector instance
-//	device		- Selected HDHomeRun device instance
+//	device			- Selected HDHomeRun device instance
+//	batchreceive	- Flag to receive datagrams in batches where supported
 
-devicestream::devicestream(struct hdhomerun_device_selector_t* selector, struct hdhomerun_device_t* device) : 
-	m_selector(selector), m_device(device)
+devicestream::devicestream(struct hdhomerun_device_selector_t* selector, struct hdhomerun_device_t* device, bool batchreceive) : 
+	m_selector(selector), m_device(device), m_deviceaddr(0), m_batchreceive(batchreceive), m_buffer(new uint8_t[RECEIVE_BUFFER_SIZE]), m_ccounters(new uint8_t[0x2000]), 
+	m_meter(std::chrono::seconds(1)), m_stats{}
 {
+	struct sockaddr_in		addr = {};				// Local socket address
+	char					target[64] = { 0 };		// Tuner target string
+
 	assert((selector != nullptr) && (device != nullptr));
 	if(selector == nullptr) throw std::invalid_argument("selector");
 	if(device == nullptr) throw std::invalid_argument("device");
 
-	// Attempt to start the device stream, the tuning parameters should have been set by create()
-	int result = hdhomerun_device_stream_start(device);
-	if(result != 1) { throw string_exception(__func__, ": failed to start device stream"); }
+	// There is no previous continuity counter for any of the PIDs yet
+	memset(&m_ccounters[0], 0xFF, 0x2000);
+
+	// Determine the local address of the interface that the tuner device is reachable from
+	uint32_t localaddr = hdhomerun_device_get_local_machine_addr(device);
+	if(localaddr == 0) throw string_exception(__func__, ": unable to determine the local address for the device stream");
+
+	// Datagrams that didn't originate from the tuner device's address are discarded when received
+	m_deviceaddr = htonl(hdhomerun_device_get_device_ip(device));
+	if(m_deviceaddr == 0) throw string_exception(__func__, ": unable to determine the address of the tuner device");
+
+	// Create the non-blocking IPv4 UDP socket to receive the stream datagrams
+	m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+	if(m_socket == INVALID_SOCKET) throw string_exception(__func__, ": failed to create device stream socket");
+	u_long nonblocking = 1;
+	if(ioctlsocket(m_socket, FIONBIO, &nonblocking) != 0) { close_socket(m_socket); throw string_exception(__func__, ": failed to set device stream socket to non-blocking mode"); }
+	int addrlen = sizeof(addr);
+#else
+	if(m_socket == -1) throw string_exception(__func__, ": failed to create device stream socket");
+	if(fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL) | O_NONBLOCK) != 0) { close_socket(m_socket); throw string_exception(__func__, ": failed to set device stream socket to non-blocking mode"); }
+	socklen_t addrlen = sizeof(addr);
+#endif
+
+	try {
+
+		// Bind the socket to any available port on all interfaces
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		addr.sin_port = 0;
+		if(bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) throw string_exception(__func__, ": failed to bind device stream socket");
+
+		// Start with the minimum socket receive buffer size, it's adjusted once the bitrate is known
+		set_socket_buffer_size(MINIMUM_SOCKET_BUFFER_SIZE);
+
+		// Get the port number that was assigned to the socket
+		if(getsockname(m_socket, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) != 0) throw string_exception(__func__, ": failed to get device stream socket address");
+
+		// Point the tuner at the socket; this starts the flow of RTP datagrams from the device
+		snprintf(target, std::extent<decltype(target)>::value, "rtp://%u.%u.%u.%u:%u", (localaddr >> 24) & 0xFF, (localaddr >> 16) & 0xFF, 
+			(localaddr >> 8) & 0xFF, localaddr & 0xFF, ntohs(addr.sin_port));
+
+		int result = hdhomerun_device_set_tuner_target(device, target);
+		if(result != 1) throw string_exception(__func__, ": failed to start device stream");
+	}
+
+	catch(...) { close_socket(m_socket); throw; }
 }
 
 //---------------------------------------------------------------------------
@@ -76,6 +187,75 @@ devicestream::~devicestream()
 	if(m_selector != nullptr) hdhomerun_device_selector_destroy(m_selector, true);
 }
 
+//---------------------------------------------------------------------------
+// devicestream::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* devicestream::acquire(size_t count, size_t* available)
+{
+	assert(available != nullptr);
+	if(available == nullptr) throw std::invalid_argument("available");
+	*available = 0;
+
+	assert(m_device != nullptr);
+	if(m_device == nullptr) throw string_exception(__func__, ": stream has been closed");
+
+	// The count should be aligned down to VIDEO_DATA_PACKET_SIZE
+	count = align::down(count, VIDEO_DATA_PACKET_SIZE);
+	if(count == 0) return nullptr;
+
+	// If all of the previously received data has been released, start over at the beginning of the buffer
+	if(m_tail == m_head) m_head = m_tail = 0;
+
+	// Pull in everything that has already been queued on the socket, and if there is still no data wait up
+	// to MAXIMUM_WAIT_TIME for more; this returns as soon as any stream data has been received
+	receive();
+
+	auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(MAXIMUM_WAIT_TIME);
+	while(m_head == m_tail) {
+
+		auto const now = std::chrono::steady_clock::now();
+		if(now >= deadline) break;
+
+		if(!wait(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()))) break;
+		receive();
+	}
+
+	*available = std::min(count, m_head - m_tail);
+	return (*available > 0) ? &m_buffer[m_tail] : nullptr;
+}
+
+//---------------------------------------------------------------------------
+// devicestream::autosize (private)
+//
+// Adjusts the size of the socket receive buffer based on the measured bitrate
+//
+// Arguments:
+//
+//	NONE
+
+void devicestream::autosize(void)
+{
+	// There is nothing to do if there is no new measurement
+	if(!m_meter.sample()) return;
+
+	// Calculate the socket buffer size required to hold the target amount of stream data
+	uint64_t target = m_meter.bytespersecond() * SOCKET_BUFFER_TARGET_SECONDS;
+	int size = static_cast<int>(std::min(std::max(target, static_cast<uint64_t>(MINIMUM_SOCKET_BUFFER_SIZE)), static_cast<uint64_t>(MAXIMUM_SOCKET_BUFFER_SIZE)));
+
+	// Grow the socket buffer as soon as the target exceeds the current size, but only shrink it when
+	// the target has fallen below half of the current size
+	if((size <= m_socketbuffersize) && (size > (m_socketbuffersize / 2))) return;
+
+	set_socket_buffer_size(size);
+}
+
 //---------------------------------------------------------------------------
 // devicestream::canseek
 //
@@ -104,11 +284,14 @@ void devicestream::close(void)
 	if(m_device) {
 
 		// Stop the stream, clear the vchannel, and release the lockkey being held
-		hdhomerun_device_stream_stop(m_device);
+		hdhomerun_device_set_tuner_target(m_device, "none");
 		hdhomerun_device_set_tuner_vchannel(m_device, "none");
 		hdhomerun_device_tuner_lockkey_release(m_device);
 
+		close_socket(m_socket);		// Close the datagram socket
+
 		m_device = nullptr;			// Device is no longer active
+		m_head = m_tail = 0;		// Buffered data is no longer valid
 	}
 }
 
@@ -119,9 +302,10 @@ void devicestream::close(void)
 //
 // Arguments:
 //
-//	devices		- vector<> of valid devices for the target stream
+//	devices			- vector<> of valid devices for the target stream
+//	batchreceive	- Flag to receive datagrams in batches where supported
 
-std::unique_ptr<devicestream> devicestream::create(std::vector<struct tuner> const& tuners)
+std::unique_ptr<devicestream> devicestream::create(std::vector<struct tuner> const& tuners, bool batchreceive)
 {
 	// Allocate and initialize the device selector
 	struct hdhomerun_device_selector_t* selector = hdhomerun_device_selector_create(nullptr);
@@ -164,7 +348,7 @@ std::unique_ptr<devicestream> devicestream::create(std::vector<struct tuner> con
 			if(result != 1) { throw string_exception(__func__, ": unable to set program ", found->program, " on device"); }
 
 			// Create the device stream for the selected tuner
-			return std::unique_ptr<devicestream>(new devicestream(selector, selected)); 
+			return std::unique_ptr<devicestream>(new devicestream(selector, selected, batchreceive)); 
 		
 		}
 		catch(...) { hdhomerun_device_tuner_lockkey_release(selected); throw; }
@@ -201,6 +385,20 @@ char const* devicestream::mediatype(void) const
 	return DEFAULT_MEDIA_TYPE;
 }
 
+//---------------------------------------------------------------------------
+// devicestream::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long devicestream::minposition(void) const
+{
+	return -1;
+}
+
 //---------------------------------------------------------------------------
 // devicestream::position
 //
@@ -227,29 +425,14 @@ long long devicestream::position(void) const
 
 size_t devicestream::read(uint8_t* buffer, size_t count)
 {
-	uint8_t*		streambuffer = nullptr;		// Pointer the stream data
-	size_t			buffersize = 0;				// Bytes available in the buffer
-	uint64_t		waited = 0;					// Amount of time spent waiting for data
+	size_t			available = 0;				// Bytes available in the stream buffer
 
-	assert(m_device != nullptr);
-	if(m_device == nullptr) throw string_exception(__func__, ": stream has been closed");
-
-	// The count should be aligned down to VIDEO_DATA_PACKET_SIZE
-	count = align::down(count, VIDEO_DATA_PACKET_SIZE);
-	if(count == 0) return 0;
+	// Acquire the data from the device stream and copy it into the output buffer
+	uint8_t* streambuffer = acquire(count, &available);
+	if(available > 0) memcpy(buffer, streambuffer, available);
 
-	// There isn't always data available in the buffer, sleep in WAIT_INTERVAL chunks for
-	// more data to become ready to transfer into the output buffer
-	while((streambuffer == nullptr) && (waited < MAXIMUM_WAIT_TIME)) {
-
-		streambuffer = hdhomerun_device_stream_recv(m_device, count, &buffersize);
-		if(streambuffer == nullptr) { msleep_approx(WAIT_INTERVAL); waited += WAIT_INTERVAL; }
-	}
-
-	// If data is available, copy it into the output buffer
-	if((streambuffer != nullptr) && (buffersize > 0)) memcpy(buffer, streambuffer, buffersize);
-
-	return buffersize;
+	release(available);
+	return available;
 }
 
 //---------------------------------------------------------------------------
@@ -266,6 +449,193 @@ bool devicestream::realtime(void) const
 	return true;
 }
 
+//---------------------------------------------------------------------------
+// devicestream::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
+
+void devicestream::release(size_t count)
+{
+	assert(count <= (m_head - m_tail));
+	m_tail += std::min(count, m_head - m_tail);
+}
+
+//---------------------------------------------------------------------------
+// devicestream::receive (private)
+//
+// Receives all datagrams currently queued on the socket
+//
+// Arguments:
+//
+//	NONE
+
+void devicestream::receive(void)
+{
+	struct hdhomerun_video_stats_t		stats = {};		// Statistics for the received data
+
+	// If there isn't enough room at the end of the buffer for another datagram, move any unreleased
+	// data back to the beginning; this is only called from acquire() so nothing is outstanding
+	if(((RECEIVE_BUFFER_SIZE - m_head) < VIDEO_RTP_DATA_PACKET_SIZE) && (m_tail > 0)) {
+
+		memmove(&m_buffer[0], &m_buffer[m_tail], m_head - m_tail);
+		m_head -= m_tail;
+		m_tail = 0;
+	}
+
+	size_t const startinghead = m_head;				// Buffer head position before receiving
+
+	// Receive the datagrams in batches if requested, otherwise one at a time
+	if(m_batchreceive) receive_batch(stats);
+	else receive_single(stats);
+
+	// Update the bitrate meter and resize the socket receive buffer if necessary
+	m_meter.add(m_head - startinghead);
+	autosize();
+
+	// Accumulate the statistics for the received data
+	std::unique_lock<std::mutex> lock(m_statslock);
+
+	m_stats.packet_count += stats.packet_count;
+	m_stats.network_error_count += stats.network_error_count;
+	m_stats.transport_error_count += stats.transport_error_count;
+	m_stats.sequence_error_count += stats.sequence_error_count;
+}
+
+//---------------------------------------------------------------------------
+// devicestream::receive_batch (private)
+//
+// Receives queued datagrams in batches with a single system call
+//
+// Arguments:
+//
+//	stats		- Statistics to be updated
+
+void devicestream::receive_batch(struct hdhomerun_video_stats_t& stats)
+{
+#if defined(__linux__)
+
+	uint8_t				headers[RECEIVE_BATCH_SIZE][RTP_HEADER_LENGTH];		// RTP datagram headers
+	struct sockaddr_in	sources[RECEIVE_BATCH_SIZE];						// Datagram source addresses
+	struct iovec		iovecs[RECEIVE_BATCH_SIZE][2];						// Datagram scatter vectors
+	struct mmsghdr		messages[RECEIVE_BATCH_SIZE];						// Datagram messages
+
+	// Receive batches of datagrams with a single system call; the RTP headers are scattered into a separate
+	// array and the payloads are received directly into consecutive slots in the buffer
+	while((RECEIVE_BUFFER_SIZE - m_head) >= VIDEO_DATA_PACKET_SIZE) {
+
+		size_t batchsize = std::min(RECEIVE_BATCH_SIZE, (RECEIVE_BUFFER_SIZE - m_head) / VIDEO_DATA_PACKET_SIZE);
+
+		for(size_t index = 0; index < batchsize; index++) {
+
+			iovecs[index][0].iov_base = headers[index];
+			iovecs[index][0].iov_len = RTP_HEADER_LENGTH;
+			iovecs[index][1].iov_base = &m_buffer[m_head + (index * VIDEO_DATA_PACKET_SIZE)];
+			iovecs[index][1].iov_len = VIDEO_DATA_PACKET_SIZE;
+
+			memset(&messages[index], 0, sizeof(struct mmsghdr));
+			messages[index].msg_hdr.msg_name = &sources[index];
+			messages[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			messages[index].msg_hdr.msg_iov = iovecs[index];
+			messages[index].msg_hdr.msg_iovlen = 2;
+		}
+
+		int result = recvmmsg(m_socket, messages, static_cast<unsigned int>(batchsize), MSG_DONTWAIT, nullptr);
+		if((result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))) break;
+		if(result < 0) throw string_exception(__func__, ": failed to receive device stream data");
+
+		// Pack the received payloads together, they may not have filled their slots
+		size_t head = m_head;
+		for(size_t index = 0; index < static_cast<size_t>(result); index++) {
+
+			// Discard any datagrams that were not sent by the tuner device
+			if((messages[index].msg_hdr.msg_namelen < sizeof(struct sockaddr_in)) || (sources[index].sin_addr.s_addr != m_deviceaddr)) continue;
+
+			size_t length = messages[index].msg_len;
+
+			size_t headerlength = track_rtp(headers[index], length, stats);
+			if(headerlength == 0) continue;
+
+			// Any RTP header data beyond the fixed header ended up at the start of the payload slot
+			size_t skip = headerlength - RTP_HEADER_LENGTH;
+			length = align::down(std::min(length - headerlength, VIDEO_DATA_PACKET_SIZE - skip), MPEGTS_PACKET_LENGTH);
+
+			uint8_t* payload = &m_buffer[m_head + (index * VIDEO_DATA_PACKET_SIZE) + skip];
+			if(payload != &m_buffer[head]) memmove(&m_buffer[head], payload, length);
+
+			track_packets(&m_buffer[head], length, stats);
+			head += length;
+		}
+
+		m_head = head;
+
+		// If the batch wasn't filled there is nothing more queued on the socket
+		if(static_cast<size_t>(result) < batchsize) break;
+	}
+
+#else
+
+	// Batched receives are only available on Linux and Android
+	receive_single(stats);
+
+#endif
+}
+
+//---------------------------------------------------------------------------
+// devicestream::receive_single (private)
+//
+// Receives queued datagrams one at a time
+//
+// Arguments:
+//
+//	stats		- Statistics to be updated
+
+void devicestream::receive_single(struct hdhomerun_video_stats_t& stats)
+{
+	struct sockaddr_in		source = {};		// Datagram source address
+
+	// Receive datagrams directly into the buffer until the socket has nothing left or the buffer is full,
+	// anything that doesn't fit remains queued in the socket until the next call
+	while((RECEIVE_BUFFER_SIZE - m_head) >= VIDEO_RTP_DATA_PACKET_SIZE) {
+
+		uint8_t* datagram = &m_buffer[m_head];
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+		int sourcelen = sizeof(source);
+#else
+		socklen_t sourcelen = sizeof(source);
+#endif
+
+		int result = static_cast<int>(recvfrom(m_socket, reinterpret_cast<char*>(datagram), VIDEO_RTP_DATA_PACKET_SIZE, 0, 
+			reinterpret_cast<struct sockaddr*>(&source), &sourcelen));
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+		if((result < 0) && (WSAGetLastError() == WSAEWOULDBLOCK)) break;
+#else
+		if((result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))) break;
+#endif
+		if(result < 0) throw string_exception(__func__, ": failed to receive device stream data");
+
+		// Discard any datagrams that were not sent by the tuner device
+		if((sourcelen < static_cast<decltype(sourcelen)>(sizeof(source))) || (source.sin_addr.s_addr != m_deviceaddr)) continue;
+
+		size_t length = static_cast<size_t>(result);
+
+		// Remove the RTP header from the datagram, leaving only the whole transport stream packets
+		size_t headerlength = track_rtp(datagram, length, stats);
+		if(headerlength == 0) continue;
+
+		length = align::down(length - headerlength, MPEGTS_PACKET_LENGTH);
+		memmove(datagram, datagram + headerlength, length);
+
+		track_packets(datagram, length, stats);
+		m_head += length;
+	}
+}
+
 //---------------------------------------------------------------------------
 // devicestream::seek
 //
@@ -281,6 +651,146 @@ long long devicestream::seek(long long /*position*/, int /*whence*/)
 	return -1;
 }
 
+//---------------------------------------------------------------------------
+// devicestream::set_socket_buffer_size (private)
+//
+// Sets the size of the socket receive buffer
+//
+// Arguments:
+//
+//	size		- New socket receive buffer size
+
+void devicestream::set_socket_buffer_size(int size)
+{
+	// The operating system may limit the size of the buffer (net.core.rmem_max); this is not
+	// considered an error, the stream will just have less protection against dropped datagrams
+	setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<char const*>(&size), sizeof(size));
+	m_socketbuffersize = size;
+}
+
+//---------------------------------------------------------------------------
+// devicestream::stats
+//
+// Gets the video statistics for the stream
+//
+// Arguments:
+//
+//	NONE
+
+struct hdhomerun_video_stats_t devicestream::stats(void) const
+{
+	std::unique_lock<std::mutex> lock(m_statslock);
+	return m_stats;
+}
+
+//---------------------------------------------------------------------------
+// devicestream::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void devicestream::telemetry(telemetry_t& values) const
+{
+	struct hdhomerun_video_stats_t stats = this->stats();
+
+	values.emplace_back("devicestream.buffer_size", static_cast<long long>(RECEIVE_BUFFER_SIZE));
+	values.emplace_back("devicestream.buffer_used", static_cast<long long>(m_head - m_tail));
+	values.emplace_back("devicestream.bytes_per_second", static_cast<long long>(m_meter.bytespersecond()));
+	values.emplace_back("devicestream.socket_buffer_size", static_cast<long long>(m_socketbuffersize));
+	values.emplace_back("devicestream.packets", static_cast<long long>(stats.packet_count));
+	values.emplace_back("devicestream.network_errors", static_cast<long long>(stats.network_error_count));
+	values.emplace_back("devicestream.transport_errors", static_cast<long long>(stats.transport_error_count));
+	values.emplace_back("devicestream.sequence_errors", static_cast<long long>(stats.sequence_error_count));
+}
+
+//---------------------------------------------------------------------------
+// devicestream::track_packets (private)
+//
+// Tracks the transport stream packet statistics of received data
+//
+// Arguments:
+//
+//	packets		- Pointer to the received transport stream packets
+//	length		- Length of the received transport stream packets
+//	stats		- Statistics to be updated
+
+void devicestream::track_packets(uint8_t const* packets, size_t length, struct hdhomerun_video_stats_t& stats)
+{
+	// Track the transport error indicators and continuity counters of each packet
+	for(size_t offset = 0; offset < length; offset += MPEGTS_PACKET_LENGTH) {
+
+		uint8_t const* packet = &packets[offset];
+		stats.packet_count++;
+
+		uint16_t pid = static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]);
+		if(pid == 0x1FFF) continue;
+
+		if((packet[1] & 0x80) == 0x80) { stats.transport_error_count++; m_ccounters[pid] = 0xFF; continue; }
+
+		uint8_t counter = packet[3] & 0x0F;
+		uint8_t previous = m_ccounters[pid];
+		m_ccounters[pid] = counter;
+
+		if((previous != 0xFF) && (counter != ((previous + 1) & 0x0F)) && (counter != previous)) stats.sequence_error_count++;
+	}
+}
+
+//---------------------------------------------------------------------------
+// devicestream::track_rtp (private)
+//
+// Tracks the RTP sequence of a received datagram header
+//
+// Arguments:
+//
+//	header		- Pointer to the RTP datagram header
+//	length		- Length of the received datagram
+//	stats		- Statistics to be updated
+
+size_t devicestream::track_rtp(uint8_t const* header, size_t length, struct hdhomerun_video_stats_t& stats)
+{
+	// Datagrams that aren't RTP version 2 did not come from the tuner device and are discarded
+	if((length < RTP_HEADER_LENGTH) || ((header[0] & 0xC0) != 0x80)) return 0;
+
+	// Track the sequence number to detect lost datagrams
+	int sequence = (header[2] << 8) | header[3];
+	if((m_rtpsequence >= 0) && (sequence != ((m_rtpsequence + 1) & 0xFFFF))) stats.network_error_count++;
+	m_rtpsequence = sequence;
+
+	// The header length includes any contributing source identifiers
+	size_t headerlength = RTP_HEADER_LENGTH + ((header[0] & 0x0F) * 4);
+	return (length >= headerlength) ? headerlength : 0;
+}
+
+//---------------------------------------------------------------------------
+// devicestream::wait (private)
+//
+// Waits for a datagram to be queued on the socket
+//
+// Arguments:
+//
+//	timeout		- Maximum amount of time to wait, in milliseconds
+
+bool devicestream::wait(uint64_t timeout) const
+{
+	struct pollfd		pfd = {};			// Socket poll information
+
+	pfd.fd = m_socket;
+	pfd.events = POLLIN;
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+	int result = WSAPoll(&pfd, 1, static_cast<int>(timeout));
+#else
+	int result = poll(&pfd, 1, static_cast<int>(timeout));
+	if((result < 0) && (errno == EINTR)) return true;
+#endif
+
+	if(result < 0) throw string_exception(__func__, ": failed to wait for device stream data");
+	return (result > 0);
+}
+
 //---------------------------------------------------------------------------
 
 #pragma warning(pop)
@@ -27,15 +27,18 @@
 #pragma warning(push, 4)
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "bitratemeter.h"
 #include "pvrstream.h"
 
 //---------------------------------------------------------------------------
 // Class devicestream
 //
-// Implements an RTP/UDP based device stream
+// Implements an RTP/UDP based device stream that receives the datagrams sent
+// by the tuner device directly from its own UDP socket
 
 class devicestream : public pvrstream
 {
@@ -58,6 +61,11 @@ public:
 	//-----------------------------------------------------------------------
 	// Member Functions
 
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
 	// canseek
 	//
 	// Flag indicating if the stream allows seek operations
@@ -71,7 +79,7 @@ public:
 	// create (static)
 	//
 	// Factory method, creates a new devicestream instance
-	static std::unique_ptr<devicestream> create(std::vector<struct tuner> const& tuners);
+	static std::unique_ptr<devicestream> create(std::vector<struct tuner> const& tuners, bool batchreceive);
 
 	// length
 	//
@@ -83,6 +91,11 @@ public:
 	// Gets the media type of the stream
 	char const* mediatype(void) const;
 
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
 	// position
 	//
 	// Gets the current position of the stream
@@ -98,11 +111,26 @@ public:
 	// Gets a flag indicating if the stream is real-time
 	bool realtime(void) const;
 
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
 	// seek
 	//
 	// Sets the stream pointer to a specific position
 	long long seek(long long position, int whence);
 
+	// stats
+	//
+	// Gets the video statistics for the stream
+	struct hdhomerun_video_stats_t stats(void) const;
+
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
 private:
 
 	devicestream(devicestream const&) = delete;
@@ -118,20 +146,117 @@ private:
 	// The maximum amount of time to wait for stream data
 	static uint64_t const MAXIMUM_WAIT_TIME;
 
-	// WAIT_INTERVAL
+	// MPEGTS_PACKET_LENGTH
+	//
+	// Length of a single mpeg-ts data packet
+	static size_t const MPEGTS_PACKET_LENGTH;
+
+	// MAXIMUM_SOCKET_BUFFER_SIZE
+	//
+	// Maximum size of the socket receive buffer
+	static int const MAXIMUM_SOCKET_BUFFER_SIZE;
+
+	// MINIMUM_SOCKET_BUFFER_SIZE
+	//
+	// Minimum size of the socket receive buffer
+	static int const MINIMUM_SOCKET_BUFFER_SIZE;
+
+	// RECEIVE_BATCH_SIZE
+	//
+	// Maximum number of datagrams to receive in a single batch
+	static size_t const RECEIVE_BATCH_SIZE;
+
+	// RECEIVE_BUFFER_SIZE
+	//
+	// Size of the stream data receive buffer
+	static size_t const RECEIVE_BUFFER_SIZE;
+
+	// RTP_HEADER_LENGTH
+	//
+	// Length of the fixed RTP datagram header
+	static size_t const RTP_HEADER_LENGTH;
+
+	// SOCKET_BUFFER_TARGET_SECONDS
 	//
-	// The amount of time to wait at once for stream data
-	static uint64_t const WAIT_INTERVAL;
+	// Amount of data the socket receive buffer is sized to hold
+	static unsigned int const SOCKET_BUFFER_TARGET_SECONDS;
 
 	// Instance Constructor
 	//
-	devicestream(struct hdhomerun_device_selector_t* selector, struct hdhomerun_device_t* device);
+	devicestream(struct hdhomerun_device_selector_t* selector, struct hdhomerun_device_t* device, bool batchreceive);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// autosize
+	//
+	// Adjusts the size of the socket receive buffer based on the measured bitrate
+	void autosize(void);
+
+	// receive
+	//
+	// Receives all datagrams currently queued on the socket
+	void receive(void);
+
+	// receive_batch
+	//
+	// Receives queued datagrams in batches with a single system call
+	void receive_batch(struct hdhomerun_video_stats_t& stats);
+
+	// receive_single
+	//
+	// Receives queued datagrams one at a time
+	void receive_single(struct hdhomerun_video_stats_t& stats);
+
+	// set_socket_buffer_size
+	//
+	// Sets the size of the socket receive buffer
+	void set_socket_buffer_size(int size);
+
+	// track_packets
+	//
+	// Tracks the transport stream packet statistics of received data
+	void track_packets(uint8_t const* packets, size_t length, struct hdhomerun_video_stats_t& stats);
+
+	// track_rtp
+	//
+	// Tracks the RTP sequence of a received datagram header
+	size_t track_rtp(uint8_t const* header, size_t length, struct hdhomerun_video_stats_t& stats);
+
+	// wait
+	//
+	// Waits for a datagram to be queued on the socket
+	bool wait(uint64_t timeout) const;
+
+	//-----------------------------------------------------------------------
+	// Member Types
+
+	// socket_t
+	//
+	// Native socket handle type
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+	using socket_t = SOCKET;
+#else
+	using socket_t = int;
+#endif
 
 	//-----------------------------------------------------------------------
 	// Member Variables
 
 	struct hdhomerun_device_selector_t*		m_selector;			// Device selector
 	struct hdhomerun_device_t*				m_device;			// Selected device
+	socket_t								m_socket;			// Video datagram socket
+	uint32_t								m_deviceaddr;		// Tuner device address (network order)
+	bool const								m_batchreceive;		// Flag to receive datagrams in batches
+	std::unique_ptr<uint8_t[]>				m_buffer;			// Receive buffer
+	size_t									m_head = 0;			// Receive buffer head (write) position
+	size_t									m_tail = 0;			// Receive buffer tail (read) position
+	int										m_rtpsequence = -1;	// Last RTP sequence number
+	std::unique_ptr<uint8_t[]>				m_ccounters;		// Per-PID continuity counters
+	bitratemeter							m_meter;			// Incoming bitrate meter
+	int										m_socketbuffersize = 0;	// Socket receive buffer size
+	struct hdhomerun_video_stats_t			m_stats;			// Video statistics
+	mutable std::mutex						m_statslock;		// Synchronization object
 };
 
 //-----------------------------------------------------------------------------
@@ -33,6 +33,11 @@
 
 #pragma warning(push, 4)
 
+// httpstream::BUFFER_TARGET_SECONDS (static)
+//
+// Amount of stream data the adaptive ring buffer is sized to hold
+unsigned int const httpstream::BUFFER_TARGET_SECONDS = 8;
+
 // httpstream::DEFAULT_MEDIA_TYPE (static)
 //
 // Default media type to report for the stream
@@ -52,6 +57,31 @@ long long const httpstream::MAX_STREAM_LENGTH = std::numeric_limits<long long>::
 //
 // Length of a single mpeg-ts data packet
 size_t const httpstream::MPEGTS_PACKET_LENGTH = 188;
+
+// httpstream::PREFETCH_RESUME_DIVISOR (static)
+//
+// Fraction of the ring buffer that must be free to resume a paused prefetch
+size_t const httpstream::PREFETCH_RESUME_DIVISOR = 4;
+
+// httpstream::RECONNECT_ATTEMPTS (static)
+//
+// Maximum number of attempts to reconnect an interrupted stream
+int const httpstream::RECONNECT_ATTEMPTS = 5;
+
+// httpstream::RECONNECT_INITIAL_DELAY (static)
+//
+// Delay before the second attempt to reconnect an interrupted stream
+std::chrono::milliseconds const httpstream::RECONNECT_INITIAL_DELAY(250);
+
+// httpstream::RECONNECT_MAXIMUM_DELAY (static)
+//
+// Maximum delay between attempts to reconnect an interrupted stream
+std::chrono::milliseconds const httpstream::RECONNECT_MAXIMUM_DELAY(4000);
+
+// httpstream::RINGBUFFER_ALIGNMENT (static)
+//
+// Alignment of an adaptive ring buffer size
+size_t const httpstream::RINGBUFFER_ALIGNMENT = (64 KiB);
 	
 //---------------------------------------------------------------------------
 // curl_multi_get_result
@@ -97,15 +127,20 @@ static bool curl_multi_get_result(CURLM* multi, CURL* easy, CURLcode *result)
 // Arguments:
 //
 //	url				- URL of the stream to be opened
+//	options			- Optional stream behaviors
 
-httpstream::httpstream(char const* url) : m_buffersize(DEFAULT_RINGBUFFER_SIZE)
+httpstream::httpstream(char const* url, struct options const& options) : m_buffersize(align::up(options.minbuffersize, RINGBUFFER_ALIGNMENT)),
+	m_minbuffersize(m_buffersize), m_maxbuffersize(std::max(m_buffersize, align::up(options.maxbuffersize, RINGBUFFER_ALIGNMENT))), 
+	m_meter(std::chrono::seconds(1)), m_prefetch(options.prefetch)
 {
 	size_t		available = 0;				// Amount of available ring buffer data
 
 	if(url == nullptr) throw std::invalid_argument("url");
+	if(m_buffersize == 0) throw std::invalid_argument("options.minbuffersize");
 
-	// Allocate the ring buffer using the 64KiB upward-aligned buffer size
-	m_buffer = std::unique_ptr<uint8_t[]>(new uint8_t[m_buffersize]);
+	// Allocate the ring buffer using the 64KiB upward-aligned minimum buffer size, with
+	// an additional packet worth of space to mirror the start of the ring buffer
+	m_buffer = std::unique_ptr<uint8_t[]>(new uint8_t[m_buffersize + MPEGTS_PACKET_LENGTH]);
 	if(!m_buffer) throw std::bad_alloc();
 
 	// Allocate and initialize the cURL handle error message buffer
@@ -113,6 +148,18 @@ httpstream::httpstream(char const* url) : m_buffersize(DEFAULT_RINGBUFFER_SIZE)
 	if(!m_curlerr) throw std::bad_alloc();
 	memset(m_curlerr.get(), 0, CURL_ERROR_SIZE + 1);
 
+	// Create the seek cache if requested; if the spill file cannot be created use only memory
+	if(options.seekcachesize > 0) {
+
+		if((options.seekcachefile != nullptr) && (options.seekcachefilesize > 0)) {
+
+			try { m_cache = segmentcache::create(options.seekcachesize, options.seekcachefile, options.seekcachefilesize); }
+			catch(std::exception&) { m_cache = segmentcache::create(options.seekcachesize); }
+		}
+
+		else m_cache = segmentcache::create(options.seekcachesize);
+	}
+
 	// Create and initialize the curl multi interface object
 	m_curlm = curl_multi_init();
 	if(m_curlm == nullptr) throw string_exception(__func__, ": curl_multi_init() failed");
@@ -151,12 +198,15 @@ httpstream::httpstream(char const* url) : m_buffersize(DEFAULT_RINGBUFFER_SIZE)
 				// and for the initial chunk of data to become available in the ring buffer
 				transfer_until([&]() -> bool { 
 					
-					available = (m_tail > m_head) ? (m_buffersize - m_tail) + m_head : m_head - m_tail;
+					available = readable();
 					return ((m_headers == true) && (available > 0));
 				});
 
 				if(!m_headers) throw string_exception(__func__, ": failed to receive HTTP response headers");
 				if(available == 0) throw string_exception(__func__, ": failed to receive HTTP response body");
+
+				// If prefetch has been requested, hand the transfer off to the background thread
+				start_prefetch();
 			}
 
 			// Remove the easy handle from the multi interface on exception
@@ -179,6 +229,168 @@ httpstream::~httpstream()
 	close();
 }
 
+//---------------------------------------------------------------------------
+// httpstream::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* httpstream::acquire(size_t count, size_t* available)
+{
+	assert((m_curlm != nullptr) && (m_curl != nullptr));
+	assert(available != nullptr);
+
+	if(available == nullptr) throw std::invalid_argument("available");
+	*available = 0;
+
+	if(count >= m_buffersize) throw std::invalid_argument("count");
+
+	// The count should be aligned down to MPEGTS_PACKET_LENGTH
+	count = align::down(count, MPEGTS_PACKET_LENGTH);
+	if(count == 0) return nullptr;
+
+	// Periodically adjust the size of the ring buffer to the measured bitrate
+	autosize();
+
+	size_t bytesavailable = 0;				// Available bytes in the ring buffer
+
+	if(m_prefetch) {
+
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		// The background thread is transferring the data, only wait if the ring buffer is empty
+		m_cv.wait(lock, [&]() -> bool {
+
+			bytesavailable = readable();
+			return ((bytesavailable > 0) || (m_finished));
+		});
+
+	}
+
+	else {
+
+		// Transfer data into the ring buffer until the minimum amount of data is available, the stream
+		// has completed, or an exception/error occurs.  Like the background transfer, an exception is
+		// held until the ring buffer has been drained
+		try { transfer_until([&]() -> bool {
+
+			bytesavailable = readable();
+			return (bytesavailable >= count);
+		}); }
+
+		catch(...) { m_exception = std::current_exception(); bytesavailable = readable(); }
+	}
+
+	// If the ring buffer has been drained and the transfer failed or ended before the end of the stream
+	// was reached, attempt to reconnect it.  If that isn't possible, throw the exception from the transfer
+	if((bytesavailable == 0) && ((m_exception) || (interrupted()))) {
+
+		std::exception_ptr exception = m_exception;
+		m_exception = nullptr;
+
+		// The background transfer thread has finished but still needs to be joined
+		stop_prefetch();
+
+		if(!reconnect()) {
+
+			if(exception) std::rethrow_exception(exception);
+			return nullptr;
+		}
+
+		start_prefetch();
+		bytesavailable = readable();
+	}
+
+	// If there is no available data in the ring buffer after the transfer, indicate stream is finished
+	if(bytesavailable == 0) return nullptr;
+
+	// The head position can be changed by the transfer thread, take a snapshot of it; this
+	// is the only reader so the tail position cannot change until the data has been released
+	size_t const head = m_head;
+	size_t const tail = m_tail;
+
+	// If the data wraps around the end of the ring buffer, only the data up to the end of the buffer is
+	// contiguous; the start of the ring buffer is mirrored after the end so that any packet straddling
+	// the end of the buffer can still be returned whole
+	if(tail > head) bytesavailable = std::min(bytesavailable, (m_buffersize - tail) + std::min(head, MPEGTS_PACKET_LENGTH - 1));
+
+	// Reads are no longer aligned to return full MPEG-TS packets, determine the offset
+	// from the current read position to the first full packet of data
+	size_t packetoffset = static_cast<size_t>(align::up(m_readpos, MPEGTS_PACKET_LENGTH) - m_readpos);
+
+	// Starting with the lesser of the amount of data that is available to read and the
+	// originally requested count, adjust the end so that it aligns to a full MPEG-TS packet
+	count = std::min(bytesavailable, count);
+	if(count >= (packetoffset + MPEGTS_PACKET_LENGTH)) count = packetoffset + align::down(count - packetoffset, MPEGTS_PACKET_LENGTH);
+
+	*available = count;
+	return &m_buffer[tail];
+}
+
+//---------------------------------------------------------------------------
+// httpstream::autosize (private)
+//
+// Adjusts the size of the ring buffer based on the measured bitrate
+//
+// Arguments:
+//
+//	NONE
+
+void httpstream::autosize(void)
+{
+	// There is nothing to do if the ring buffer size is fixed or there is no new measurement
+	if((m_minbuffersize == m_maxbuffersize) || (!m_meter.sample())) return;
+
+	// Calculate the ring buffer size required to hold the target amount of stream data
+	uint64_t target = m_meter.bytespersecond() * BUFFER_TARGET_SECONDS;
+	target = std::min(std::max(target, static_cast<uint64_t>(m_minbuffersize)), static_cast<uint64_t>(m_maxbuffersize));
+	size_t buffersize = align::up(static_cast<size_t>(target), RINGBUFFER_ALIGNMENT);
+
+	// Grow the ring buffer as soon as the target exceeds the current size, but only shrink it when
+	// the target has fallen below half of the current size to prevent continuous reallocations
+	if((buffersize <= m_buffersize) && (buffersize > (m_buffersize / 2))) return;
+
+	// The background transfer thread has to be stopped while the ring buffer is reallocated
+	stop_prefetch();
+
+	try { resize(buffersize); }
+	catch(...) { start_prefetch(); throw; }
+
+	start_prefetch();
+}
+
+//---------------------------------------------------------------------------
+// httpstream::buffersize
+//
+// Gets the current size of the ring buffer
+//
+// Arguments:
+//
+//	NONE
+
+size_t httpstream::buffersize(void) const
+{
+	return m_buffersize;
+}
+
+//---------------------------------------------------------------------------
+// httpstream::bufferused
+//
+// Gets the amount of unread data in the ring buffer
+//
+// Arguments:
+//
+//	NONE
+
+size_t httpstream::bufferused(void) const
+{
+	return readable();
+}
+
 //---------------------------------------------------------------------------
 // httpstream::canseek
 //
@@ -204,6 +416,15 @@ bool httpstream::canseek(void) const
 
 void httpstream::close(void)
 {
+	// Wake up a reconnect that is waiting to try again so that it gives up on the stream
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_closing = true;
+	m_cv.notify_all();
+	lock.unlock();
+
+	// The background transfer thread must be stopped before the handles are released
+	stop_prefetch();
+
 	// Remove the easy handle from the multi handle and close them both out
 	if((m_curlm != nullptr) && (m_curl != nullptr)) curl_multi_remove_handle(m_curlm, m_curl);
 	if(m_curl != nullptr) curl_easy_cleanup(m_curl);
@@ -224,7 +445,22 @@ void httpstream::close(void)
 
 std::unique_ptr<httpstream> httpstream::create(char const* url)
 {
-	return std::unique_ptr<httpstream>(new httpstream(url));
+	return create(url, { false, DEFAULT_RINGBUFFER_SIZE, DEFAULT_RINGBUFFER_SIZE, 0, nullptr, 0 });
+}
+
+//---------------------------------------------------------------------------
+// httpstream::create (static)
+//
+// Factory method, creates a new httpstream instance
+//
+// Arguments:
+//
+//	url				- URL of the stream to be opened
+//	options			- Optional stream behaviors
+
+std::unique_ptr<httpstream> httpstream::create(char const* url, struct options const& options)
+{
+	return std::unique_ptr<httpstream>(new httpstream(url, options));
 }
 
 //---------------------------------------------------------------------------
@@ -277,8 +513,14 @@ size_t httpstream::curl_responseheaders(char const* data, size_t size, size_t co
 		int result = sscanf(data, "Content-Range: bytes %lld-%lld/%lld", &start, &end, &length);
 		if((result == 0) && (sscanf(data, "Content-Range: bytes */%lld", &length)) == 1) start = length;
 
-		// Reset the stream read/write positions and overall length
-		instance->m_startpos = instance->m_readpos = instance->m_writepos = start;
+		// Reset the stream read/write positions if the response doesn't start where the
+		// ring buffer data ends, discarding anything that was preloaded from the seek cache
+		if(start != instance->m_writepos) {
+
+			instance->m_head = instance->m_tail = 0;
+			instance->m_startpos = instance->m_readpos = instance->m_writepos = start;
+		}
+
 		instance->m_length = length;
 	}
 
@@ -297,6 +539,11 @@ size_t httpstream::curl_responseheaders(char const* data, size_t size, size_t co
 
 		// The final header has been processed, indicate that by setting the flag
 		instance->m_headers = true;
+
+		// Only successful responses from a seekable stream are written into the seek cache
+		long responsecode = 0;
+		curl_easy_getinfo(instance->m_curl, CURLINFO_RESPONSE_CODE, &responsecode);
+		instance->m_cachewrites = (instance->m_cache) && (instance->m_canseek) && ((responsecode == 200) || (responsecode == 206));
 	}
 
 	return cb;
@@ -318,39 +565,91 @@ size_t httpstream::curl_write(void const* data, size_t size, size_t count, void*
 {
 	size_t				cb = size * count;			// Calculate the actual byte count
 	size_t				byteswritten = 0;			// Total bytes actually written
+	size_t				skipped = 0;				// Total bytes discarded
 
 	if((data == nullptr) || (cb == 0) || (context == nullptr)) return 0;
 
 	// Cast the context pointer back into a httpstream instance
 	httpstream* instance = reinterpret_cast<httpstream*>(context);
 
+	// After a real-time stream has been reopened, discard data until a sync byte that is followed
+	// by another sync byte one packet later (or the end of the data) has been located
+	if(instance->m_resync) {
+
+		uint8_t const* source = reinterpret_cast<uint8_t const*>(data);
+		while((skipped < cb) && ((source[skipped] != 0x47) || (((skipped + MPEGTS_PACKET_LENGTH) < cb) && 
+			(source[skipped + MPEGTS_PACKET_LENGTH] != 0x47)))) skipped++;
+
+		if(skipped == cb) return cb;				// Nothing to keep
+
+		data = &source[skipped];
+		cb -= skipped;
+	}
+
 	// This operation requires that all of the data be written, if it isn't going to fit in the
 	// available ring buffer space, the input stream has to be paused via CURL_WRITEFUNC_PAUSE
-	size_t available = (instance->m_head < instance->m_tail) ? instance->m_tail - instance->m_head : (instance->m_buffersize - instance->m_head) + instance->m_tail;
-	if(available < (cb + 1)) { instance->m_paused = true; return CURL_WRITEFUNC_PAUSE; }
+	if(instance->writeable() < (cb + 1)) { instance->m_paused = true; instance->m_pauses++; return CURL_WRITEFUNC_PAUSE; }
+
+	// The tail position can be changed by the consumer thread, take a snapshot of it; this
+	// is only the writer so the head position can be maintained locally until the end
+	size_t const tail = instance->m_tail;
+	size_t head = instance->m_head;
 
 	// Write until the buffer has been exhausted or the desired count has been reached
 	while(cb) {
 
 		// If the head is behind the tail linearly, take the data between them otherwise
 		// take the data between the end of the buffer and the head
-		size_t chunk = (instance->m_head < instance->m_tail) ? std::min(cb, instance->m_tail - instance->m_head) : std::min(cb, instance->m_buffersize - instance->m_head);
-		memcpy(&instance->m_buffer[instance->m_head], &reinterpret_cast<uint8_t const*>(data)[byteswritten], chunk);
+		size_t chunk = (head < tail) ? std::min(cb, tail - head) : std::min(cb, instance->m_buffersize - head);
+		memcpy(&instance->m_buffer[head], &reinterpret_cast<uint8_t const*>(data)[byteswritten], chunk);
 
-		instance->m_head += chunk;		// Increment the head position
+		// Data written into the start of the ring buffer is mirrored after the end of it
+		if(head < MPEGTS_PACKET_LENGTH) memcpy(&instance->m_buffer[instance->m_buffersize + head], 
+			&reinterpret_cast<uint8_t const*>(data)[byteswritten], std::min(chunk, MPEGTS_PACKET_LENGTH - head));
+
+		head += chunk;					// Increment the head position
 		byteswritten += chunk;			// Increment number of bytes written
 		cb -= chunk;					// Decrement remaining bytes
 
 		// If the head has reached the end of the buffer, reset it back to zero
-		if(instance->m_head >= instance->m_buffersize) instance->m_head = 0;
+		if(head >= instance->m_buffersize) head = 0;
 	}
 
-	assert(byteswritten == (size * count));		// Verify all bytes were written
+	assert((byteswritten + skipped) == (size * count));		// Verify all bytes were written
+
+	// Add the data to the seek cache before the write position is updated
+	if(instance->m_cachewrites) instance->m_cache->add(instance->m_writepos, reinterpret_cast<uint8_t const*>(data), byteswritten);
 
-	// Increment the number of bytes seen as part of this transfer
+	// Increment the number of bytes seen as part of this transfer and publish the new head
+	// position only after the data has been copied into the ring buffer
 	instance->m_writepos += byteswritten;
+	instance->m_meter.add(byteswritten);
+	instance->m_head = head;
+	instance->m_resync = false;
+
+	// Wake up the consumer if it's waiting on data from the background transfer thread
+	if(instance->m_prefetch) {
+
+		std::unique_lock<std::mutex> lock(instance->m_lock);
+		instance->m_cv.notify_all();
+	}
+
+	return byteswritten + skipped;
+}
+
+//---------------------------------------------------------------------------
+// httpstream::interrupted (private)
+//
+// Determines if the transfer ended before the end of the stream was reached
+//
+// Arguments:
+//
+//	NONE
 
-	return byteswritten;
+bool httpstream::interrupted(void) const
+{
+	// A real-time stream never ends on its own, otherwise the transfer should have reached the length
+	return (m_length == MAX_STREAM_LENGTH) || (m_writepos < m_length);
 }
 
 //---------------------------------------------------------------------------
@@ -381,6 +680,20 @@ char const* httpstream::mediatype(void) const
 	return m_mediatype.c_str();
 }
 
+//---------------------------------------------------------------------------
+// httpstream::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long httpstream::minposition(void) const
+{
+	return m_canseek ? 0 : -1;
+}
+
 //---------------------------------------------------------------------------
 // httpstream::position
 //
@@ -407,70 +720,264 @@ long long httpstream::position(void) const
 
 size_t httpstream::read(uint8_t* buffer, size_t count)
 {
-	size_t				bytesread = 0;			// Total bytes actually read
 	size_t				available = 0;			// Available bytes to read
 
+	// Acquire a contiguous region of the ring buffer and copy it into the destination buffer
+	uint8_t* data = acquire(count, &available);
+	if((buffer != nullptr) && (available > 0)) memcpy(buffer, data, available);
+
+	release(available);
+	return available;
+}
+
+//---------------------------------------------------------------------------
+// httpstream::readable (private)
+//
+// Gets the number of bytes available to be read from the ring buffer
+//
+// Arguments:
+//
+//	NONE
+
+size_t httpstream::readable(void) const
+{
+	size_t const head = m_head;
+	size_t const tail = m_tail;
+
+	return (tail > head) ? (m_buffersize - tail) + head : head - tail;
+}
+
+//---------------------------------------------------------------------------
+// httpstream::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool httpstream::realtime(void) const
+{
+	return (m_length == MAX_STREAM_LENGTH);
+}
+
+//---------------------------------------------------------------------------
+// httpstream::reconnect (private)
+//
+// Reconnects an interrupted stream at the current read position
+//
+// Arguments:
+//
+//	NONE
+
+bool httpstream::reconnect(void)
+{
+	bool const					canseek = m_canseek;				// Flag if stream can be seeked
+	long long const				position = m_readpos;				// Position to reconnect at
+	std::chrono::milliseconds	delay = RECONNECT_INITIAL_DELAY;	// Delay before next attempt
+
 	assert((m_curlm != nullptr) && (m_curl != nullptr));
+	assert(!m_worker.joinable());
 
-	if(count >= m_buffersize) throw std::invalid_argument("count");
+	// Once the reconnect attempts have been exhausted, the stream is left in the finished state
+	if(!m_reconnect) return false;
 
-	// The count should be aligned down to MPEGTS_PACKET_LENGTH
-	count = align::down(count, MPEGTS_PACKET_LENGTH);
-	if(count == 0) return 0;
+	for(int attempt = 0; attempt < RECONNECT_ATTEMPTS; attempt++) {
 
-	// Transfer data into the ring buffer until the minimum amount of data is available, 
-	// the stream has completed, or an exception/error occurs
-	transfer_until([&]() -> bool {
+		// The first attempt is made immediately, subsequent attempts back off exponentially; the
+		// wait is abandoned along with the remaining attempts if the stream is being closed
+		if(attempt > 0) {
 
-		available = (m_tail > m_head) ? (m_buffersize - m_tail) + m_head : m_head - m_tail;
-		return (available >= count);
-	});
+			std::unique_lock<std::mutex> lock(m_lock);
+			if(m_cv.wait_for(lock, delay, [&]() -> bool { return m_closing; })) break;
+			lock.unlock();
 
-	// If there is no available data in the ring buffer after transfer_until, indicate stream is finished
-	if(available == 0) return 0;
+			delay = std::min(delay * 2, RECONNECT_MAXIMUM_DELAY);
+		}
 
-	// Reads are no longer aligned to return full MPEG-TS packets, determine the offset
-	// from the current read position to the first full packet of data
-	size_t packetoffset = static_cast<size_t>(align::up(m_readpos, MPEGTS_PACKET_LENGTH) - m_readpos);
+		try {
 
-	// Starting with the lesser of the amount of data that is available to read and the
-	// originally requested count, adjust the end so that it aligns to a full MPEG-TS packet
-	count = std::min(available, count);
-	if(count >= (packetoffset + MPEGTS_PACKET_LENGTH)) count = packetoffset + align::down(count - packetoffset, MPEGTS_PACKET_LENGTH);
+			// Seekable streams are restarted at the read position with a new range request, real-time
+			// streams that cannot be seeked are reopened and resynchronized on a packet boundary
+			if(canseek) restart(position);
+			else resume();
+
+			m_reconnects++;
+			return true;
+		}
+
+		// HTTP 4xx responses will not be resolved by trying again; HTTP 416: Range not satisfiable
+		// occurs when a stream that was still being recorded has ended
+		catch(http_exception const& ex) { if((ex.responsecode() >= 400) && (ex.responsecode() < 500)) break; }
+
+		// Any other exception is considered transient, try again
+		catch(...) {}
+	}
+
+	m_reconnect = false;
+	return false;
+}
+
+//---------------------------------------------------------------------------
+// httpstream::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
 
-	// Copy the calculated amount of data into the destination buffer
-	while(count) {
+void httpstream::release(size_t count)
+{
+	if(count == 0) return;
+
+	// Advance the tail position to release the data back to the writer
+	size_t tail = m_tail + count;
+	if(tail >= m_buffersize) tail -= m_buffersize;
 
-		// If the tail is behind the head linearly, take the data between them otherwise
-		// take the data between the end of the buffer and the tail
-		size_t chunk = (m_tail < m_head) ? std::min(count, m_head - m_tail) : std::min(count, m_buffersize - m_tail);
-		if(buffer != nullptr) memcpy(&buffer[bytesread], &m_buffer[m_tail], chunk);
+	m_tail = tail;							// Release the data back to the writer
+	m_readpos += count;						// Update the reader position
 
-		m_tail += chunk;					// Increment the tail position
-		bytesread += chunk;					// Increment number of bytes read
-		count -= chunk;						// Decrement remaining bytes
+	// If the background transfer has been paused due to a full ring buffer, wake it up
+	if((m_prefetch) && (m_paused)) {
 
-		// If the tail has reached the end of the buffer, reset it back to zero
-		if(m_tail >= m_buffersize) m_tail = 0;
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_cv.notify_all();
 	}
+}
+
+//---------------------------------------------------------------------------
+// httpstream::reposition (private)
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long httpstream::reposition(long long position, int whence)
+{
+	long long			newposition = 0;				// New stream position
+	long long const		currentpos = m_readpos;			// Current read position
+
+	assert((m_curlm != nullptr) && (m_curl != nullptr));
+	assert(!m_worker.joinable());
+
+	// Calculate the new position of the stream
+	if(whence == SEEK_SET) newposition = std::max(position, 0LL);
+	else if(whence == SEEK_CUR) newposition = currentpos + position;
+	else if(whence == SEEK_END) newposition = m_length + position;
+	else throw std::invalid_argument("whence");
 
-	m_readpos += bytesread;					// Update the reader position
+	// Adjust for overflow/underflow of the new position.  If the seek was forward set it
+	// to numeric_limits<long long>::max, otherwise set it back to zero
+	if(newposition < 0) newposition = (position >= 0) ? std::numeric_limits<long long>::max() : 0;
 
-	return bytesread;
+	// If the calculated position matches the current position there is nothing to do
+	if(newposition == currentpos) return currentpos;
+
+	// Calculate the minimum stream position currently represented in the ring buffer
+	long long minpos = ((m_writepos - m_startpos) > static_cast<long long>(m_buffersize)) ? m_writepos - m_buffersize : m_startpos;
+
+	// If the new position is already represented in the ring buffer, modify the tail pointer to
+	// reference that position for the next read operation rather than restarting the stream
+	if((newposition >= minpos) && (newposition < m_writepos)) {
+
+		// If the buffer hasn't wrapped around yet, the new tail position is relative to buffer[0]
+		if(minpos == m_startpos) m_tail = static_cast<size_t>(newposition - m_startpos);
+
+		else {
+
+			// The buffer has wrapped around at least once, the new tail position is relative to the
+			// current head position rather than the start of the buffer
+			size_t tail = static_cast<size_t>(m_head + (newposition - minpos));
+			if(tail >= m_buffersize) tail -= m_buffersize;
+
+			assert(tail <= m_buffersize);				// Verify tail position is valid
+			m_tail = tail;
+		}
+
+		m_readpos = newposition;						// Set the new tail position
+		return newposition;								// Successful ring buffer seek
+	}
+
+	// Attempt to restart the stream at the calculated position
+	try { return restart(newposition); }
+	catch(http_exception const& ex) {
+		
+		// Recalculate the requested position and try again on HTTP 416: Range not satisfiable,
+		// this can occur when a stream has switched from live (infinite) to recorded (finite)
+		if((ex.responsecode() == 416) && (newposition > m_length)) {
+
+			// This only happens with SEEK_END in practice, but handle them all anyway ...
+			if(whence == SEEK_SET) newposition = std::min(std::max(position, 0LL), m_length);
+			else if(whence == SEEK_CUR) newposition = std::min(currentpos + position, m_length);
+			else if(whence == SEEK_END) newposition = std::min(m_length + position, m_length);
+			else throw std::invalid_argument("whence");
+
+			return restart(newposition);
+		}
+
+		else throw;
+	}
 }
 
 //---------------------------------------------------------------------------
-// httpstream::realtime
+// httpstream::resize (private)
 //
-// Gets a flag indicating if the stream is real-time
+// Changes the size of the ring buffer
 //
 // Arguments:
 //
-//	NONE
+//	buffersize		- New size of the ring buffer
 
-bool httpstream::realtime(void) const
+bool httpstream::resize(size_t buffersize)
 {
-	return (m_length == MAX_STREAM_LENGTH);
+	assert(!m_worker.joinable());
+
+	if(buffersize == m_buffersize) return true;
+
+	// The unread data in the ring buffer must fit; one byte is always left unused
+	size_t const unread = readable();
+	if(unread >= buffersize) return false;
+
+	// Retain as much previously read data as will fit to allow seeks back within the buffer
+	long long minpos = ((m_writepos - m_startpos) > static_cast<long long>(m_buffersize)) ? m_writepos - m_buffersize : m_startpos;
+	size_t retain = static_cast<size_t>(std::min(m_writepos - minpos, static_cast<long long>(buffersize - 1)));
+	assert(retain >= unread);
+
+	// Allocate the new ring buffer, including the mirror of the start of the ring buffer
+	std::unique_ptr<uint8_t[]> buffer(new uint8_t[buffersize + MPEGTS_PACKET_LENGTH]);
+	if(!buffer) throw std::bad_alloc();
+
+	// Copy the retained data into the new buffer starting at buffer[0]; the retained data ends at the head position
+	size_t head = m_head;
+	size_t offset = (head >= retain) ? head - retain : (m_buffersize - (retain - head));
+	size_t copied = 0;
+
+	while(copied < retain) {
+
+		size_t chunk = std::min(retain - copied, m_buffersize - offset);
+		memcpy(&buffer[copied], &m_buffer[offset], chunk);
+
+		copied += chunk;
+		offset += chunk;
+		if(offset >= m_buffersize) offset = 0;
+	}
+
+	// Mirror the start of the new ring buffer after the end of it
+	memcpy(&buffer[buffersize], &buffer[0], std::min(retain, MPEGTS_PACKET_LENGTH));
+
+	// Swap in the new ring buffer and adjust the positions; the start position is adjusted so
+	// that it indicates the stream position of the data at buffer[0] for seek()
+	m_buffer = std::move(buffer);
+	m_buffersize = buffersize;
+	m_head = retain;
+	m_tail = retain - unread;
+	m_startpos = m_writepos - static_cast<long long>(retain);
+
+	return true;
 }
 
 //---------------------------------------------------------------------------
@@ -485,25 +992,46 @@ bool httpstream::realtime(void) const
 long long httpstream::restart(long long position)
 {
 	size_t		available = 0;				// Amount of available ring buffer data
+	size_t		cached = 0;					// Amount of data available from the seek cache
 
 	assert((m_curlm != nullptr) && (m_curl != nullptr));
+	assert(!m_worker.joinable());
 	assert(position >= 0);
 
 	// Remove the easy transfer handle from the multi transfer handle
 	CURLMcode curlmresult = curl_multi_remove_handle(m_curlm, m_curl);
 	if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_remove_handle() failed: ", curl_multi_strerror(curlmresult));
 
+	// Determine how much data at the new position can be served from the seek cache; this has to fit in the
+	// ring buffer and cannot reach the end of the stream, otherwise the subsequent range request would fail
+	if((m_cache) && (position < m_length)) 
+		cached = static_cast<size_t>(std::min(static_cast<long long>(std::min(m_cache->available(position), m_buffersize - 1)), m_length - position - 1));
+
 	// Reset all of the stream state and ring buffer values back to the defaults; leave the 
 	// start time and start presentation timestamp values at their original values
-	m_paused = m_headers = m_canseek = false;
+	m_paused = m_headers = m_cachewrites = m_resync = false;
 	m_head = m_tail = 0;
+	m_restarts++;
 	m_startpos = m_readpos = m_writepos = 0;
-	m_length = MAX_STREAM_LENGTH;
+	m_exception = nullptr;
+
+	// If there is no cached data, the stream length and seekability are unknown until the
+	// headers have been processed, otherwise preload the ring buffer with the cached data
+	if(cached == 0) { m_canseek = false; m_length = MAX_STREAM_LENGTH; }
+	else {
+
+		cached = m_cache->read(position, &m_buffer[0], cached);
+		memcpy(&m_buffer[m_buffersize], &m_buffer[0], std::min(cached, MPEGTS_PACKET_LENGTH));
+
+		m_startpos = m_readpos = position;
+		m_writepos = position + static_cast<long long>(cached);
+		m_head = cached;
+	}
 
 	// Format the Range: header value to apply to the transfer object, do not use CURLOPT_RESUME_FROM_LARGE 
 	// as it will not insert the request header when the position is zero
 	char byterange[32] = { '\0' };
-	snprintf(byterange, std::extent<decltype(byterange)>::value, "%lld-", std::max(position, 0LL));
+	snprintf(byterange, std::extent<decltype(byterange)>::value, "%lld-", std::max(position + static_cast<long long>(cached), 0LL));
 
 	// Attempt to execute the current transfer operation
 	CURLcode curlresult = curl_easy_setopt(m_curl, CURLOPT_RANGE, byterange);
@@ -514,11 +1042,22 @@ long long httpstream::restart(long long position)
 	curlmresult = curl_multi_add_handle(m_curlm, m_curl);
 	if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_remove_handle() failed: ", curl_multi_strerror(curlmresult));
 
+	// If the ring buffer was preloaded from the seek cache, send the request but don't wait for the
+	// response; the cached data can be read while the transfer catches up in the background
+	if(cached > 0) {
+
+		int numfds = 0;
+		curlmresult = curl_multi_perform(m_curlm, &numfds);
+		if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_perform() failed: ", curl_multi_strerror(curlmresult));
+
+		return m_readpos;
+	}
+
 	// Attempt to begin the data transfer and wait for both the HTTP headers to be processed
 	// and for the initial chunk of data to become available in the ring buffer
 	transfer_until([&]() -> bool { 
 					
-		available = (m_tail > m_head) ? (m_buffersize - m_tail) + m_head : m_head - m_tail;
+		available = readable();
 		return ((m_headers == true) && (available > 0));
 	});
 
@@ -528,6 +1067,65 @@ long long httpstream::restart(long long position)
 	return m_readpos;					// Return new starting position of the stream
 }
 
+//---------------------------------------------------------------------------
+// httpstream::resume (private)
+//
+// Reopens an interrupted real-time stream
+//
+// Arguments:
+//
+//	NONE
+
+void httpstream::resume(void)
+{
+	size_t		available = 0;				// Amount of available ring buffer data
+
+	assert((m_curlm != nullptr) && (m_curl != nullptr));
+	assert(!m_worker.joinable());
+
+	// Remove the easy transfer handle from the multi transfer handle
+	CURLMcode curlmresult = curl_multi_remove_handle(m_curlm, m_curl);
+	if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_remove_handle() failed: ", curl_multi_strerror(curlmresult));
+
+	// Reset the transfer state; unlike restart() the ring buffer and stream positions are retained
+	m_paused = m_headers = m_cachewrites = false;
+	m_exception = nullptr;
+
+	// The last packet received before the interruption may be incomplete, discard whatever part of it
+	// hasn't been read yet so that the data received after reopening the stream starts on a packet boundary
+	size_t const partial = std::min(static_cast<size_t>(m_writepos - align::down(m_writepos, MPEGTS_PACKET_LENGTH)), readable());
+	if(partial > 0) {
+
+		size_t head = m_head;
+		head = (head >= partial) ? head - partial : m_buffersize - (partial - head);
+
+		m_writepos -= static_cast<long long>(partial);
+		m_head = head;
+	}
+
+	// Data received from the reopened stream is discarded until the packet boundary is located
+	m_resync = true;
+	size_t const pending = readable();
+
+	// A real-time stream is reopened from wherever the server currently is, don't request a range
+	CURLcode curlresult = curl_easy_setopt(m_curl, CURLOPT_RANGE, nullptr);
+	if(curlresult != CURLE_OK) throw string_exception(__func__, ": curl_easy_setopt() failed: ", curl_easy_strerror(curlresult));
+
+	// Add the easy transfer handle back to the multi transfer handle to reopen the stream
+	curlmresult = curl_multi_add_handle(m_curlm, m_curl);
+	if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_add_handle() failed: ", curl_multi_strerror(curlmresult));
+
+	// Wait for both the HTTP headers to be processed and for new data to become available
+	transfer_until([&]() -> bool {
+
+		available = readable();
+		return ((m_headers == true) && (available > pending));
+	});
+
+	if(!m_headers) throw string_exception(__func__, ": failed to receive HTTP response headers");
+	if(available <= pending) throw string_exception(__func__, ": failed to receive HTTP response body");
+}
+
 //---------------------------------------------------------------------------
 // httpstream::seek
 //
@@ -541,69 +1139,117 @@ long long httpstream::restart(long long position)
 long long httpstream::seek(long long position, int whence)
 {
 	long long			newposition = 0;				// New stream position
-	long long const		currentpos = m_readpos;			// Current read position
 
 	assert((m_curlm != nullptr) && (m_curl != nullptr));
 
 	// If the stream cannot be seeked, return -1 to indicate the operation is not supported.
 	if(!m_canseek) return -1;
 
-	// Calculate the new position of the stream
-	if(whence == SEEK_SET) newposition = std::max(position, 0LL);
-	else if(whence == SEEK_CUR) newposition = currentpos + position;
-	else if(whence == SEEK_END) newposition = m_length + position;
-	else throw std::invalid_argument("whence");
+	// The background transfer thread has to be stopped while the ring buffer is manipulated
+	stop_prefetch();
 
-	// Adjust for overflow/underflow of the new position.  If the seek was forward set it
-	// to numeric_limits<long long>::max, otherwise set it back to zero
-	if(newposition < 0) newposition = (position >= 0) ? std::numeric_limits<long long>::max() : 0;
+	try { newposition = reposition(position, whence); }
+	catch(...) { start_prefetch(); throw; }
 
-	// If the calculated position matches the current position there is nothing to do
-	if(newposition == currentpos) return currentpos;
+	start_prefetch();
 
-	// Calculate the minimum stream position currently represented in the ring buffer
-	long long minpos = ((m_writepos - m_startpos) > static_cast<long long>(m_buffersize)) ? m_writepos - m_buffersize : m_startpos;
+	return newposition;
+}
 
-	// If the new position is already represented in the ring buffer, modify the tail pointer to
-	// reference that position for the next read operation rather than restarting the stream
-	if((newposition >= minpos) && (newposition < m_writepos)) {
+//---------------------------------------------------------------------------
+// httpstream::start_prefetch (private)
+//
+// Starts the background data transfer thread
+//
+// Arguments:
+//
+//	NONE
 
-		// If the buffer hasn't wrapped around yet, the new tail position is relative to buffer[0]
-		if(minpos == m_startpos) m_tail = static_cast<size_t>(newposition - m_startpos);
+void httpstream::start_prefetch(void)
+{
+	assert((m_curlm != nullptr) && (m_curl != nullptr));
 
-		else {
+	// Prefetch is optional; the data transfer will be performed on demand by read()
+	if((!m_prefetch) || (m_worker.joinable())) return;
 
-			// The buffer has wrapped around at least once, the new tail position is relative to the
-			// current head position rather than the start of the buffer
-			m_tail = static_cast<size_t>(m_head + (newposition - minpos));
-			if(m_tail >= m_buffersize) m_tail -= m_buffersize;
+	m_stop = false;						// Reset the stop signal
+	m_finished = false;					// Reset the finished flag
 
-			assert(m_tail <= m_buffersize);				// Verify tail position is valid
-		}
+	// Define and launch the data transfer worker thread
+	m_worker = std::thread([&]() -> void {
 
-		m_readpos = newposition;						// Set the new tail position
-		return newposition;								// Successful ring buffer seek
-	}
+		try {
 
-	// Attempt to restart the stream at the calculated position
-	try { return restart(newposition); }
-	catch(http_exception const& ex) {
-		
-		// Recalculate the requested position and try again on HTTP 416: Range not satisfiable,
-		// this can occur when a stream has switched from live (infinite) to recorded (finite)
-		if((ex.responsecode() == 416) && (newposition > m_length)) {
+			while(true) {
 
-			// This only happens with SEEK_END in practice, but handle them all anyway ...
-			if(whence == SEEK_SET) newposition = std::min(std::max(position, 0LL), m_length);
-			else if(whence == SEEK_CUR) newposition = std::min(currentpos + position, m_length);
-			else if(whence == SEEK_END) newposition = std::min(m_length + position, m_length);
-			else throw std::invalid_argument("whence");
+				// If the transfer has been paused due to a full ring buffer, wait until the consumer has
+				// freed up enough space to make resuming it worthwhile or the thread has been signaled to stop
+				if(m_paused) {
 
-			return restart(newposition);
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_cv.wait(lock, [&]() -> bool { return (m_stop) || (writeable() >= (m_buffersize / PREFETCH_RESUME_DIVISOR)); });
+				}
+
+				if(m_stop) break;
+
+				// Execute the data transfer until signaled to stop, the ring buffer has filled up, or the
+				// transfer has completed.  If the transfer was neither stopped nor paused, it has completed
+				transfer_until([&]() -> bool { return m_stop; });
+				if((!m_stop) && (!m_paused)) break;
+			}
 		}
 
-		else throw;
-	}
+		// Exceptions that occur on the worker thread are rethrown by read() after the data has been consumed
+		catch(...) { std::unique_lock<std::mutex> lock(m_lock); m_exception = std::current_exception(); }
+
+		// Indicate that the transfer has finished and wake up the consumer
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_finished = true;
+		m_cv.notify_all();
+	});
+}
+
+//---------------------------------------------------------------------------
+// httpstream::stop_prefetch (private)
+//
+// Stops the background data transfer thread
+//
+// Arguments:
+//
+//	NONE
+
+void httpstream::stop_prefetch(void)
+{
+	if(!m_worker.joinable()) return;		// Not running
+
+	// Signal the worker thread to stop, wake it up from any wait it may be in, and wait for it to exit
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_stop = true;
+	m_cv.notify_all();
+	lock.unlock();
+
+	curl_multi_wakeup(m_curlm);
+	m_worker.join();
+}
+
+//---------------------------------------------------------------------------
+// httpstream::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void httpstream::telemetry(telemetry_t& values) const
+{
+	values.emplace_back("httpstream.buffer_size", static_cast<long long>(m_buffersize));
+	values.emplace_back("httpstream.buffer_used", static_cast<long long>(bufferused()));
+	values.emplace_back("httpstream.bytes_per_second", static_cast<long long>(m_meter.bytespersecond()));
+	values.emplace_back("httpstream.pauses", static_cast<long long>(m_pauses.load()));
+	values.emplace_back("httpstream.resumes", static_cast<long long>(m_resumes.load()));
+	values.emplace_back("httpstream.restarts", static_cast<long long>(m_restarts));
+	values.emplace_back("httpstream.reconnects", static_cast<long long>(m_reconnects));
 }
 
 //---------------------------------------------------------------------------
@@ -629,6 +1275,7 @@ bool httpstream::transfer_until(std::function<bool(void)> predicate)
 	if(m_paused) {
 
 		m_paused = false;									// Reset the stream paused flag
+		m_resumes++;										// Track the number of resumes
 		curl_easy_pause(m_curl, CURLPAUSE_CONT);			// Resume transfer on the stream
 
 		if(m_paused) return predicate();					// Still paused, abort
@@ -642,7 +1289,7 @@ bool httpstream::transfer_until(std::function<bool(void)> predicate)
 	// transfer operation is complete, or the stream has been paused due to a full buffer condition
 	while((curlmresult == CURLM_OK) && (!m_paused) && (numfds > 0) && (predicate() == false)) {
 
-		curlmresult = curl_multi_wait(m_curlm, nullptr, 0, 500, nullptr);
+		curlmresult = curl_multi_poll(m_curlm, nullptr, 0, 500, nullptr);
 		if(curlmresult == CURLM_OK) curlmresult = curl_multi_perform(m_curlm, &numfds);
 	}
 
@@ -674,6 +1321,23 @@ bool httpstream::transfer_until(std::function<bool(void)> predicate)
 	return predicate();				// Re-evaluate the predicate as the result
 }
 
+//---------------------------------------------------------------------------
+// httpstream::writeable (private)
+//
+// Gets the number of bytes available to be written into the ring buffer
+//
+// Arguments:
+//
+//	NONE
+
+size_t httpstream::writeable(void) const
+{
+	size_t const head = m_head;
+	size_t const tail = m_tail;
+
+	return (head < tail) ? tail - head : (m_buffersize - head) + tail;
+}
+
 //---------------------------------------------------------------------------
 
 #pragma warning(pop)
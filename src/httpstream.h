@@ -26,12 +26,20 @@
 
 #pragma warning(push, 4)
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 
+#include "bitratemeter.h"
 #include "pvrstream.h"
+#include "segmentcache.h"
 
 //---------------------------------------------------------------------------
 // Class httpstream
@@ -42,6 +50,19 @@ class httpstream : public pvrstream
 {
 public:
 
+	// options
+	//
+	// Structure used to define the optional behaviors of the stream
+	struct options {
+
+		bool			prefetch;			// Transfer data on a background thread
+		size_t			minbuffersize;		// Minimum ring buffer size
+		size_t			maxbuffersize;		// Maximum ring buffer size
+		size_t			seekcachesize;		// Seek cache memory size
+		char const*		seekcachefile;		// Seek cache spill file path
+		size_t			seekcachefilesize;	// Seek cache spill file size
+	};
+
 	// Destructor
 	//
 	virtual ~httpstream();
@@ -49,6 +70,21 @@ public:
 	//-----------------------------------------------------------------------
 	// Member Functions
 
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
+	// buffersize
+	//
+	// Gets the current size of the ring buffer
+	size_t buffersize(void) const;
+
+	// bufferused
+	//
+	// Gets the amount of unread data in the ring buffer
+	size_t bufferused(void) const;
+
 	// canseek
 	//
 	// Flag indicating if the stream allows seek operations
@@ -63,6 +99,7 @@ public:
 	//
 	// Factory method, creates a new httpstream instance
 	static std::unique_ptr<httpstream> create(char const* url);
+	static std::unique_ptr<httpstream> create(char const* url, struct options const& options);
 
 	// length
 	//
@@ -74,6 +111,11 @@ public:
 	// Gets the media type of the stream
 	char const* mediatype(void) const;
 
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
 	// position
 	//
 	// Gets the current position of the stream
@@ -89,11 +131,21 @@ public:
 	// Gets a flag indicating if the stream is real-time
 	bool realtime(void) const;
 
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
 	// seek
 	//
 	// Sets the stream pointer to a specific position
 	long long seek(long long position, int whence);
 
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
 private:
 
 	httpstream(httpstream const&)=delete;
@@ -104,6 +156,11 @@ private:
 	// Default media type to report for the stream
 	static char const* DEFAULT_MEDIA_TYPE;
 
+	// BUFFER_TARGET_SECONDS
+	//
+	// Amount of stream data the adaptive ring buffer is sized to hold
+	static unsigned int const BUFFER_TARGET_SECONDS;
+
 	// DEFAULT_RINGBUFFER_SIZE
 	//
 	// Default ring buffer size, in bytes
@@ -119,9 +176,34 @@ private:
 	// Length of a single mpeg-ts data packet
 	static size_t const MPEGTS_PACKET_LENGTH;
 
+	// PREFETCH_RESUME_DIVISOR
+	//
+	// Fraction of the ring buffer that must be free to resume a paused prefetch
+	static size_t const PREFETCH_RESUME_DIVISOR;
+
+	// RECONNECT_ATTEMPTS
+	//
+	// Maximum number of attempts to reconnect an interrupted stream
+	static int const RECONNECT_ATTEMPTS;
+
+	// RECONNECT_INITIAL_DELAY
+	//
+	// Delay before the second attempt to reconnect an interrupted stream
+	static std::chrono::milliseconds const RECONNECT_INITIAL_DELAY;
+
+	// RECONNECT_MAXIMUM_DELAY
+	//
+	// Maximum delay between attempts to reconnect an interrupted stream
+	static std::chrono::milliseconds const RECONNECT_MAXIMUM_DELAY;
+
+	// RINGBUFFER_ALIGNMENT
+	//
+	// Alignment of an adaptive ring buffer size
+	static size_t const RINGBUFFER_ALIGNMENT;
+
 	// Instance Constructor
 	//
-	httpstream(char const* url);
+	httpstream(char const* url, struct options const& options);
 
 	//-----------------------------------------------------------------------
 	// Private Member Functions
@@ -131,21 +213,71 @@ private:
 	// libcurl callback to handle processing of response headers
 	static size_t curl_responseheaders(char const* data, size_t size, size_t count, void* context);
 
+	// autosize
+	//
+	// Adjusts the size of the ring buffer based on the measured bitrate
+	void autosize(void);
+
 	// curl_write (static)
 	//
 	// libcurl callback to write received data into the buffer
 	static size_t curl_write(void const* data, size_t size, size_t count, void* context);
 
+	// interrupted
+	//
+	// Determines if the transfer ended before the end of the stream
+	bool interrupted(void) const;
+
+	// readable
+	//
+	// Gets the number of bytes available to be read from the ring buffer
+	size_t readable(void) const;
+
+	// reconnect
+	//
+	// Reconnects an interrupted stream at the current read position
+	bool reconnect(void);
+
+	// reposition
+	//
+	// Sets the stream pointer to a specific position
+	long long reposition(long long position, int whence);
+
+	// resize
+	//
+	// Changes the size of the ring buffer
+	bool resize(size_t buffersize);
+
 	// restart
 	//
 	// Restarts the stream at the specified position
 	long long restart(long long position);
 
+	// resume
+	//
+	// Reopens an interrupted real-time stream
+	void resume(void);
+
+	// start_prefetch
+	//
+	// Starts the background data transfer thread
+	void start_prefetch(void);
+
+	// stop_prefetch
+	//
+	// Stops the background data transfer thread
+	void stop_prefetch(void);
+
 	// transfer_until
 	//
 	// Executes the data tranfer until the predicate has been satisfied
 	bool transfer_until(std::function<bool(void)> predicate);
 
+	// writeable
+	//
+	// Gets the number of bytes available to be written into the ring buffer
+	size_t writeable(void) const;
+
 	//-----------------------------------------------------------------------
 	// Member Variables
 
@@ -157,7 +289,7 @@ private:
 
 	// STREAM STATE
 	//
-	bool						m_paused = false;					// Flag if transfer is paused
+	std::atomic<bool>			m_paused{false};					// Flag if transfer is paused
 	bool						m_headers = false;					// Flag if headers have been processed
 	bool						m_canseek = false;					// Flag if stream can be seeked
 	long long					m_startpos = 0;						// Starting position
@@ -165,13 +297,44 @@ private:
 	long long					m_writepos = 0;						// Current write position
 	std::string					m_mediatype = DEFAULT_MEDIA_TYPE;	// Stream media type 
 	long long					m_length = MAX_STREAM_LENGTH;		// Length of the stream
+	bool						m_reconnect = true;					// Flag if stream can be reconnected
+	bool						m_resync = false;					// Flag to resync on a packet boundary
 
 	// RING BUFFER
 	//
-	size_t const				m_buffersize;						// Size of the ring buffer
+	size_t						m_buffersize;						// Size of the ring buffer
 	std::unique_ptr<uint8_t[]>	m_buffer;							// Ring buffer stroage
-	size_t						m_head = 0;							// Head (write) buffer position
-	size_t						m_tail = 0;							// Tail (read) buffer position
+	std::atomic<size_t>			m_head{0};							// Head (write) buffer position
+	std::atomic<size_t>			m_tail{0};							// Tail (read) buffer position
+
+	// ADAPTIVE BUFFER
+	//
+	size_t const				m_minbuffersize;					// Minimum ring buffer size
+	size_t const				m_maxbuffersize;					// Maximum ring buffer size
+	bitratemeter				m_meter;							// Incoming bitrate meter
+
+	// PREFETCH
+	//
+	bool const					m_prefetch;							// Flag if prefetch is enabled
+	std::thread					m_worker;							// Data transfer thread
+	mutable std::mutex			m_lock;								// Synchronization object
+	std::condition_variable		m_cv;								// Wakeup condition variable
+	std::atomic<bool>			m_stop{false};						// Flag to stop the worker
+	bool						m_closing = false;					// Flag if stream is being closed
+	bool						m_finished = false;					// Flag if transfer has finished
+	std::exception_ptr			m_exception;						// Exception from the transfer
+
+	// SEEK CACHE
+	//
+	std::unique_ptr<segmentcache>	m_cache;						// Previously transferred data
+	bool						m_cachewrites = false;				// Flag if transfer is being cached
+
+	// TELEMETRY
+	//
+	std::atomic<size_t>			m_pauses{0};						// Number of transfer pauses
+	std::atomic<size_t>			m_resumes{0};						// Number of transfer resumes
+	size_t						m_restarts = 0;						// Number of transfer restarts
+	size_t						m_reconnects = 0;					// Number of transfer reconnects
 };
 
 //-----------------------------------------------------------------------------
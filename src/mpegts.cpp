@@ -0,0 +1,408 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "mpegts.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#endif
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// crc32_mpeg2_table (local)
+//
+// Lookup table for the crc32_mpeg2 function
+//
+// https://gist.github.com/Miliox/b86b60b9755faf3bd7cf
+// Emiliano Firmino
+
+static uint32_t crc32_mpeg2_table[256] = {
+
+	0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
+	0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
+	0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd, 0x4c11db70, 0x48d0c6c7,
+	0x4593e01e, 0x4152fda9, 0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75,
+	0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011, 0x791d4014, 0x7ddc5da3,
+	0x709f7b7a, 0x745e66cd, 0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039,
+	0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5, 0xbe2b5b58, 0xbaea46ef,
+	0xb7a96036, 0xb3687d81, 0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
+	0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49, 0xc7361b4c, 0xc3f706fb,
+	0xceb42022, 0xca753d95, 0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1,
+	0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d, 0x34867077, 0x30476dc0,
+	0x3d044b19, 0x39c556ae, 0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072,
+	0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16, 0x018aeb13, 0x054bf6a4,
+	0x0808d07d, 0x0cc9cdca, 0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde,
+	0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02, 0x5e9f46bf, 0x5a5e5b08,
+	0x571d7dd1, 0x53dc6066, 0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
+	0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e, 0xbfa1b04b, 0xbb60adfc,
+	0xb6238b25, 0xb2e29692, 0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6,
+	0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a, 0xe0b41de7, 0xe4750050,
+	0xe9362689, 0xedf73b3e, 0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2,
+	0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686, 0xd5b88683, 0xd1799b34,
+	0xdc3abded, 0xd8fba05a, 0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637,
+	0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb, 0x4f040d56, 0x4bc510e1,
+	0x46863638, 0x42472b8f, 0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
+	0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47, 0x36194d42, 0x32d850f5,
+	0x3f9b762c, 0x3b5a6b9b, 0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff,
+	0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623, 0xf12f560e, 0xf5ee4bb9,
+	0xf8ad6d60, 0xfc6c70d7, 0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b,
+	0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f, 0xc423cd6a, 0xc0e2d0dd,
+	0xcda1f604, 0xc960ebb3, 0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7,
+	0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b, 0x9b3660c6, 0x9ff77d71,
+	0x92b45ba8, 0x9675461f, 0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
+	0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640, 0x4e8ee645, 0x4a4ffbf2,
+	0x470cdd2b, 0x43cdc09c, 0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8,
+	0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24, 0x119b4be9, 0x155a565e,
+	0x18197087, 0x1cd86d30, 0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec,
+	0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088, 0x2497d08d, 0x2056cd3a,
+	0x2d15ebe3, 0x29d4f654, 0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0,
+	0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c, 0xe3a1cbc1, 0xe760d676,
+	0xea23f0af, 0xeee2ed18, 0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
+	0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662,
+	0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
+	0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
+};
+
+//---------------------------------------------------------------------------
+// section_start (local)
+//
+// Locates the start of the PSI section in a packet, or nullptr if the packet
+// does not start a section
+//
+// Arguments:
+//
+//	packet		- Pointer to the mpeg-ts packet
+
+static uint8_t const* section_start(uint8_t const* packet)
+{
+	uint32_t header = mpegts::read_be32(packet);
+
+	// A section can only start in a packet that has the sync byte, a payload and the payload unit start indicator
+	if(((header & 0xFF000000) != 0x47000000) || ((header & 0x00400000) != 0x00400000) || ((header & 0x00000010) != 0x00000010)) return nullptr;
+
+	// Move the pointer beyond the TS header and any adaptation field
+	uint8_t const* current = packet + 4U;
+	if((header & 0x00000020) == 0x00000020) current += mpegts::read_be8(current) + 1U;
+
+	// The payload starts with a pointer field that indicates where the section begins
+	if(current >= (packet + mpegts::PACKET_LENGTH)) return nullptr;
+	current += mpegts::read_be8(current) + 1U;
+
+	return (current < (packet + mpegts::PACKET_LENGTH)) ? current : nullptr;
+}
+
+namespace mpegts {
+
+//---------------------------------------------------------------------------
+// mpegts::null_packet
+//
+// MPEG-TS null data packet
+
+uint8_t const null_packet[PACKET_LENGTH] = {
+
+	0x47, 0x1F, 0xFF, 0x10, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+//---------------------------------------------------------------------------
+// mpegts::crc32
+//
+// Calculates a CRC32/MPEG2 value for the specified byte range
+//
+// https://gist.github.com/Miliox/b86b60b9755faf3bd7cf
+// Emiliano Firmino
+//
+// Arguments:
+//
+//	data		- Pointer to the data
+//	length		- Length of the data
+
+uint32_t crc32(uint8_t const* data, size_t length)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	for(size_t index = 0; index < length; index++)
+		crc = (crc << 8) ^ crc32_mpeg2_table[((crc >> 24) ^ *data++) & 0xFF];
+
+	return crc;
+}
+
+//---------------------------------------------------------------------------
+// mpegts::describe_stream
+//
+// Describes an elementary stream from a Program Map Table stream entry
+//
+// Arguments:
+//
+//	entry		- Pointer to the Program Map Table stream entry
+
+struct elementarystream describe_stream(uint8_t const* entry)
+{
+	struct elementarystream stream = { 0, 0, nullptr, std::string() };
+
+	stream.streamtype = read_be8(entry);
+	stream.pid = read_be16(entry + 1U) & 0x1FFF;
+	uint16_t esinfolen = read_be16(entry + 3U) & 0x03FF;
+
+	// The codec names are those recognized by Kodi/ffmpeg; ATSC and DVB carry the same audio
+	// codecs differently, ATSC uses dedicated stream types and DVB uses descriptors
+	switch(stream.streamtype) {
+
+		case 0x01: stream.codec = "mpeg2video"; break;
+		case 0x02: stream.codec = "mpeg2video"; break;
+		case 0x03: stream.codec = "mp2"; break;
+		case 0x04: stream.codec = "mp2"; break;
+		case 0x0F: stream.codec = "aac"; break;
+		case 0x10: stream.codec = "mpeg4"; break;
+		case 0x11: stream.codec = "aac_latm"; break;
+		case 0x1B: stream.codec = "h264"; break;
+		case 0x24: stream.codec = "hevc"; break;
+		case 0x81: stream.codec = "ac3"; break;
+		case 0x87: stream.codec = "eac3"; break;
+		case 0xEA: stream.codec = "vc1"; break;
+	}
+
+	// Walk the elementary stream descriptors to pick up the language and any codec information
+	uint8_t const* descriptor = entry + 5U;
+	uint8_t const* end = descriptor + esinfolen;
+
+	while((descriptor + 2U) <= end) {
+
+		uint8_t tag = read_be8(descriptor);
+		uint8_t length = read_be8(descriptor + 1U);
+		if((descriptor + 2U + length) > end) break;
+
+		// 0x0A = ISO 639 language descriptor
+		if((tag == 0x0A) && (length >= 3)) stream.language.assign(reinterpret_cast<char const*>(descriptor + 2U), 3);
+
+		// 0x6A = AC-3 descriptor; 0x7A = Enhanced AC-3 descriptor (DVB private data streams)
+		else if((tag == 0x6A) && (stream.streamtype == 0x06)) stream.codec = "ac3";
+		else if((tag == 0x7A) && (stream.streamtype == 0x06)) stream.codec = "eac3";
+
+		// 0x7F = Extension descriptor; 0x15 = AC-4 descriptor
+		else if((tag == 0x7F) && (length >= 1) && (read_be8(descriptor + 2U) == 0x15) && (stream.streamtype == 0x06)) stream.codec = "ac4";
+
+		descriptor += 2U + length;
+	}
+
+	return stream;
+}
+
+//---------------------------------------------------------------------------
+// mpegts::enumerate_pat
+//
+// Enumerates the programs listed in a Program Association Table packet
+//
+// Arguments:
+//
+//	packet		- Pointer to the Program Association Table packet
+//	callback	- Function invoked for each listed program
+
+void enumerate_pat(uint8_t const* packet, std::function<void(uint16_t program, uint16_t pmtpid)> const& callback)
+{
+	uint8_t const* end = packet + PACKET_LENGTH;
+
+	// Only packets that start a section are examined; the PAT is expected to fit in one packet
+	uint8_t const* current = section_start(packet);
+	if((current == nullptr) || ((current + 8U) > end)) return;
+
+	// Watch out for a TABLEID of 0xFF, this indicates that the remainder
+	// of the packet is just stuffed with 0xFF and nothing useful is here
+	if(read_be8(current) != 0x00) return;
+
+	// The program entries follow the 8 byte section header and precede the 4 byte CRC
+	uint16_t sectionlength = read_be16(current + 1U) & 0x0FFF;
+	uint8_t const* tableend = std::min(current + 3U + sectionlength - 4U, end);
+
+	for(uint8_t const* program = current + 8U; (program + 4U) <= tableend; program += 4U)
+		callback(read_be16(program), read_be16(program + 2U) & 0x1FFF);
+}
+
+//---------------------------------------------------------------------------
+// mpegts::enumerate_pmt
+//
+// Enumerates the stream entries listed in a Program Map Table packet
+//
+// Arguments:
+//
+//	packet		- Pointer to the Program Map Table packet
+//	callback	- Function invoked for each stream entry; returns true if modified
+
+void enumerate_pmt(uint8_t* packet, std::function<bool(uint8_t* entry)> const& callback)
+{
+	uint8_t* end = packet + PACKET_LENGTH;
+
+	// Only packets that start a section are examined; the PMT is expected to fit in one packet
+	uint8_t* current = const_cast<uint8_t*>(section_start(packet));
+	if(current == nullptr) return;
+
+	// There may be multiple tables in the PMT PID like 0xC0 (SCTE Program Information Message);
+	// iterate over each table to locate 0x02 (Program Map Table) until 0xFF is located
+	while(((current + 3U) <= end) && (read_be8(current) != 0xFF)) {
+
+		uint16_t sectionlength = read_be16(current + 1U) & 0x0FFF;
+		if((current + 3U + sectionlength) > end) break;
+
+		// 0x02 = Program Map Table
+		if((read_be8(current) == 0x02) && (sectionlength >= 13U)) {
+
+			// Get the length of the table less the CRC and the length of the N-loop descriptors
+			size_t tablelength = static_cast<size_t>(3U) + sectionlength - 4U;
+			uint16_t descriptorslen = read_be16(current + 10U) & 0x03FF;
+
+			// Now come the stream entries; the callback is allowed to modify them
+			bool modified = false;
+			uint8_t* entry = current + 12U + descriptorslen;
+			while((entry + 5U) <= (current + tablelength)) {
+
+				uint16_t esinfolen = read_be16(entry + 3U) & 0x03FF;
+				if((entry + 5U + esinfolen) > (current + tablelength)) break;
+
+				if(callback(entry)) modified = true;
+				entry += (5U + esinfolen);
+			}
+
+			// Recalculate and rewrite the CRC for the PMT table after it's been modified
+			if(modified) write_be32(crc32(current, tablelength), current + tablelength);
+		}
+
+		// Skip to the next table in the PMT PID
+		current += 3U + sectionlength;
+	}
+}
+
+//---------------------------------------------------------------------------
+// mpegts::extract_pids
+//
+// Validates the sync bytes and extracts the program ids from a batch of packets
+//
+// Arguments:
+//
+//	buffer		- Pointer to the aligned mpeg-ts packets
+//	count		- Number of mpeg-ts packets in the buffer
+//	pids		- Receives the packet ids; 0xFFFF if the sync byte is invalid
+
+void extract_pids(uint8_t const* buffer, size_t count, uint16_t* pids)
+{
+	size_t			index = 0;				// Current packet index
+
+	// The transport stream header is loaded as a little-endian 32-bit value; the sync byte
+	// is in the low order bits and the PID is split across the next two bytes:
+	//
+	// sync = (header & 0xFF)
+	// pid  = (header & 0x1F00) | ((header >> 16) & 0xFF)
+	//
+	// SSE2 is part of the baseline of every x86-64 target (and of the 32-bit Windows builds), so
+	// it's used whenever the compiler targets it; everything else uses the scalar loop below
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+
+	__m128i const syncbyte = _mm_set1_epi32(0x47);
+	__m128i const lowbyte = _mm_set1_epi32(0xFF);
+	__m128i const pidmask = _mm_set1_epi32(0x1F00);
+	__m128i const allbits = _mm_set1_epi32(-1);
+
+	// Load and classify 8 packet headers at a time, 4 per vector
+	for(; (count - index) >= 8; index += 8) {
+
+		int32_t headers[8];
+		for(size_t packet = 0; packet < 8; packet++) memcpy(&headers[packet], &buffer[(index + packet) * 188], sizeof(int32_t));
+
+		__m128i lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&headers[0]));
+		__m128i hi = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&headers[4]));
+
+		__m128i lopid = _mm_or_si128(_mm_and_si128(lo, pidmask), _mm_and_si128(_mm_srli_epi32(lo, 16), lowbyte));
+		__m128i hipid = _mm_or_si128(_mm_and_si128(hi, pidmask), _mm_and_si128(_mm_srli_epi32(hi, 16), lowbyte));
+
+		lopid = _mm_or_si128(lopid, _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(lo, lowbyte), syncbyte), allbits));
+		hipid = _mm_or_si128(hipid, _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(hi, lowbyte), syncbyte), allbits));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&pids[index]), _mm_packs_epi32(lopid, hipid));
+	}
+
+#endif
+
+	// Classify any remaining packet headers individually
+	for(; index < count; index++) {
+
+		uint8_t const* packet = &buffer[index * 188];
+		pids[index] = (packet[0] == 0x47) ? static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]) : 0xFFFF;
+	}
+}
+
+//---------------------------------------------------------------------------
+// mpegts::is_video_stream
+//
+// Determines if an elementary stream type describes a video stream
+//
+// Arguments:
+//
+//	streamtype	- Elementary stream type from the Program Map Table
+
+bool is_video_stream(uint8_t streamtype)
+{
+	// There are a number of VIDEO stream descriptors recognized by ffmpeg; this
+	// list may not be exhaustive and should be kept up to date with ffmpeg source 
+	// file libavformat/mpegts.c (search for "AVMEDIA_TYPE_VIDEO")
+	switch(streamtype) {
+
+		case 0x01:			// AV_CODEC_ID_MPEG2VIDEO
+		case 0x02:			// AV_CODEC_ID_MPEG2VIDEO
+		case 0x10:			// AV_CODEC_ID_MPEG4
+		case 0x1B:			// AV_CODEC_ID_H264
+		case 0x20:			// AV_CODEC_ID_H264
+		case 0x21:			// AV_CODEC_ID_JPEG2000
+		case 0x24:			// AV_CODEC_ID_HEVC
+		case 0x42:			// AV_CODEC_ID_CAVS
+		case 0xD1:			// AV_CODEC_ID_DIRAC
+		case 0xD2:			// AV_CODEC_ID_AVS2
+		case 0xEA:			// AV_CODEC_ID_VC1
+			return true;
+	}
+
+	return false;
+}
+
+}	// namespace mpegts
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
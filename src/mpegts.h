@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __MPEGTS_H_
+#define __MPEGTS_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <functional>
+#include <string>
+
+//---------------------------------------------------------------------------
+// mpegts
+//
+// Shared MPEG-TS packet and Program Specific Information (PSI) utilities
+
+namespace mpegts {
+
+	// elementarystream
+	//
+	// Describes a single elementary stream listed in a Program Map Table
+	struct elementarystream {
+
+		uint16_t		pid;			// Elementary stream packet identifier
+		uint8_t			streamtype;		// Elementary stream type
+		char const*		codec;			// Codec name, or nullptr if not recognized
+		std::string		language;		// ISO 639 language code, if present
+	};
+
+	// PACKET_LENGTH
+	//
+	// Length of a single mpeg-ts data packet
+	size_t const PACKET_LENGTH = 188;
+
+	// null_packet
+	//
+	// MPEG-TS null data packet
+	extern uint8_t const null_packet[PACKET_LENGTH];
+
+	// crc32
+	//
+	// Calculates a CRC32/MPEG2 value for the specified byte range
+	uint32_t crc32(uint8_t const* data, size_t length);
+
+	// describe_stream
+	//
+	// Describes an elementary stream from a Program Map Table stream entry
+	struct elementarystream describe_stream(uint8_t const* entry);
+
+	// enumerate_pat
+	//
+	// Enumerates the programs listed in a Program Association Table packet
+	void enumerate_pat(uint8_t const* packet, std::function<void(uint16_t program, uint16_t pmtpid)> const& callback);
+
+	// enumerate_pmt
+	//
+	// Enumerates the stream entries listed in a Program Map Table packet; the callback
+	// returns true if it modified the entry, in which case the table CRC is rewritten
+	void enumerate_pmt(uint8_t* packet, std::function<bool(uint8_t* entry)> const& callback);
+
+	// extract_pids
+	//
+	// Validates the sync bytes and extracts the program ids from a batch of packets
+	void extract_pids(uint8_t const* buffer, size_t count, uint16_t* pids);
+
+	// is_video_stream
+	//
+	// Determines if an elementary stream type describes a video stream
+	bool is_video_stream(uint8_t streamtype);
+
+	// read_be8
+	//
+	// Reads a big-endian 8 bit value from memory
+	inline uint8_t read_be8(uint8_t const* ptr)
+	{
+		return *ptr;
+	}
+
+	// read_be16
+	//
+	// Reads a big-endian 16 bit value from memory
+	inline uint16_t read_be16(uint8_t const* ptr)
+	{
+		return ntohs(*reinterpret_cast<uint16_t const*>(ptr));
+	}
+
+	// read_be32
+	//
+	// Reads a big-endian 32 bit value from memory
+	inline uint32_t read_be32(uint8_t const* ptr)
+	{
+		return ntohl(*reinterpret_cast<uint32_t const*>(ptr));
+	}
+
+	// write_be32
+	//
+	// Writes a big-endian 32 bit value into memory
+	inline void write_be32(uint32_t val, uint8_t* ptr)
+	{
+		*reinterpret_cast<uint32_t*>(ptr) = htonl(val);
+	}
+
+}	// namespace mpegts
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __MPEGTS_H_
@@ -0,0 +1,493 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "pcrclock.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma warning(push, 4)
+
+// pcrclock::MAXIMUM_SAMPLES (static)
+//
+// Maximum number of PCR samples to retain
+size_t const pcrclock::MAXIMUM_SAMPLES = 16384;
+
+// pcrclock::MINIMUM_EXTRAPOLATION_SPAN (static)
+//
+// Minimum span of the PCR samples required to extrapolate times, in PCR clock ticks
+long long const pcrclock::MINIMUM_EXTRAPOLATION_SPAN = (90000 * 10);
+
+// pcrclock::MPEGTS_PACKET_LENGTH (static)
+//
+// Length of a single mpeg-ts data packet
+size_t const pcrclock::MPEGTS_PACKET_LENGTH = 188;
+
+// pcrclock::PCR_CLOCK_RATE (static)
+//
+// Frequency of the 33-bit PCR base clock
+long long const pcrclock::PCR_CLOCK_RATE = 90000;
+
+// pcrclock::SAMPLE_INTERVAL (static)
+//
+// Minimum interval between PCR samples, in PCR clock ticks
+long long const pcrclock::SAMPLE_INTERVAL = 90000;
+
+//---------------------------------------------------------------------------
+// pcrclock Constructor (private)
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+
+pcrclock::pcrclock(std::unique_ptr<pvrstream> basestream) : m_basestream(std::move(basestream))
+{
+	assert(m_basestream);
+
+	// Start tracking from the current position of the base stream, if it's known
+	long long position = m_basestream->position();
+	m_position = (position > 0) ? position : 0;
+
+	// A base stream that can't be seeked may have been read from before it was handed over (pretuned),
+	// anything layered above the clock to make it seekable starts from zero at the current position
+	if(!m_basestream->canseek()) m_origin = m_position;
+}
+
+//---------------------------------------------------------------------------
+// pcrclock Destructor
+
+pcrclock::~pcrclock()
+{
+	close();
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* pcrclock::acquire(size_t count, size_t* available)
+{
+	assert(m_basestream);
+
+	// Hang on to the acquired data so it can be scanned for PCR values once released
+	m_acquired = m_basestream->acquire(count, available);
+	return const_cast<uint8_t*>(m_acquired);
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::add_sample (private)
+//
+// Adds a PCR sample to the position/time map
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+//	position	- Stream position of the packet carrying the PCR
+//	time		- Unwrapped PCR clock time
+
+void pcrclock::add_sample(std::unique_lock<std::mutex> const& lock, long long position, long long time)
+{
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	// The PCR times must increase along with the stream positions; if the new sample doesn't
+	// fit between its neighbors there was a discontinuity and the existing samples are useless
+	auto lower = m_samples.lower_bound(position);
+	auto upper = m_samples.upper_bound(position);
+
+	if(((upper != m_samples.end()) && (upper->second <= time)) || ((lower != m_samples.begin()) && (std::prev(lower)->second >= time))) {
+
+		m_samples.clear();
+		m_discontinuities++;
+	}
+
+	m_samples[position] = time;
+	m_lastsample = time;
+	m_resample = false;
+
+	// Limit the number of samples that are retained by discarding the lowest positions
+	if(m_samples.size() > MAXIMUM_SAMPLES) m_samples.erase(m_samples.begin());
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::canseek
+//
+// Gets a flag indicating if the stream allows seek operations
+//
+// Arguments:
+//
+//	NONE
+
+bool pcrclock::canseek(void) const
+{
+	assert(m_basestream);
+	return m_basestream->canseek();
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::close
+//
+// Closes the stream
+//
+// Arguments:
+//
+//	NONE
+
+void pcrclock::close(void)
+{
+	assert(m_basestream);
+	m_basestream->close();
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::create (static)
+//
+// Factory method, creates a new pcrclock instance
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+
+std::unique_ptr<pcrclock> pcrclock::create(std::unique_ptr<pvrstream> basestream)
+{
+	return std::unique_ptr<pcrclock>(new pcrclock(std::move(basestream)));
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::length
+//
+// Gets the length of the stream; or -1 if stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+long long pcrclock::length(void) const
+{
+	assert(m_basestream);
+	return m_basestream->length();
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::mediatype
+//
+// Gets the media type of the stream
+//
+// Arguments:
+//
+//	NONE
+
+char const* pcrclock::mediatype(void) const
+{
+	assert(m_basestream);
+	return m_basestream->mediatype();
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long pcrclock::minposition(void) const
+{
+	assert(m_basestream);
+	return m_basestream->minposition();
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::observe (private)
+//
+// Scans packets released from the stream for PCR values
+//
+// Arguments:
+//
+//	buffer		- Pointer to the released mpeg-ts packets
+//	count		- Number of bytes released
+
+void pcrclock::observe(uint8_t const* buffer, size_t count)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	for(size_t offset = 0; (count - offset) >= MPEGTS_PACKET_LENGTH; offset += MPEGTS_PACKET_LENGTH) {
+
+		uint8_t const* packet = &buffer[offset];
+
+		// The packet must be synchronized, error free and have an adaptation field with the PCR flag set
+		if((packet[0] != 0x47) || ((packet[1] & 0x80) == 0x80)) continue;
+		if(((packet[3] & 0x20) == 0) || (packet[4] < 7) || ((packet[5] & 0x10) == 0)) continue;
+
+		// Only track the PCR values of the first program id observed to carry them
+		int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+		if((m_pcrpid >= 0) && (pid != m_pcrpid)) continue;
+
+		// The PCR base is a 33-bit value at 90KHz; the 9-bit 27MHz extension is ignored
+		uint64_t pcr = (static_cast<uint64_t>(packet[6]) << 25) | (static_cast<uint64_t>(packet[7]) << 17) |
+			(static_cast<uint64_t>(packet[8]) << 9) | (static_cast<uint64_t>(packet[9]) << 1) | (packet[10] >> 7);
+
+		if(m_pcrpid < 0) { m_pcrpid = pid; m_lastpcr = pcr; m_lasttime = static_cast<long long>(pcr); }
+
+		// Unwrap the PCR relative to the previous value so that it can be treated as a continuous clock,
+		// this works as long as the stream doesn't move more than half of the 33-bit range at a time
+		long long delta = static_cast<long long>((pcr - m_lastpcr) & 0x1FFFFFFFFULL);
+		if(delta >= 0x100000000LL) delta -= 0x200000000LL;
+
+		m_lastpcr = pcr;
+		m_lasttime += delta;
+
+		// Sample the PCR periodically, and immediately after the stream has been seeked
+		if((m_resample) || (llabs(m_lasttime - m_lastsample) >= SAMPLE_INTERVAL)) 
+			add_sample(lock, (m_position - m_origin) + static_cast<long long>(offset), m_lasttime);
+	}
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long pcrclock::position(void) const
+{
+	return m_position;
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::positionof
+//
+// Converts a time, in microseconds, into a stream position
+//
+// Arguments:
+//
+//	time		- Time to be converted, relative to the start of the stream
+
+long long pcrclock::positionof(long long time) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// At least two samples are required to establish the clock rate
+	if(m_samples.size() < 2) return -1;
+
+	// The time is relative to the estimated PCR clock time at the start of the stream
+	double ticks = ticksof(lock, 0) + ((static_cast<double>(time) * PCR_CLOCK_RATE) / 1000000.0);
+
+	// Times outside of the sampled range are extrapolated from the overall clock rate, subject to
+	// the same minimum span requirement that applies when converting positions into times
+	auto lower = m_samples.cbegin();
+	auto upper = std::prev(m_samples.cend());
+	if(((ticks < lower->second) || (ticks > upper->second)) && ((upper->second - lower->second) < MINIMUM_EXTRAPOLATION_SPAN)) return -1;
+
+	// The PCR times increase along with the stream positions, so the samples that bracket the
+	// time can be located by searching the map values rather than the keys
+	if((ticks > lower->second) && (ticks < upper->second)) {
+
+		upper = std::upper_bound(m_samples.cbegin(), m_samples.cend(), ticks,
+			[](double const& lhs, samplemap_t::value_type const& rhs) -> bool { return lhs < rhs.second; });
+		lower = std::prev(upper);
+	}
+
+	double position = lower->first + (((ticks - lower->second) * (upper->first - lower->first)) / (upper->second - lower->second));
+	return (position > 0.0) ? static_cast<long long>(position) : 0;
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::read
+//
+// Reads available data from the stream
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t pcrclock::read(uint8_t* buffer, size_t count)
+{
+	size_t			available = 0;			// Available bytes to read
+
+	assert(buffer != nullptr);
+
+	uint8_t* data = acquire(count, &available);
+	if(available > 0) memcpy(buffer, data, available);
+
+	release(available);
+	return available;
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool pcrclock::realtime(void) const
+{
+	assert(m_basestream);
+	return m_basestream->realtime();
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
+
+void pcrclock::release(size_t count)
+{
+	assert(m_basestream);
+
+	// Scan the released data for PCR values before it's given back to the base stream
+	if((m_acquired != nullptr) && (count > 0)) observe(m_acquired, count);
+
+	m_position += static_cast<long long>(count);
+	m_acquired = nullptr;
+
+	m_basestream->release(count);
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::seek
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long pcrclock::seek(long long position, int whence)
+{
+	assert(m_basestream);
+
+	long long result = m_basestream->seek(position, whence);
+	if(result >= 0) m_position = result;
+
+	// Take a PCR sample as soon as one is available at the new position
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_resample = true;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void pcrclock::telemetry(telemetry_t& values) const
+{
+	assert(m_basestream);
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	values.emplace_back("pcrclock.samples", static_cast<long long>(m_samples.size()));
+	values.emplace_back("pcrclock.discontinuities", static_cast<long long>(m_discontinuities));
+
+	lock.unlock();
+
+	m_basestream->telemetry(values);
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::ticksof (private)
+//
+// Estimates the PCR clock time of a stream position
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+//	position	- Stream position to be converted
+
+double pcrclock::ticksof(std::unique_lock<std::mutex> const& lock, long long position) const
+{
+	assert(m_samples.size() >= 2);
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	auto lower = m_samples.begin();
+	auto upper = std::prev(m_samples.end());
+
+	// Interpolate between the samples that bracket the position; positions outside of the
+	// sampled range are extrapolated using the overall rate between the first and last samples
+	if((position > lower->first) && (position < upper->first)) {
+
+		upper = m_samples.upper_bound(position);
+		lower = std::prev(upper);
+	}
+
+	return lower->second + ((static_cast<double>(position - lower->first) * (upper->second - lower->second)) / (upper->first - lower->first));
+}
+
+//---------------------------------------------------------------------------
+// pcrclock::timeof
+//
+// Converts a stream position into a time, in microseconds
+//
+// Arguments:
+//
+//	position	- Stream position to be converted
+
+long long pcrclock::timeof(long long position) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// At least two samples are required to establish the clock rate
+	if(m_samples.size() < 2) return -1;
+
+	// Positions outside of the sampled range are extrapolated from the overall clock rate, which
+	// isn't reliable for variable bitrate streams until the samples span a reasonable amount of time
+	auto first = m_samples.cbegin();
+	auto last = std::prev(m_samples.cend());
+	if(((position < first->first) || (position > last->first)) && ((last->second - first->second) < MINIMUM_EXTRAPOLATION_SPAN)) return -1;
+
+	// The time is relative to the estimated PCR clock time at the start of the stream
+	double ticks = ticksof(lock, position) - ticksof(lock, 0);
+	return (ticks > 0.0) ? static_cast<long long>((ticks * 1000000.0) / PCR_CLOCK_RATE) : 0;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
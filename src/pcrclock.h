@@ -0,0 +1,210 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __PCRCLOCK_H_
+#define __PCRCLOCK_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class pcrclock
+//
+// Implements a pvrstream wrapper that tracks the MPEG-TS program clock reference
+// (PCR) values of the packets flowing through it to map stream positions to times.
+// The positions used by positionof() and timeof() are those of the base stream if it
+// can be seeked, otherwise they are relative to where the clock started tracking it
+
+class pcrclock : public pvrstream
+{
+public:
+
+	// Destructor
+	//
+	virtual ~pcrclock();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
+	// canseek
+	//
+	// Flag indicating if the stream allows seek operations
+	bool canseek(void) const;
+
+	// close
+	//
+	// Closes the stream
+	void close(void);
+
+	// create (static)
+	//
+	// Factory method, creates a new pcrclock instance
+	static std::unique_ptr<pcrclock> create(std::unique_ptr<pvrstream> basestream);
+
+	// length
+	//
+	// Gets the length of the stream
+	long long length(void) const;
+
+	// mediatype
+	//
+	// Gets the media type of the stream
+	char const* mediatype(void) const;
+
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
+	// position
+	//
+	// Gets the current position of the stream
+	long long position(void) const;
+
+	// positionof
+	//
+	// Converts a time, in microseconds, into a stream position
+	long long positionof(long long time) const;
+
+	// read
+	//
+	// Reads available data from the stream
+	size_t read(uint8_t* buffer, size_t count);
+
+	// realtime
+	//
+	// Gets a flag indicating if the stream is real-time
+	bool realtime(void) const;
+
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
+	// seek
+	//
+	// Sets the stream pointer to a specific position
+	long long seek(long long position, int whence);
+
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
+	// timeof
+	//
+	// Converts a stream position into a time, in microseconds
+	long long timeof(long long position) const;
+
+private:
+
+	pcrclock(pcrclock const&) = delete;
+	pcrclock& operator=(pcrclock const&) = delete;
+
+	// MINIMUM_EXTRAPOLATION_SPAN
+	//
+	// Minimum span of the PCR samples required to extrapolate times
+	static long long const MINIMUM_EXTRAPOLATION_SPAN;
+
+	// MPEGTS_PACKET_LENGTH
+	//
+	// Length of a single mpeg-ts data packet
+	static size_t const MPEGTS_PACKET_LENGTH;
+
+	// MAXIMUM_SAMPLES
+	//
+	// Maximum number of PCR samples to retain
+	static size_t const MAXIMUM_SAMPLES;
+
+	// PCR_CLOCK_RATE
+	//
+	// Frequency of the 33-bit PCR base clock
+	static long long const PCR_CLOCK_RATE;
+
+	// SAMPLE_INTERVAL
+	//
+	// Minimum interval between PCR samples, in PCR clock ticks
+	static long long const SAMPLE_INTERVAL;
+
+	// Instance Constructor
+	//
+	pcrclock(std::unique_ptr<pvrstream> basestream);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// add_sample
+	//
+	// Adds a PCR sample to the position/time map
+	void add_sample(std::unique_lock<std::mutex> const& lock, long long position, long long time);
+
+	// observe
+	//
+	// Scans packets released from the stream for PCR values
+	void observe(uint8_t const* buffer, size_t count);
+
+	// ticksof
+	//
+	// Estimates the PCR clock time of a stream position
+	double ticksof(std::unique_lock<std::mutex> const& lock, long long position) const;
+
+	//-----------------------------------------------------------------------
+	// Member Types
+
+	// samplemap_t
+	//
+	// Map of stream positions to unwrapped PCR clock times
+	using samplemap_t = std::map<long long, long long>;
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	std::unique_ptr<pvrstream> const	m_basestream;			// Underlying stream instance
+	mutable std::mutex					m_lock;					// Synchronization object
+	samplemap_t							m_samples;				// Position/time samples
+	uint8_t const*						m_acquired = nullptr;	// Currently acquired data
+	long long							m_position = 0;			// Current stream position
+	long long							m_origin = 0;			// Origin of the sample positions
+	int									m_pcrpid = -1;			// Program id carrying the PCR
+	uint64_t							m_lastpcr = 0;			// Last observed PCR value
+	long long							m_lasttime = 0;			// Last unwrapped PCR time
+	long long							m_lastsample = 0;		// Time of the last sample
+	bool								m_resample = true;		// Flag to sample next PCR
+	size_t								m_discontinuities = 0;	// Number of PCR discontinuities
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __PCRCLOCK_H_
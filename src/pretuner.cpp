@@ -0,0 +1,171 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "pretuner.h"
+
+#pragma warning(push, 4)
+
+// pretuner::DISCARD_CHUNK_SIZE (static)
+//
+// Maximum amount of stream data to discard at once
+size_t const pretuner::DISCARD_CHUNK_SIZE = (188 * 64);
+
+//---------------------------------------------------------------------------
+// pretuner Constructor (private)
+//
+// Arguments:
+//
+//	channelid	- Channel identifier of the stream
+//	opener		- Function used to open the live stream
+
+pretuner::pretuner(union channelid channelid, opener_t opener) : m_channelid(channelid)
+{
+	assert(opener);
+
+	m_worker = std::thread([=]() -> void {
+
+		std::unique_ptr<pvrstream> stream;			// Stream instance
+		size_t available = 0;						// Data available to discard
+
+		// Opening the stream can take a while and any failures are simply ignored; if
+		// the stream can't be opened there is just nothing available to be claimed
+		try { stream = opener(); }
+		catch(...) { stream.reset(); }
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_opening = false;
+		lock.unlock();
+
+		if(!stream) return;
+
+		try {
+
+			// Keep the stream flowing by acquiring and releasing the data without copying it until
+			// the stream has been claimed; this keeps the tuner warm and the buffered data current
+			while(!m_stop.load()) {
+
+				stream->acquire(DISCARD_CHUNK_SIZE, &available);
+				if(available > 0) stream->release(available);
+				else std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+
+		catch(...) { return; }
+
+		lock.lock();
+		m_stream = std::move(stream);
+	});
+}
+
+//---------------------------------------------------------------------------
+// pretuner Destructor
+
+pretuner::~pretuner()
+{
+	stop();
+}
+
+//---------------------------------------------------------------------------
+// pretuner::channel
+//
+// Gets the channel identifier of the pretuned stream
+//
+// Arguments:
+//
+//	NONE
+
+union channelid pretuner::channel(void) const
+{
+	return m_channelid;
+}
+
+//---------------------------------------------------------------------------
+// pretuner::claim
+//
+// Stops discarding the stream data and takes ownership of the stream
+//
+// Arguments:
+//
+//	NONE
+
+std::unique_ptr<pvrstream> pretuner::claim(void)
+{
+	// A stream that is still being opened can't be claimed; stopping the background thread would
+	// have to wait for the open operation to complete, which can take quite a while to fail
+	if(opening()) return nullptr;
+
+	stop();
+
+	// If the stream could not be opened or failed while running, there is nothing to claim
+	std::unique_lock<std::mutex> lock(m_lock);
+	return std::move(m_stream);
+}
+
+//---------------------------------------------------------------------------
+// pretuner::create (static)
+//
+// Factory method, creates a new pretuner instance
+//
+// Arguments:
+//
+//	channelid	- Channel identifier of the stream
+//	opener		- Function used to open the live stream
+
+std::unique_ptr<pretuner> pretuner::create(union channelid channelid, opener_t opener)
+{
+	return std::unique_ptr<pretuner>(new pretuner(channelid, std::move(opener)));
+}
+
+//---------------------------------------------------------------------------
+// pretuner::opening
+//
+// Gets a flag indicating if the stream is still being opened
+//
+// Arguments:
+//
+//	NONE
+
+bool pretuner::opening(void) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	return m_opening;
+}
+
+//---------------------------------------------------------------------------
+// pretuner::stop (private)
+//
+// Stops the background thread
+//
+// Arguments:
+//
+//	NONE
+
+void pretuner::stop(void)
+{
+	m_stop.store(true);
+	if(m_worker.joinable()) m_worker.join();
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
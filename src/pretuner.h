@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __PRETUNER_H_
+#define __PRETUNER_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "dbtypes.h"
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class pretuner
+//
+// Opens a live stream for a channel in the background and keeps it flowing by
+// discarding the data until the stream is either claimed or abandoned
+
+class pretuner
+{
+public:
+
+	// opener_t
+	//
+	// Function used to open the live stream on the background thread
+	using opener_t = std::function<std::unique_ptr<pvrstream>(void)>;
+
+	// Destructor
+	//
+	~pretuner();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// channel
+	//
+	// Gets the channel identifier of the pretuned stream
+	union channelid channel(void) const;
+
+	// claim
+	//
+	// Stops discarding the stream data and takes ownership of the stream
+	std::unique_ptr<pvrstream> claim(void);
+
+	// opening
+	//
+	// Gets a flag indicating if the stream is still being opened
+	bool opening(void) const;
+
+	// create (static)
+	//
+	// Factory method, creates a new pretuner instance
+	static std::unique_ptr<pretuner> create(union channelid channelid, opener_t opener);
+
+private:
+
+	pretuner(pretuner const&) = delete;
+	pretuner& operator=(pretuner const&) = delete;
+
+	// DISCARD_CHUNK_SIZE
+	//
+	// Maximum amount of stream data to discard at once
+	static size_t const DISCARD_CHUNK_SIZE;
+
+	// Instance Constructor
+	//
+	pretuner(union channelid channelid, opener_t opener);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// stop
+	//
+	// Stops the background thread
+	void stop(void);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	union channelid const				m_channelid;			// Pretuned channel identifier
+	std::thread							m_worker;				// Background worker thread
+	std::atomic<bool>					m_stop{ false };		// Flag to stop the worker thread
+	mutable std::mutex					m_lock;					// Synchronization object
+	bool								m_opening = true;		// Flag if the stream is being opened
+	std::unique_ptr<pvrstream>			m_stream;				// Pretuned stream instance
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __PRETUNER_H_
@@ -0,0 +1,403 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "psiprobe.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#pragma warning(push, 4)
+
+// psiprobe::PROBE_INTERVAL (static)
+//
+// Interval between attempts to peek at the stream data, in milliseconds
+unsigned int const psiprobe::PROBE_INTERVAL = 10;
+
+// psiprobe::PROBE_LENGTH (static)
+//
+// Maximum amount of stream data to peek at when probing
+size_t const psiprobe::PROBE_LENGTH = (mpegts::PACKET_LENGTH * 1024);
+
+// psiprobe::PROBE_TIMEOUT (static)
+//
+// Maximum amount of time to spend probing the stream, in milliseconds
+unsigned int const psiprobe::PROBE_TIMEOUT = 1000;
+
+//---------------------------------------------------------------------------
+// psiprobe Constructor (private)
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+
+psiprobe::psiprobe(std::unique_ptr<pvrstream> basestream) : m_basestream(std::move(basestream))
+{
+	assert(m_basestream);
+}
+
+//---------------------------------------------------------------------------
+// psiprobe Destructor
+
+psiprobe::~psiprobe()
+{
+	close();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* psiprobe::acquire(size_t count, size_t* available)
+{
+	assert(m_basestream);
+
+	// Scan the acquired data as soon as it's available so the layout can be known before
+	// any of the data is consumed; data acquired more than once will just be scanned again
+	uint8_t* buffer = m_basestream->acquire(count, available);
+
+	if((buffer != nullptr) && (*available > 0)) observe(buffer, *available);
+	return buffer;
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::canseek
+//
+// Gets a flag indicating if the stream allows seek operations
+//
+// Arguments:
+//
+//	NONE
+
+bool psiprobe::canseek(void) const
+{
+	assert(m_basestream);
+	return m_basestream->canseek();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::close
+//
+// Closes the stream
+//
+// Arguments:
+//
+//	NONE
+
+void psiprobe::close(void)
+{
+	assert(m_basestream);
+	m_basestream->close();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::create (static)
+//
+// Factory method, creates a new psiprobe instance
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+
+std::unique_ptr<psiprobe> psiprobe::create(std::unique_ptr<pvrstream> basestream)
+{
+	return std::unique_ptr<psiprobe>(new psiprobe(std::move(basestream)));
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::layout
+//
+// Gets the elementary streams described by the program map table
+//
+// Arguments:
+//
+//	streams		- Receives the elementary stream layout
+
+bool psiprobe::layout(std::vector<mpegts::elementarystream>& streams) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	if(m_complete) streams = m_streams;
+	return m_complete;
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::length
+//
+// Gets the length of the stream; or -1 if stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+long long psiprobe::length(void) const
+{
+	assert(m_basestream);
+	return m_basestream->length();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::mediatype
+//
+// Gets the media type of the stream
+//
+// Arguments:
+//
+//	NONE
+
+char const* psiprobe::mediatype(void) const
+{
+	assert(m_basestream);
+	return m_basestream->mediatype();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long psiprobe::minposition(void) const
+{
+	assert(m_basestream);
+	return m_basestream->minposition();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::observe (private)
+//
+// Scans packets for the program specific information tables
+//
+// Arguments:
+//
+//	buffer		- Pointer to the mpeg-ts packets to scan
+//	count		- Number of bytes provided in the buffer
+
+void psiprobe::observe(uint8_t* buffer, size_t count)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	size_t offset = 0;
+	while((count - offset) >= mpegts::PACKET_LENGTH) {
+
+		uint8_t* packet = &buffer[offset];
+
+		// The data isn't necessarily aligned at this layer; walk forward a byte at a time until the
+		// sync byte is located, there is no need to be any smarter about it than that
+		if(packet[0] != 0x47) { offset++; continue; }
+		offset += mpegts::PACKET_LENGTH;
+
+		uint16_t pid = mpegts::read_be16(packet + 1U) & 0x1FFF;
+
+		// Program Association Table (PAT)
+		//
+		if(pid == 0x0000) {
+
+			// Only the first program listed in the PAT is described, program zero is the network PID
+			int pmtpid = -1;
+			mpegts::enumerate_pat(packet, [&](uint16_t program, uint16_t programpid) -> void {
+
+				if((program != 0) && (pmtpid < 0)) pmtpid = programpid;
+			});
+
+			// If the program map table has moved, the existing layout is no longer valid
+			if((pmtpid >= 0) && (pmtpid != m_pmtpid)) { m_pmtpid = pmtpid; m_complete = false; }
+		}
+
+		// Program Map Table (PMT)
+		//
+		else if(static_cast<int>(pid) == m_pmtpid) {
+
+			std::vector<mpegts::elementarystream> streams;
+			mpegts::enumerate_pmt(packet, [&](uint8_t* entry) -> bool {
+
+				streams.emplace_back(mpegts::describe_stream(entry));
+				return false;
+			});
+
+			// The PMT is repeated continuously; only replace the layout if it has changed
+			if(streams.empty()) continue;
+
+			bool changed = (!m_complete) || (streams.size() != m_streams.size()) ||
+				(!std::equal(streams.begin(), streams.end(), m_streams.begin(), [](mpegts::elementarystream const& lhs, mpegts::elementarystream const& rhs) -> bool {
+
+				return (lhs.pid == rhs.pid) && (lhs.streamtype == rhs.streamtype) && (lhs.language == rhs.language);
+			}));
+
+			if(changed) {
+
+				if(m_complete) m_updates++;
+
+				m_streams = std::move(streams);
+				m_complete = true;
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long psiprobe::position(void) const
+{
+	assert(m_basestream);
+	return m_basestream->position();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::probe
+//
+// Peeks at the head of a stream chain until the stream layout is known
+//
+// Arguments:
+//
+//	stream		- Head of the stream chain that this instance is a part of
+//	streams		- Receives the elementary stream layout
+
+bool psiprobe::probe(pvrstream& stream, std::vector<mpegts::elementarystream>& streams)
+{
+	size_t				available = 0;			// Available bytes to peek at
+
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PROBE_TIMEOUT);
+
+	// The data is acquired from the head of the chain and never released, so nothing is consumed
+	// from the stream and the upper layers are left intact; acquiring again will return the same
+	// data plus anything that has arrived in the meantime
+	while(!layout(streams)) {
+
+		if(std::chrono::steady_clock::now() >= deadline) return false;
+
+		stream.acquire(PROBE_LENGTH, &available);
+		if(!layout(streams)) std::this_thread::sleep_for(std::chrono::milliseconds(PROBE_INTERVAL));
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::read
+//
+// Reads available data from the stream
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t psiprobe::read(uint8_t* buffer, size_t count)
+{
+	assert(m_basestream);
+
+	size_t read = m_basestream->read(buffer, count);
+
+	if(read > 0) observe(buffer, read);
+	return read;
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool psiprobe::realtime(void) const
+{
+	assert(m_basestream);
+	return m_basestream->realtime();
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
+
+void psiprobe::release(size_t count)
+{
+	assert(m_basestream);
+	m_basestream->release(count);
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::seek
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long psiprobe::seek(long long position, int whence)
+{
+	assert(m_basestream);
+	return m_basestream->seek(position, whence);
+}
+
+//---------------------------------------------------------------------------
+// psiprobe::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void psiprobe::telemetry(telemetry_t& values) const
+{
+	assert(m_basestream);
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	values.emplace_back("psiprobe.streams", static_cast<long long>(m_streams.size()));
+	values.emplace_back("psiprobe.layout_changes", static_cast<long long>(m_updates));
+
+	lock.unlock();
+
+	m_basestream->telemetry(values);
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
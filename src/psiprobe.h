@@ -0,0 +1,175 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __PSIPROBE_H_
+#define __PSIPROBE_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "mpegts.h"
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class psiprobe
+//
+// Implements a pvrstream wrapper that parses the MPEG-TS program specific information
+// (PAT/PMT) of the packets flowing through it to describe the stream layout
+
+class psiprobe : public pvrstream
+{
+public:
+
+	// Destructor
+	//
+	virtual ~psiprobe();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
+	// canseek
+	//
+	// Flag indicating if the stream allows seek operations
+	bool canseek(void) const;
+
+	// close
+	//
+	// Closes the stream
+	void close(void);
+
+	// create (static)
+	//
+	// Factory method, creates a new psiprobe instance
+	static std::unique_ptr<psiprobe> create(std::unique_ptr<pvrstream> basestream);
+
+	// layout
+	//
+	// Gets the elementary streams described by the program map table
+	bool layout(std::vector<mpegts::elementarystream>& streams) const;
+
+	// length
+	//
+	// Gets the length of the stream
+	long long length(void) const;
+
+	// mediatype
+	//
+	// Gets the media type of the stream
+	char const* mediatype(void) const;
+
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
+	// position
+	//
+	// Gets the current position of the stream
+	long long position(void) const;
+
+	// probe
+	//
+	// Peeks at the head of a stream chain until the stream layout is known
+	bool probe(pvrstream& stream, std::vector<mpegts::elementarystream>& streams);
+
+	// read
+	//
+	// Reads available data from the stream
+	size_t read(uint8_t* buffer, size_t count);
+
+	// realtime
+	//
+	// Gets a flag indicating if the stream is real-time
+	bool realtime(void) const;
+
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
+	// seek
+	//
+	// Sets the stream pointer to a specific position
+	long long seek(long long position, int whence);
+
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
+private:
+
+	psiprobe(psiprobe const&) = delete;
+	psiprobe& operator=(psiprobe const&) = delete;
+
+	// PROBE_INTERVAL
+	//
+	// Interval between attempts to peek at the stream data, in milliseconds
+	static unsigned int const PROBE_INTERVAL;
+
+	// PROBE_LENGTH
+	//
+	// Maximum amount of stream data to peek at when probing
+	static size_t const PROBE_LENGTH;
+
+	// PROBE_TIMEOUT
+	//
+	// Maximum amount of time to spend probing the stream, in milliseconds
+	static unsigned int const PROBE_TIMEOUT;
+
+	// Instance Constructor
+	//
+	psiprobe(std::unique_ptr<pvrstream> basestream);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// observe
+	//
+	// Scans packets for the program specific information tables
+	void observe(uint8_t* buffer, size_t count);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	std::unique_ptr<pvrstream> const		m_basestream;			// Underlying stream instance
+	mutable std::mutex						m_lock;					// Synchronization object
+	int										m_pmtpid = -1;			// Program map table packet id
+	bool									m_complete = false;		// Flag if layout is known
+	std::vector<mpegts::elementarystream>	m_streams;				// Elementary stream layout
+	size_t									m_updates = 0;			// Number of layout changes
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __PSIPROBE_H_
@@ -26,6 +26,10 @@
 
 #pragma warning(push, 4)
 
+#include <string>
+#include <utility>
+#include <vector>
+
 //---------------------------------------------------------------------------
 // Class pvrstream
 //
@@ -35,6 +39,11 @@ class pvrstream
 {
 public:
 
+	// telemetry_t
+	//
+	// Collection of named stream telemetry values
+	using telemetry_t = std::vector<std::pair<std::string, long long>>;
+
 	// Constructor / Destructor
 	//
 	pvrstream() {}
@@ -43,6 +52,11 @@ public:
 	//-----------------------------------------------------------------------
 	// Member Functions
 
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	virtual uint8_t* acquire(size_t count, size_t* available) = 0;
+
 	// canseek
 	//
 	// Flag indicating if the stream allows seek operations
@@ -63,6 +77,11 @@ public:
 	// Gets the media type of the stream
 	virtual char const* mediatype(void) const = 0;
 
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	virtual long long minposition(void) const = 0;
+
 	// position
 	//
 	// Gets the current position of the stream
@@ -78,11 +97,21 @@ public:
 	// Gets a flag indicating if the stream is real-time
 	virtual bool realtime(void) const = 0;
 
+	// release
+	//
+	// Releases data previously acquired from the stream
+	virtual void release(size_t count) = 0;
+
 	// seek
 	//
 	// Sets the stream pointer to a specific position
 	virtual long long seek(long long position, int whence) = 0;
 
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	virtual void telemetry(telemetry_t& values) const = 0;
+
 private:
 
 	pvrstream(pvrstream const&) = delete;
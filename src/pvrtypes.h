@@ -47,6 +47,7 @@ static int const MENUHOOK_SETTING_SHOWDEVICENAMES				= 12;
 static int const MENUHOOK_SETTING_TRIGGERLISTINGDISCOVERY		= 13;
 static int const MENUHOOK_SETTING_SHOWRECENTERRORS				= 14;
 static int const MENUHOOK_SETTING_GENERATEDISCOVERYDIAGNOSTICS	= 15;
+static int const MENUHOOK_SETTING_SHOWSTREAMTELEMETRY			= 16;
 
 //---------------------------------------------------------------------------
 // DATA TYPES
@@ -224,11 +225,66 @@ struct settings {
 	// Indicates that requests to stream DRM channels should be allowed
 	bool direct_tuning_allow_drm;
 
+	// pretune_next_channel
+	//
+	// Flag to keep a spare tuner tuned to the predicted next live channel
+	bool pretune_next_channel;
+
+	// race_live_stream_sources
+	//
+	// Flag to open the candidate live stream sources concurrently
+	bool race_live_stream_sources;
+
 	// stream_read_chunk_size
 	//
 	// Indicates the minimum number of bytes to return from a stream read
 	int stream_read_chunk_size;
 
+	// stream_prefetch
+	//
+	// Flag to transfer HTTP stream data on a background thread
+	bool stream_prefetch;
+
+	// stream_batch_receive
+	//
+	// Flag to receive tuner device RTP/UDP datagrams in batches
+	bool stream_batch_receive;
+
+	// stream_buffer_min_size
+	//
+	// Indicates the minimum size of an HTTP stream ring buffer
+	int stream_buffer_min_size;
+
+	// stream_buffer_max_size
+	//
+	// Indicates the maximum size of an HTTP stream ring buffer
+	int stream_buffer_max_size;
+
+	// stream_seek_cache_size
+	//
+	// Indicates the amount of memory to use for the recorded stream seek cache
+	int stream_seek_cache_size;
+
+	// stream_seek_cache_file_size
+	//
+	// Indicates the size of the recorded stream seek cache spill file, or zero if disabled
+	int stream_seek_cache_file_size;
+
+	// stream_range_connections
+	//
+	// Indicates the maximum number of connections to use for Recorded TV streams
+	int stream_range_connections;
+
+	// stream_demuxing
+	//
+	// Flag to demultiplex the streams in the addon rather than in Kodi
+	bool stream_demuxing;
+
+	// timeshift_buffer_size
+	//
+	// Indicates the size of the live stream timeshift buffer file, or zero if disabled
+	int timeshift_buffer_size;
+
 	// deviceauth_stale_after
 	//
 	// Amount of time (seconds) after which an expired device authorization code is removed
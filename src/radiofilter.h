@@ -27,7 +27,7 @@
 #pragma warning(push, 4)
 
 #include <memory>
-#include <set>
+#include <bitset>
 
 #include "pvrstream.h"
 
@@ -48,6 +48,11 @@ public:
 	//-----------------------------------------------------------------------
 	// Member Functions
 
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
 	// canseek
 	//
 	// Flag indicating if the stream allows seek operations
@@ -73,6 +78,11 @@ public:
 	// Gets the media type of the stream
 	char const* mediatype(void) const;
 
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
 	// position
 	//
 	// Gets the current position of the stream
@@ -88,11 +98,21 @@ public:
 	// Gets a flag indicating if the stream is real-time
 	bool realtime(void) const;
 
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
 	// seek
 	//
 	// Sets the stream pointer to a specific position
 	long long seek(long long position, int whence);
 
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
 private:
 
 	radiofilter(radiofilter const&) = delete;
@@ -107,6 +127,16 @@ private:
 	// Length of a single mpeg-ts data packet
 	static size_t const MPEGTS_PACKET_LENGTH;
 
+	// MPEGTS_PID_COUNT
+	//
+	// Number of distinct mpeg-ts packet identifiers
+	static size_t const MPEGTS_PID_COUNT = 8192;
+
+	// PACKET_BATCH_SIZE
+	//
+	// Number of mpeg-ts packets to classify in a single batch
+	static size_t const PACKET_BATCH_SIZE;
+
 	//-----------------------------------------------------------------------
 	// Private Member Functions
 
@@ -119,9 +149,9 @@ private:
 	// Member Variables
 
 	std::unique_ptr<pvrstream> const	m_basestream;			// Underlying stream instance
-	bool								m_enablefilter = true;	// Flag if packet filter is enabled
-	std::set<uint16_t>					m_pmtpids;				// Set of PMT program ids
-	std::set<uint16_t>					m_videopids;			// Set of video stream program ids
+	std::bitset<MPEGTS_PID_COUNT>		m_pmtpids;				// Bitmap of PMT program ids
+	std::bitset<MPEGTS_PID_COUNT>		m_videopids;			// Bitmap of video stream program ids
+	long long							m_filtered = 0;			// Number of filtered packets
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,899 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "rangestream.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#include "align.h"
+#include "http_exception.h"
+#include "string_exception.h"
+
+#pragma warning(push, 4)
+
+// rangestream::CHUNK_RETRIES (static)
+//
+// Maximum number of times the transfer of a single chunk is retried
+int const rangestream::CHUNK_RETRIES = 3;
+
+// rangestream::CHUNK_SIZE (static)
+//
+// Size of a single range of the stream; must be a multiple of MPEGTS_PACKET_LENGTH
+size_t const rangestream::CHUNK_SIZE = (188 * 4096);
+
+// rangestream::DEFAULT_MAX_CONNECTIONS (static)
+//
+// Default maximum number of concurrent connections
+size_t const rangestream::DEFAULT_MAX_CONNECTIONS = 4;
+
+// rangestream::DEFAULT_MEDIA_TYPE (static)
+//
+// Default media type to report for the stream
+char const* rangestream::DEFAULT_MEDIA_TYPE = "video/mp2t";
+
+// rangestream::MPEGTS_PACKET_LENGTH (static)
+//
+// Length of a single mpeg-ts data packet
+size_t const rangestream::MPEGTS_PACKET_LENGTH = 188;
+
+// rangestream::PROBE_INTERVAL (static)
+//
+// Interval at which the number of connections is adjusted
+std::chrono::milliseconds const rangestream::PROBE_INTERVAL(2000);
+
+// rangestream::READAHEAD_FACTOR (static)
+//
+// Number of chunks to read ahead for each connection
+size_t const rangestream::READAHEAD_FACTOR = 2;
+
+//---------------------------------------------------------------------------
+// rangestream Constructor (private)
+//
+// Arguments:
+//
+//	url				- URL of the stream to be opened
+//	maxconnections	- Maximum number of concurrent connections
+
+rangestream::rangestream(char const* url, size_t maxconnections) : m_url((url != nullptr) ? url : ""), 
+	m_maxconnections(maxconnections), m_probetime(std::chrono::steady_clock::now()), m_meter(std::chrono::seconds(1))
+{
+	if(url == nullptr) throw std::invalid_argument("url");
+	if(maxconnections == 0) throw std::invalid_argument("maxconnections");
+
+	// Create and initialize the curl multi interface object
+	m_curlm = curl_multi_init();
+	if(m_curlm == nullptr) throw string_exception(__func__, ": curl_multi_init() failed");
+
+	try {
+
+		// Disable pipelining/multiplexing on the multi interface object, each range gets its own connection
+		CURLMcode curlmresult = curl_multi_setopt(m_curlm, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+		if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_setopt(CURLMOPT_PIPELINING) failed: ", curl_multi_strerror(curlmresult));
+
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		// The first chunk is transferred on this thread to determine the length of the stream and to
+		// verify that the server actually honors range requests before any others are issued
+		std::unique_ptr<struct chunk> first(new struct chunk);
+		first->owner = this;
+		first->start = 0;
+		first->length = CHUNK_SIZE;
+		first->data.reset(new uint8_t[CHUNK_SIZE]);
+		first->curl = nullptr;
+		first->retries = 0;
+
+		struct chunk* chunk = first.get();
+		m_chunks.push_back(std::move(first));
+		transfer(lock, chunk);
+
+		// Execute the transfer until the response headers have been processed or it has completed
+		int running = 1;
+		while((!m_headers) && (running > 0)) {
+
+			lock.unlock();
+
+			curlmresult = curl_multi_perform(m_curlm, &running);
+			if((curlmresult == CURLM_OK) && (running > 0)) curlmresult = curl_multi_poll(m_curlm, nullptr, 0, 500, nullptr);
+			if(curlmresult != CURLM_OK) throw string_exception(__func__, ": ", curl_multi_strerror(curlmresult));
+
+			lock.lock();
+		}
+
+		long responsecode = 0;
+		curl_easy_getinfo(chunk->curl, CURLINFO_RESPONSE_CODE, &responsecode);
+
+		if(!m_headers) throw string_exception(__func__, ": failed to receive HTTP response headers");
+		if(responsecode != 206) throw string_exception(__func__, ": server did not honor the range request (HTTP ", responsecode, ")");
+		if(m_length < 0) throw string_exception(__func__, ": server did not report the length of the stream");
+
+		// The remainder of the stream is transferred by the background thread
+		m_nextpos = chunk->start + static_cast<long long>(chunk->length);
+		lock.unlock();
+
+		start_transfer();
+	}
+
+	// Release the chunk transfers and the multi handle on exception
+	catch(...) { close(); throw; }
+}
+
+//---------------------------------------------------------------------------
+// rangestream Destructor
+
+rangestream::~rangestream()
+{
+	close();
+}
+
+//---------------------------------------------------------------------------
+// rangestream::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* rangestream::acquire(size_t count, size_t* available)
+{
+	size_t				bytesavailable = 0;			// Available bytes in the first chunk
+
+	assert(m_curlm != nullptr);
+	assert(available != nullptr);
+
+	if(available == nullptr) throw std::invalid_argument("available");
+	*available = 0;
+
+	// The count should be aligned down to MPEGTS_PACKET_LENGTH
+	count = align::down(count, MPEGTS_PACKET_LENGTH);
+	if(count == 0) return nullptr;
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// If the end of the stream has been reached, there is nothing left to acquire
+	if(m_readpos >= m_length) return nullptr;
+
+	// Wait for data to become available in the chunk at the current read position
+	struct chunk* chunk = nullptr;
+	m_cv.wait(lock, [&]() -> bool {
+
+		chunk = current(lock);
+		bytesavailable = (chunk == nullptr) ? 0 : chunk->received - static_cast<size_t>(m_readpos - chunk->start);
+		return ((bytesavailable > 0) || (m_exception));
+	});
+
+	// If the background transfer failed, throw the exception once the available data has been consumed
+	if(bytesavailable == 0) std::rethrow_exception(m_exception);
+
+	// Reads are not aligned to return full MPEG-TS packets, determine the offset from the current
+	// read position to the first full packet of data; chunks other than the first end on a packet boundary
+	size_t packetoffset = static_cast<size_t>(align::up(m_readpos, MPEGTS_PACKET_LENGTH) - m_readpos);
+
+	// Starting with the lesser of the amount of data that is available to read and the
+	// originally requested count, adjust the end so that it aligns to a full MPEG-TS packet
+	count = std::min(bytesavailable, count);
+	if(count >= (packetoffset + MPEGTS_PACKET_LENGTH)) count = packetoffset + align::down(count - packetoffset, MPEGTS_PACKET_LENGTH);
+
+	*available = count;
+	return &chunk->data[static_cast<size_t>(m_readpos - chunk->start)];
+}
+
+//---------------------------------------------------------------------------
+// rangestream::adjust (private)
+//
+// Adjusts the number of connections based on the measured throughput
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+
+void rangestream::adjust(std::unique_lock<std::mutex> const& lock)
+{
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	// Keep the bitrate meter reported in the telemetry up to date
+	m_meter.sample();
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::milliseconds elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_probetime);
+	if(elapsed < PROBE_INTERVAL) return;
+
+	// Calculate the aggregate throughput of all connections over the probe interval
+	uint64_t const total = m_transferred;
+	uint64_t const rate = ((total - m_sampled) * 1000) / static_cast<uint64_t>(elapsed.count());
+	bool const saturated = m_saturated;
+
+	m_sampled = total;
+	m_probetime = now;
+	m_saturated = true;
+
+	// If the read-ahead window filled up or the end of the stream was reached, the throughput
+	// was limited by the reader rather than the connections; there is nothing to learn from it
+	if(!saturated) return;
+
+	// The number of connections needed to keep the path full is its bandwidth-delay product divided by
+	// what a single connection can keep in flight, neither of which can be measured directly. Probe for
+	// it instead: while another connection still raises the aggregate throughput by at least 1/8, the
+	// connections are each limited by their own window rather than the path, so add another one
+	if(m_probing) {
+
+		if((m_baseline == 0) || (rate >= (m_baseline + (m_baseline / 8)))) {
+
+			m_baseline = rate;
+			if(m_connections < m_maxconnections) m_connections++;
+			else m_probing = false;
+		}
+
+		// The last connection added didn't help, the path is full; back it off and stop probing
+		else {
+
+			if(m_connections > 1) m_connections--;
+			m_probing = false;
+		}
+	}
+
+	// If the throughput has fallen well below the baseline the conditions on the path have changed, probe again
+	else if(rate < (m_baseline - (m_baseline / 4))) {
+
+		m_baseline = 0;
+		m_probing = true;
+	}
+}
+
+//---------------------------------------------------------------------------
+// rangestream::canseek
+//
+// Gets a flag indicating if the stream allows seek operations
+//
+// Arguments:
+//
+//	NONE
+
+bool rangestream::canseek(void) const
+{
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::close
+//
+// Closes the stream
+//
+// Arguments:
+//
+//	NONE
+
+void rangestream::close(void)
+{
+	// The background transfer thread must be stopped and the chunk transfers released first
+	stop_transfer();
+
+	if(m_curlm != nullptr) curl_multi_cleanup(m_curlm);
+	m_curlm = nullptr;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::create (static)
+//
+// Factory method, creates a new rangestream instance
+//
+// Arguments:
+//
+//	url				- URL of the stream to be opened
+
+std::unique_ptr<rangestream> rangestream::create(char const* url)
+{
+	return create(url, DEFAULT_MAX_CONNECTIONS);
+}
+
+//---------------------------------------------------------------------------
+// rangestream::create (static)
+//
+// Factory method, creates a new rangestream instance
+//
+// Arguments:
+//
+//	url				- URL of the stream to be opened
+//	maxconnections	- Maximum number of concurrent connections
+
+std::unique_ptr<rangestream> rangestream::create(char const* url, size_t maxconnections)
+{
+	return std::unique_ptr<rangestream>(new rangestream(url, maxconnections));
+}
+
+//---------------------------------------------------------------------------
+// rangestream::curl_responseheaders (static, private)
+//
+// libcurl callback to process response headers
+//
+// Arguments:
+//
+//	data		- Pointer to the response header data
+//	size		- Size of a single data element
+//	count		- Number of data elements
+//	context		- Caller-provided context pointer
+
+size_t rangestream::curl_responseheaders(char const* data, size_t size, size_t count, void* context)
+{
+	static const char CONTENT_RANGE_HEADER[]		= "Content-Range: bytes";
+	static const char CONTENT_TYPE_HEADER[]			= "Content-Type:";
+	static const char EMPTY_HEADER[]				= "\r\n";
+	static const size_t CONTENT_RANGE_HEADER_LEN	= strlen(CONTENT_RANGE_HEADER);
+	static const size_t CONTENT_TYPE_HEADER_LEN		= strlen(CONTENT_TYPE_HEADER);
+	static const size_t EMPTY_HEADER_LEN			= strlen(EMPTY_HEADER);
+
+	size_t cb = size * count;						// Calculate the actual byte count
+	if(cb == 0) return 0;							// Nothing to do
+
+	// Cast the context pointer back into a chunk and get the owning instance
+	struct chunk* chunk = reinterpret_cast<struct chunk*>(context);
+	rangestream* instance = chunk->owner;
+
+	// Content-Range: bytes <range-start>-<range-end>/<size>
+	if((cb >= CONTENT_RANGE_HEADER_LEN) && (strncmp(CONTENT_RANGE_HEADER, data, CONTENT_RANGE_HEADER_LEN) == 0)) {
+
+		long long start = 0;							// <range-start>
+		long long end = 0;								// <range-end>
+		long long length = 0;							// <size>
+
+		// Only a complete Content-Range: header provides a usable stream length
+		if(sscanf(std::string(data, cb).c_str(), "Content-Range: bytes %lld-%lld/%lld", &start, &end, &length) == 3) instance->m_length = length;
+	}
+
+	// Content-Type: <media-type>[; charset=<charset>][ ;boundary=<boundary>]
+	else if((cb >= CONTENT_TYPE_HEADER_LEN) && (strncmp(CONTENT_TYPE_HEADER, data, CONTENT_TYPE_HEADER_LEN) == 0)) {
+
+		char mediatype[128];						// <media-type>
+
+		// Attempt to parse the media-type from the Context-Type header and set for the stream if found
+		if(sscanf(std::string(data, cb).c_str(), "Content-Type: %127[^;\r\n]", mediatype) == 1)
+			instance->m_mediatype.assign(mediatype);
+	}
+
+	// \r\n (empty header)
+	else if((cb >= EMPTY_HEADER_LEN) && (strncmp(EMPTY_HEADER, data, EMPTY_HEADER_LEN) == 0)) {
+
+		// The final header has been processed; if the stream is shorter than the chunk, shorten the chunk
+		if((instance->m_length >= chunk->start) && ((instance->m_length - chunk->start) < static_cast<long long>(chunk->length)))
+			chunk->length = static_cast<size_t>(instance->m_length - chunk->start);
+
+		instance->m_headers = true;
+	}
+
+	return cb;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::curl_write (static, private)
+//
+// libcurl callback to write transferred data into a chunk
+//
+// Arguments:
+//
+//	data		- Pointer to the data to be written
+//	size		- Size of a single data element
+//	count		- Number of data elements
+//	context		- Caller-provided context pointer
+
+size_t rangestream::curl_write(void const* data, size_t size, size_t count, void* context)
+{
+	size_t				cb = size * count;			// Calculate the actual byte count
+
+	if((data == nullptr) || (cb == 0) || (context == nullptr)) return 0;
+
+	// Cast the context pointer back into a chunk and get the owning instance
+	struct chunk* chunk = reinterpret_cast<struct chunk*>(context);
+	rangestream* instance = chunk->owner;
+
+	// If the server sends more data than was requested it didn't honor the range, fail the transfer
+	size_t const received = chunk->received;
+	if(cb > (chunk->length - received)) return 0;
+
+	// Only this transfer writes into the chunk, copy the data before publishing the new amount
+	memcpy(&chunk->data[received], data, cb);
+	chunk->received = received + cb;
+
+	instance->m_meter.add(cb);
+	instance->m_transferred += cb;
+
+	// Wake up the consumer if it's waiting on data for this chunk
+	std::unique_lock<std::mutex> lock(instance->m_lock);
+	instance->m_cv.notify_all();
+
+	return cb;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::current (private)
+//
+// Gets the chunk that contains the current read position
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+
+struct rangestream::chunk* rangestream::current(std::unique_lock<std::mutex> const& lock) const
+{
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	// The consumed chunks ahead of the read position are discarded by the worker thread
+	for(auto const& chunk : m_chunks) {
+
+		if((m_readpos >= chunk->start) && ((m_readpos - chunk->start) < static_cast<long long>(chunk->length))) return chunk.get();
+	}
+
+	return nullptr;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::finish (private)
+//
+// Handles the completion of a chunk transfer
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+//	curl		- Completed transfer handle
+//	result		- Result code from the completed transfer
+
+void rangestream::finish(std::unique_lock<std::mutex> const& lock, CURL* curl, CURLcode result)
+{
+	struct chunk*		chunk = nullptr;			// Chunk being transferred
+	long				responsecode = 0;			// HTTP response code
+
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	curl_easy_getinfo(curl, CURLINFO_PRIVATE, reinterpret_cast<char**>(&chunk));
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responsecode);
+	assert((chunk != nullptr) && (chunk->curl == curl));
+
+	// Release the transfer handle, the connection is now available for another chunk
+	curl_multi_remove_handle(m_curlm, curl);
+	curl_easy_cleanup(curl);
+	chunk->curl = nullptr;
+	m_active--;
+
+	if((result == CURLE_OK) && (responsecode == 206) && (chunk->received == chunk->length)) return;
+
+	// A chunk that was not completely transferred is requested again from where it left off
+	if(++chunk->retries > CHUNK_RETRIES) {
+
+		if(result != CURLE_OK) throw string_exception(__func__, ": ", curl_easy_strerror(result));
+		else if((responsecode < 200) || (responsecode > 299)) throw http_exception(responsecode);
+		else throw string_exception(__func__, ": incomplete range transfer at position ", chunk->start + static_cast<long long>(chunk->received.load()));
+	}
+
+	m_retries++;
+	transfer(lock, chunk);
+}
+
+//---------------------------------------------------------------------------
+// rangestream::length
+//
+// Gets the length of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long rangestream::length(void) const
+{
+	return m_length;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::mediatype
+//
+// Gets the media type of the stream
+//
+// Arguments:
+//
+//	NONE
+
+char const* rangestream::mediatype(void) const
+{
+	return m_mediatype.c_str();
+}
+
+//---------------------------------------------------------------------------
+// rangestream::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long rangestream::minposition(void) const
+{
+	return 0;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long rangestream::position(void) const
+{
+	return m_readpos;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::read
+//
+// Reads data from the stream
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t rangestream::read(uint8_t* buffer, size_t count)
+{
+	size_t				available = 0;			// Available bytes to read
+
+	// Acquire a contiguous region of the chunk and copy it into the destination buffer
+	uint8_t* data = acquire(count, &available);
+	if((buffer != nullptr) && (available > 0)) memcpy(buffer, data, available);
+
+	release(available);
+	return available;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool rangestream::realtime(void) const
+{
+	return false;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
+
+void rangestream::release(size_t count)
+{
+	if(count == 0) return;
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	struct chunk const* chunk = current(lock);
+	assert((chunk != nullptr) && ((m_readpos - chunk->start) + static_cast<long long>(count) <= static_cast<long long>(chunk->received)));
+
+	m_readpos += count;						// Update the reader position
+
+	// Once a chunk has been consumed wake up the background thread to discard it,
+	// there is now room in the read-ahead window for another chunk
+	if((chunk != nullptr) && ((m_readpos - chunk->start) >= static_cast<long long>(chunk->length))) curl_multi_wakeup(m_curlm);
+}
+
+//---------------------------------------------------------------------------
+// rangestream::schedule (private)
+//
+// Starts transfers of the next chunks of the stream
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+
+void rangestream::schedule(std::unique_lock<std::mutex> const& lock)
+{
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	// Discard the chunks that precede the read position; this thread owns the transfers so any
+	// that are still active can be safely removed from the multi interface handle
+	while((!m_chunks.empty()) && ((m_readpos - m_chunks.front()->start) >= static_cast<long long>(m_chunks.front()->length))) {
+
+		CURL* curl = m_chunks.front()->curl;
+		if(curl != nullptr) {
+
+			curl_multi_remove_handle(m_curlm, curl);
+			curl_easy_cleanup(curl);
+			m_active--;
+		}
+
+		m_chunks.pop_front();
+	}
+
+	// Start a new transfer for each available connection until the read-ahead window
+	// has filled up or the final chunk of the stream has been requested
+	while(m_active < m_connections) {
+
+		if((m_nextpos >= m_length) || (m_chunks.size() >= (m_connections * READAHEAD_FACTOR))) { m_saturated = false; break; }
+
+		// Chunks end on a CHUNK_SIZE boundary so that only the first chunk after a seek is short
+		long long const chunksize = static_cast<long long>(CHUNK_SIZE);
+		long long const end = std::min(((m_nextpos / chunksize) + 1) * chunksize, m_length);
+
+		std::unique_ptr<struct chunk> next(new struct chunk);
+		next->owner = this;
+		next->start = m_nextpos;
+		next->length = static_cast<size_t>(end - m_nextpos);
+		next->data.reset(new uint8_t[next->length]);
+		next->curl = nullptr;
+		next->retries = 0;
+
+		transfer(lock, next.get());
+
+		m_nextpos = end;
+		m_chunks.push_back(std::move(next));
+	}
+}
+
+//---------------------------------------------------------------------------
+// rangestream::seek
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long rangestream::seek(long long position, int whence)
+{
+	long long			newposition = 0;				// New stream position
+
+	assert(m_curlm != nullptr);
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// Calculate the new position of the stream
+	if(whence == SEEK_SET) newposition = position;
+	else if(whence == SEEK_CUR) newposition = m_readpos + position;
+	else if(whence == SEEK_END) newposition = m_length + position;
+	else throw std::invalid_argument("whence");
+
+	// Constrain the new position to the bounds of the stream
+	newposition = std::min(std::max(newposition, 0LL), m_length);
+	if(newposition == m_readpos) return m_readpos;
+
+	// If the new position is within a chunk that is already being read ahead, just move the read position
+	// and let the background thread discard the chunks that precede it rather than restarting the transfers
+	if((!m_exception) && (!m_chunks.empty()) && (newposition >= m_chunks.front()->start) && (newposition < m_nextpos)) {
+
+		m_readpos = newposition;
+
+		curl_multi_wakeup(m_curlm);
+		return m_readpos;
+	}
+
+	lock.unlock();
+
+	// Restart the transfers at the new position; the number of connections is retained
+	stop_transfer();
+
+	m_readpos = m_nextpos = newposition;
+	m_exception = nullptr;
+
+	start_transfer();
+
+	return m_readpos;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::start_transfer (private)
+//
+// Starts the background data transfer thread
+//
+// Arguments:
+//
+//	NONE
+
+void rangestream::start_transfer(void)
+{
+	assert(m_curlm != nullptr);
+
+	if(m_worker.joinable()) return;			// Already running
+
+	m_stop = false;							// Reset the stop signal
+
+	// Define and launch the data transfer worker thread
+	m_worker = std::thread([&]() -> void {
+
+		try {
+
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			while(!m_stop) {
+
+				// Fill the available connections with new chunk transfers
+				schedule(lock);
+
+				// The write callbacks acquire the lock, release it while the transfers are executing
+				lock.unlock();
+
+				int running = 0;
+				CURLMcode curlmresult = curl_multi_perform(m_curlm, &running);
+				if(curlmresult != CURLM_OK) throw string_exception(__func__, ": ", curl_multi_strerror(curlmresult));
+
+				lock.lock();
+
+				// Process all of the transfers that have completed
+				int nummessages = 0;
+				struct CURLMsg* msg = curl_multi_info_read(m_curlm, &nummessages);
+				while(msg != nullptr) {
+
+					if(msg->msg == CURLMSG_DONE) finish(lock, msg->easy_handle, msg->data.result);
+					msg = curl_multi_info_read(m_curlm, &nummessages);
+				}
+
+				// Adjust the number of connections and wake up the consumer in case a chunk has completed
+				adjust(lock);
+				m_cv.notify_all();
+
+				// Wait for activity on the transfers or for the consumer to release a chunk
+				lock.unlock();
+				curlmresult = curl_multi_poll(m_curlm, nullptr, 0, 500, nullptr);
+				if(curlmresult != CURLM_OK) throw string_exception(__func__, ": ", curl_multi_strerror(curlmresult));
+				lock.lock();
+			}
+		}
+
+		// Exceptions that occur on the worker thread are rethrown by acquire() after the data has been consumed
+		catch(...) { 
+			
+			std::unique_lock<std::mutex> lock(m_lock); 
+			m_exception = std::current_exception(); 
+			m_cv.notify_all(); 
+		}
+	});
+}
+
+//---------------------------------------------------------------------------
+// rangestream::stop_transfer (private)
+//
+// Stops the background data transfer thread and discards all chunks
+//
+// Arguments:
+//
+//	NONE
+
+void rangestream::stop_transfer(void)
+{
+	// Signal the worker thread to stop, wake it up from any wait it may be in, and wait for it to exit
+	if(m_worker.joinable()) {
+
+		m_stop = true;
+		curl_multi_wakeup(m_curlm);
+		m_worker.join();
+	}
+
+	// Release all of the outstanding chunk transfers and discard the chunks
+	std::unique_lock<std::mutex> lock(m_lock);
+	for(auto const& chunk : m_chunks) {
+
+		if(chunk->curl == nullptr) continue;
+
+		curl_multi_remove_handle(m_curlm, chunk->curl);
+		curl_easy_cleanup(chunk->curl);
+	}
+
+	m_chunks.clear();
+	m_active = 0;
+}
+
+//---------------------------------------------------------------------------
+// rangestream::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void rangestream::telemetry(telemetry_t& values) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	values.emplace_back("rangestream.connections", static_cast<long long>(m_connections));
+	values.emplace_back("rangestream.active_connections", static_cast<long long>(m_active));
+	values.emplace_back("rangestream.readahead_chunks", static_cast<long long>(m_chunks.size()));
+	values.emplace_back("rangestream.bytes_per_second", static_cast<long long>(m_meter.bytespersecond()));
+	values.emplace_back("rangestream.requests", static_cast<long long>(m_requests));
+	values.emplace_back("rangestream.retries", static_cast<long long>(m_retries));
+}
+
+//---------------------------------------------------------------------------
+// rangestream::transfer (private)
+//
+// Starts or restarts the transfer of a chunk
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+//	chunk		- Chunk to be transferred
+
+void rangestream::transfer(std::unique_lock<std::mutex> const& lock, struct chunk* chunk)
+{
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	assert((chunk != nullptr) && (chunk->curl == nullptr));
+	if(chunk == nullptr) throw std::invalid_argument("chunk");
+
+	// Create and initialize the curl easy interface object for this transfer
+	CURL* curl = curl_easy_init();
+	if(curl == nullptr) throw string_exception(__func__, ": curl_easy_init() failed");
+
+	try {
+
+		// Request the portion of the chunk that has not yet been received
+		char byterange[64] = { '\0' };
+		snprintf(byterange, std::extent<decltype(byterange)>::value, "%lld-%lld", chunk->start + static_cast<long long>(chunk->received.load()),
+			chunk->start + static_cast<long long>(chunk->length) - 1);
+
+		// Set the options for the easy interface curl handle
+		CURLcode curlresult = curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+		if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+		if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+		if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &rangestream::curl_write);
+		if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(curl, CURLOPT_WRITEDATA, chunk);
+		if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(curl, CURLOPT_PRIVATE, chunk);
+		if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(curl, CURLOPT_RANGE, byterange);
+
+		// Until the response headers for the stream have been processed, process them for this transfer
+		if((curlresult == CURLE_OK) && (!m_headers)) curlresult = curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &rangestream::curl_responseheaders);
+		if((curlresult == CURLE_OK) && (!m_headers)) curlresult = curl_easy_setopt(curl, CURLOPT_HEADERDATA, chunk);
+		if(curlresult != CURLE_OK) throw string_exception(__func__, ": curl_easy_setopt() failed: ", curl_easy_strerror(curlresult));
+
+		// Add the easy handle to the multi handle to start the transfer
+		CURLMcode curlmresult = curl_multi_add_handle(m_curlm, curl);
+		if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_add_handle() failed: ", curl_multi_strerror(curlmresult));
+	}
+
+	// Clean up and destroy the easy handle on exception
+	catch(...) { curl_easy_cleanup(curl); throw; }
+
+	chunk->curl = curl;
+	m_active++;
+	m_requests++;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,279 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __RANGESTREAM_H_
+#define __RANGESTREAM_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "bitratemeter.h"
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class rangestream
+//
+// Implements an HTTP-based PVR stream that reads ahead of the current position
+// by transferring consecutive ranges of the stream over multiple connections
+
+class rangestream : public pvrstream
+{
+public:
+
+	// Destructor
+	//
+	virtual ~rangestream();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
+	// canseek
+	//
+	// Flag indicating if the stream allows seek operations
+	bool canseek(void) const;
+
+	// close
+	//
+	// Closes the stream
+	void close(void);
+
+	// create (static)
+	//
+	// Factory method, creates a new rangestream instance
+	static std::unique_ptr<rangestream> create(char const* url);
+	static std::unique_ptr<rangestream> create(char const* url, size_t maxconnections);
+
+	// length
+	//
+	// Gets the length of the stream
+	long long length(void) const;
+
+	// mediatype
+	//
+	// Gets the media type of the stream
+	char const* mediatype(void) const;
+
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
+	// position
+	//
+	// Gets the current position of the stream
+	long long position(void) const;
+
+	// read
+	//
+	// Reads available data from the stream
+	size_t read(uint8_t* buffer, size_t count);
+
+	// realtime
+	//
+	// Gets a flag indicating if the stream is real-time
+	bool realtime(void) const;
+
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
+	// seek
+	//
+	// Sets the stream pointer to a specific position
+	long long seek(long long position, int whence);
+
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
+private:
+
+	rangestream(rangestream const&)=delete;
+	rangestream& operator=(rangestream const&)=delete;
+
+	// chunk
+	//
+	// Structure used to track a single range of the stream
+	struct chunk {
+
+		rangestream*				owner;			// Owning stream instance
+		long long					start;			// Starting position of the range
+		size_t						length;			// Length of the range
+		std::unique_ptr<uint8_t[]>	data;			// Range data
+		std::atomic<size_t>			received{0};	// Amount of data received
+		CURL*						curl;			// Active transfer handle
+		int							retries;		// Number of transfer retries
+	};
+
+	// CHUNK_RETRIES
+	//
+	// Maximum number of times the transfer of a single chunk is retried
+	static int const CHUNK_RETRIES;
+
+	// CHUNK_SIZE
+	//
+	// Size of a single range of the stream
+	static size_t const CHUNK_SIZE;
+
+	// DEFAULT_MAX_CONNECTIONS
+	//
+	// Default maximum number of concurrent connections
+	static size_t const DEFAULT_MAX_CONNECTIONS;
+
+	// DEFAULT_MEDIA_TYPE
+	//
+	// Default media type to report for the stream
+	static char const* DEFAULT_MEDIA_TYPE;
+
+	// MPEGTS_PACKET_LENGTH
+	//
+	// Length of a single mpeg-ts data packet
+	static size_t const MPEGTS_PACKET_LENGTH;
+
+	// PROBE_INTERVAL
+	//
+	// Interval at which the number of connections is adjusted
+	static std::chrono::milliseconds const PROBE_INTERVAL;
+
+	// READAHEAD_FACTOR
+	//
+	// Number of chunks to read ahead for each connection
+	static size_t const READAHEAD_FACTOR;
+
+	// Instance Constructor
+	//
+	rangestream(char const* url, size_t maxconnections);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// adjust
+	//
+	// Adjusts the number of connections based on the measured throughput
+	void adjust(std::unique_lock<std::mutex> const& lock);
+
+	// curl_responseheaders (static)
+	//
+	// libcurl callback to handle processing of response headers
+	static size_t curl_responseheaders(char const* data, size_t size, size_t count, void* context);
+
+	// curl_write (static)
+	//
+	// libcurl callback to write received data into a chunk
+	static size_t curl_write(void const* data, size_t size, size_t count, void* context);
+
+	// current
+	//
+	// Gets the chunk that contains the current read position
+	struct chunk* current(std::unique_lock<std::mutex> const& lock) const;
+
+	// finish
+	//
+	// Handles the completion of a chunk transfer
+	void finish(std::unique_lock<std::mutex> const& lock, CURL* curl, CURLcode result);
+
+	// schedule
+	//
+	// Discards consumed chunks and starts transfers of the next chunks
+	void schedule(std::unique_lock<std::mutex> const& lock);
+
+	// start_transfer
+	//
+	// Starts the background data transfer thread
+	void start_transfer(void);
+
+	// stop_transfer
+	//
+	// Stops the background data transfer thread and discards all chunks
+	void stop_transfer(void);
+
+	// transfer
+	//
+	// Starts or restarts the transfer of a chunk
+	void transfer(std::unique_lock<std::mutex> const& lock, struct chunk* chunk);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	// STREAM STATE
+	//
+	std::string const			m_url;								// Stream URL
+	CURLM*						m_curlm = nullptr;					// CURL multi interface handle
+	bool						m_headers = false;					// Flag if headers have been processed
+	std::string					m_mediatype = DEFAULT_MEDIA_TYPE;	// Stream media type
+	long long					m_length = -1;						// Length of the stream
+	long long					m_readpos = 0;						// Current read position
+	long long					m_nextpos = 0;						// Next position to transfer
+
+	// CHUNKS
+	//
+	std::deque<std::unique_ptr<struct chunk>>	m_chunks;			// Chunks being read ahead
+
+	// CONNECTIONS
+	//
+	size_t const				m_maxconnections;					// Maximum connections
+	size_t						m_connections = 1;					// Current connection target
+	size_t						m_active = 0;						// Active connections
+	bool						m_probing = true;					// Flag if probing for more
+	bool						m_saturated = true;					// Flag if transfer bound
+	uint64_t					m_baseline = 0;						// Baseline throughput
+	uint64_t					m_sampled = 0;						// Total at last probe
+	std::chrono::steady_clock::time_point	m_probetime;			// Time of last probe
+
+	// TRANSFER
+	//
+	std::thread					m_worker;							// Data transfer thread
+	mutable std::mutex			m_lock;								// Synchronization object
+	std::condition_variable		m_cv;								// Wakeup condition variable
+	std::atomic<bool>			m_stop{false};						// Flag to stop the worker
+	std::exception_ptr			m_exception;						// Exception from the worker
+	bitratemeter				m_meter;							// Incoming bitrate meter
+
+	// TELEMETRY
+	//
+	std::atomic<uint64_t>		m_transferred{0};					// Total bytes transferred
+	size_t						m_requests = 0;						// Number of range requests
+	size_t						m_retries = 0;						// Number of range retries
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __RANGESTREAM_H_
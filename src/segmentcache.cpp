@@ -0,0 +1,378 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "segmentcache.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <string.h>
+
+#if !defined(_WINDOWS) && !defined(WINAPI_FAMILY)
+#include <unistd.h>
+#endif
+
+#include "string_exception.h"
+
+#pragma warning(push, 4)
+
+// segmentcache::SEGMENT_SIZE (static)
+//
+// Maximum size of a single cached segment
+size_t const segmentcache::SEGMENT_SIZE = (1 MiB);
+
+// MAX_SPILL_FILE_SIZE
+//
+// Maximum size of the spill file; where off_t is only 32 bits wide, fseeko() can't
+// address anything beyond 2GiB
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+static size_t const MAX_SPILL_FILE_SIZE = std::numeric_limits<size_t>::max();
+#else
+static size_t const MAX_SPILL_FILE_SIZE = (sizeof(off_t) >= sizeof(int64_t)) ? std::numeric_limits<size_t>::max() : (2047 MiB);
+#endif
+
+//---------------------------------------------------------------------------
+// seek_file (local)
+//
+// Sets the position of a file using a 64-bit offset from the beginning
+//
+// Arguments:
+//
+//	file		- File to be positioned
+//	offset		- Offset from the beginning of the file
+
+static bool seek_file(FILE* file, long long offset)
+{
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+	return (_fseeki64(file, offset, SEEK_SET) == 0);
+#else
+	return (fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0);
+#endif
+}
+
+//---------------------------------------------------------------------------
+// segmentcache Constructor (private)
+//
+// Arguments:
+//
+//	memorysize		- Maximum amount of memory to use for cached segments
+//	path			- Path to the spill file, or nullptr to disable
+//	filesize		- Maximum size of the spill file
+
+segmentcache::segmentcache(size_t memorysize, char const* path, size_t filesize) : 
+	m_maxsegments(std::max(memorysize / SEGMENT_SIZE, static_cast<size_t>(1))), 
+	m_path((path != nullptr) ? path : ""), m_maxslots((path != nullptr) ? std::min(filesize, MAX_SPILL_FILE_SIZE) / SEGMENT_SIZE : 0)
+{
+	if(m_maxslots == 0) return;
+
+	// The spill file is created anew; on POSIX platforms it can be unlinked immediately
+	// after being opened, on Windows it's removed when the cache is destroyed
+	m_file = fopen(m_path.c_str(), "w+b");
+	if(m_file == nullptr) throw string_exception(__func__, ": unable to create seek cache spill file ", m_path.c_str());
+
+#if !defined(_WINDOWS) && !defined(WINAPI_FAMILY)
+	unlink(m_path.c_str());
+#endif
+
+	// Every slot in the spill file is initially available, use them in ascending order
+	m_freeslots.reserve(m_maxslots);
+	for(size_t index = m_maxslots; index > 0; index--) m_freeslots.push_back(index - 1);
+}
+
+//---------------------------------------------------------------------------
+// segmentcache Destructor
+
+segmentcache::~segmentcache()
+{
+	if(m_file == nullptr) return;
+
+	fclose(m_file);
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+	remove(m_path.c_str());
+#endif
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::add
+//
+// Adds data to the cache at the specified stream position
+//
+// Arguments:
+//
+//	position	- Stream position of the data
+//	data		- Data to be added to the cache
+//	count		- Length of the data to be added to the cache
+
+void segmentcache::add(long long position, uint8_t const* data, size_t count)
+{
+	assert(data != nullptr);
+	if((data == nullptr) || (position < 0)) return;
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	while(count > 0) {
+
+		size_t chunk = 0;							// Amount of data processed
+
+		// Locate the first segment that starts after the position and the segment before it, if any
+		auto next = m_segments.upper_bound(position);
+		auto previous = (next != m_segments.begin()) ? std::prev(next) : m_segments.end();
+
+		// Data that has already been cached is skipped over
+		if((previous != m_segments.end()) && (position < (previous->first + static_cast<long long>(previous->second.length)))) 
+			chunk = std::min(count, static_cast<size_t>((previous->first + previous->second.length) - position));
+
+		// Data that is adjacent to the end of an in-memory segment that has space remaining is
+		// merged into that segment rather than starting a new one
+		else if((previous != m_segments.end()) && (previous->second.data) && (previous->second.length < SEGMENT_SIZE) &&
+			(position == (previous->first + static_cast<long long>(previous->second.length)))) {
+
+			chunk = std::min(count, SEGMENT_SIZE - previous->second.length);
+			if(next != m_segments.end()) chunk = std::min(chunk, static_cast<size_t>(next->first - position));
+
+			memcpy(&previous->second.data[previous->second.length], data, chunk);
+			previous->second.length += chunk;
+			touch(lock, previous);
+		}
+
+		else {
+
+			// Make room in memory for a new segment; this may invalidate the iterators
+			if(m_memorylru.size() >= m_maxsegments) {
+
+				evict(lock);
+				continue;
+			}
+
+			chunk = std::min(count, SEGMENT_SIZE);
+			if(next != m_segments.end()) chunk = std::min(chunk, static_cast<size_t>(next->first - position));
+
+			segment_t segment{ chunk, std::unique_ptr<uint8_t[]>(new uint8_t[SEGMENT_SIZE]), 0, m_memorylru.end() };
+			memcpy(segment.data.get(), data, chunk);
+
+			segment.lru = m_memorylru.insert(m_memorylru.begin(), position);
+			m_segments.emplace(position, std::move(segment));
+		}
+
+		position += chunk;
+		data += chunk;
+		count -= chunk;
+	}
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::available
+//
+// Gets the amount of contiguous data cached at the specified stream position
+//
+// Arguments:
+//
+//	position	- Stream position to check
+
+size_t segmentcache::available(long long position) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	auto segment = find(lock, position);
+	if(segment == m_segments.end()) return 0;
+
+	// Adjacent segments are treated as a single contiguous range of data
+	long long end = segment->first + static_cast<long long>(segment->second.length);
+	for(++segment; (segment != m_segments.end()) && (segment->first == end); ++segment) end += segment->second.length;
+
+	return static_cast<size_t>(end - position);
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::create (static)
+//
+// Factory method, creates a new segmentcache instance
+//
+// Arguments:
+//
+//	memorysize		- Maximum amount of memory to use for cached segments
+
+std::unique_ptr<segmentcache> segmentcache::create(size_t memorysize)
+{
+	return std::unique_ptr<segmentcache>(new segmentcache(memorysize, nullptr, 0));
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::create (static)
+//
+// Factory method, creates a new segmentcache instance
+//
+// Arguments:
+//
+//	memorysize		- Maximum amount of memory to use for cached segments
+//	path			- Path to the spill file
+//	filesize		- Maximum size of the spill file
+
+std::unique_ptr<segmentcache> segmentcache::create(size_t memorysize, char const* path, size_t filesize)
+{
+	if(path == nullptr) throw std::invalid_argument("path");
+	return std::unique_ptr<segmentcache>(new segmentcache(memorysize, path, filesize));
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::evict (private)
+//
+// Evicts the least recently used segment from memory
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+
+void segmentcache::evict(std::unique_lock<std::mutex> const& lock)
+{
+	assert(lock.owns_lock());
+	assert(!m_memorylru.empty());
+
+	auto segment = m_segments.find(m_memorylru.back());
+	assert(segment != m_segments.end());
+
+	m_memorylru.pop_back();
+
+	// Without a spill file, the segment is simply discarded
+	if(m_file == nullptr) { m_segments.erase(segment); return; }
+
+	// If the spill file is full, discard the least recently used segment from it
+	if(m_freeslots.empty()) {
+
+		auto spilled = m_segments.find(m_filelru.back());
+		assert(spilled != m_segments.end());
+
+		m_filelru.pop_back();
+		m_freeslots.push_back(spilled->second.slot);
+		m_segments.erase(spilled);
+	}
+
+	size_t slot = m_freeslots.back();
+
+	// Write the segment into the spill file; if that fails the segment is discarded
+	if((!seek_file(m_file, static_cast<long long>(slot) * static_cast<long long>(SEGMENT_SIZE))) || 
+		(fwrite(segment->second.data.get(), 1, segment->second.length, m_file) != segment->second.length)) {
+
+		m_segments.erase(segment);
+		return;
+	}
+
+	m_freeslots.pop_back();
+
+	segment->second.data.reset();
+	segment->second.slot = slot;
+	segment->second.lru = m_filelru.insert(m_filelru.begin(), segment->first);
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::find (private)
+//
+// Locates the segment that contains the specified stream position
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+//	position	- Stream position to locate
+
+segmentcache::segments_t::const_iterator segmentcache::find(std::unique_lock<std::mutex> const& lock, long long position) const
+{
+	assert(lock.owns_lock());
+
+	auto segment = m_segments.upper_bound(position);
+	if(segment == m_segments.begin()) return m_segments.end();
+
+	--segment;
+	return (position < (segment->first + static_cast<long long>(segment->second.length))) ? segment : m_segments.end();
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::read
+//
+// Reads contiguous cached data starting at the specified stream position
+//
+// Arguments:
+//
+//	position	- Stream position from which to read
+//	buffer		- Buffer to receive the cached data
+//	count		- Size of the destination buffer in bytes
+
+size_t segmentcache::read(long long position, uint8_t* buffer, size_t count)
+{
+	size_t			bytesread = 0;			// Total bytes actually read
+
+	assert(buffer != nullptr);
+	if(buffer == nullptr) return 0;
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	auto found = find(lock, position);
+	if(found == m_segments.end()) return 0;
+
+	// Convert the const_iterator into an iterator to allow the LRU position to be updated
+	auto segment = m_segments.erase(found, found);
+
+	// Copy data from adjacent segments until the count has been satisfied or there is a gap
+	while((count > 0) && (segment != m_segments.end()) && (segment->first <= position)) {
+
+		size_t offset = static_cast<size_t>(position - segment->first);
+		size_t chunk = std::min(count, segment->second.length - offset);
+
+		// Segments held in memory are copied directly, otherwise read from the spill file
+		if(segment->second.data) memcpy(&buffer[bytesread], &segment->second.data[offset], chunk);
+		else if((!seek_file(m_file, (static_cast<long long>(segment->second.slot) * static_cast<long long>(SEGMENT_SIZE)) + static_cast<long long>(offset))) ||
+			(fread(&buffer[bytesread], 1, chunk, m_file) != chunk)) break;
+
+		touch(lock, segment);
+
+		position += chunk;
+		bytesread += chunk;
+		count -= chunk;
+
+		++segment;
+	}
+
+	return bytesread;
+}
+
+//---------------------------------------------------------------------------
+// segmentcache::touch (private)
+//
+// Marks a segment as the most recently used
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+//	segment		- Segment to be marked as most recently used
+
+void segmentcache::touch(std::unique_lock<std::mutex> const& lock, segments_t::iterator segment)
+{
+	assert(lock.owns_lock());
+
+	std::list<long long>& lru = (segment->second.data) ? m_memorylru : m_filelru;
+	lru.splice(lru.begin(), lru, segment->second.lru);
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __SEGMENTCACHE_H_
+#define __SEGMENTCACHE_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------
+// Class segmentcache
+//
+// Implements a bounded LRU cache of previously transferred stream byte ranges,
+// held in memory with an optional spill file for segments evicted from memory
+
+class segmentcache
+{
+public:
+
+	// Destructor
+	//
+	~segmentcache();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// add
+	//
+	// Adds data to the cache at the specified stream position
+	void add(long long position, uint8_t const* data, size_t count);
+
+	// available
+	//
+	// Gets the amount of contiguous data cached at the specified stream position
+	size_t available(long long position) const;
+
+	// create (static)
+	//
+	// Factory method, creates a new segmentcache instance
+	static std::unique_ptr<segmentcache> create(size_t memorysize);
+	static std::unique_ptr<segmentcache> create(size_t memorysize, char const* path, size_t filesize);
+
+	// read
+	//
+	// Reads contiguous cached data starting at the specified stream position
+	size_t read(long long position, uint8_t* buffer, size_t count);
+
+	// SEGMENT_SIZE
+	//
+	// Maximum size of a single cached segment
+	static size_t const SEGMENT_SIZE;
+
+private:
+
+	segmentcache(segmentcache const&)=delete;
+	segmentcache& operator=(segmentcache const&)=delete;
+
+	// segment_t
+	//
+	// Describes a single cached segment
+	struct segment_t {
+
+		size_t							length;			// Length of the segment data
+		std::unique_ptr<uint8_t[]>		data;			// Segment data, if held in memory
+		size_t							slot;			// Spill file slot, if not held in memory
+		std::list<long long>::iterator	lru;			// Position within the LRU list
+	};
+
+	// segments_t
+	//
+	// Collection of cached segments, keyed by stream position
+	using segments_t = std::map<long long, segment_t>;
+
+	// Instance Constructor
+	//
+	segmentcache(size_t memorysize, char const* path, size_t filesize);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// evict
+	//
+	// Evicts the least recently used segment from memory
+	void evict(std::unique_lock<std::mutex> const& lock);
+
+	// find
+	//
+	// Locates the segment that contains the specified stream position
+	segments_t::const_iterator find(std::unique_lock<std::mutex> const& lock, long long position) const;
+
+	// touch
+	//
+	// Marks a segment as the most recently used
+	void touch(std::unique_lock<std::mutex> const& lock, segments_t::iterator segment);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	mutable std::mutex				m_lock;					// Synchronization object
+	segments_t						m_segments;				// Cached segments
+
+	// MEMORY
+	//
+	size_t const					m_maxsegments;			// Maximum segments in memory
+	std::list<long long>			m_memorylru;			// In-memory segment LRU list
+
+	// SPILL FILE
+	//
+	std::string const				m_path;					// Spill file path
+	size_t const					m_maxslots;				// Maximum segments in the spill file
+	FILE*							m_file = nullptr;		// Spill file handle
+	std::list<long long>			m_filelru;				// Spill file segment LRU list
+	std::vector<size_t>				m_freeslots;			// Available spill file slots
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __SEGMENTCACHE_H_
@@ -0,0 +1,369 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "streammeter.h"
+
+#pragma warning(push, 4)
+
+// streammeter::LATENCY_BUCKETS (static)
+//
+// Upper bounds of the read latency histogram buckets, in milliseconds
+std::array<long long, 4> const streammeter::LATENCY_BUCKETS = {{ 1, 10, 100, 1000 }};
+
+// streammeter::PUBLISH_INTERVAL (static)
+//
+// Interval at which the stream telemetry is published
+std::chrono::milliseconds const streammeter::PUBLISH_INTERVAL(1000);
+
+// streammeter::STALL_THRESHOLD (static)
+//
+// Read latency at which the stream is considered to have stalled
+std::chrono::milliseconds const streammeter::STALL_THRESHOLD(500);
+
+//---------------------------------------------------------------------------
+// streammeter Constructor (private)
+//
+// Arguments:
+//
+//	basestream	- Underlying stream instance
+//	opened		- Time at which the stream was requested
+//	publisher	- Function used to publish the stream telemetry
+
+streammeter::streammeter(std::unique_ptr<pvrstream> basestream, std::chrono::steady_clock::time_point opened, publisher_t publisher) : 
+	m_basestream(std::move(basestream)), m_publisher(std::move(publisher)), m_opened(opened), 
+	m_openms(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - opened).count()),
+	m_published(std::chrono::steady_clock::now()), m_meter(std::chrono::seconds(1))
+{
+	assert(m_basestream);
+}
+
+//---------------------------------------------------------------------------
+// streammeter Destructor
+
+streammeter::~streammeter()
+{
+	// Publish the final telemetry for the stream; the underlying stream has to still be open
+	try { publish(); }
+	catch(...) { /* DO NOTHING */ }
+
+	close();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* streammeter::acquire(size_t count, size_t* available)
+{
+	using namespace std::chrono;
+
+	assert(m_basestream);
+
+	// Time how long it takes the underlying stream to produce the data
+	steady_clock::time_point start = steady_clock::now();
+	uint8_t* data = m_basestream->acquire(count, available);
+	steady_clock::time_point now = steady_clock::now();
+
+	milliseconds latency = duration_cast<milliseconds>(now - start);
+
+	// Place the read operation into the appropriate latency histogram bucket
+	size_t bucket = 0;
+	while((bucket < LATENCY_BUCKETS.size()) && (latency.count() >= LATENCY_BUCKETS[bucket])) bucket++;
+	m_latency[bucket]++;
+
+	m_reads++;
+	if(latency >= STALL_THRESHOLD) m_stalls++;
+
+	if((available == nullptr) || (*available == 0)) m_emptyreads++;
+	else if(m_firstpacketms < 0) m_firstpacketms = duration_cast<milliseconds>(now - m_opened).count();
+
+	return data;
+}
+
+//---------------------------------------------------------------------------
+// streammeter::bytespersecond
+//
+// Gets the measured rate at which the stream is being consumed
+//
+// Arguments:
+//
+//	NONE
+
+uint64_t streammeter::bytespersecond(void) const
+{
+	return m_meter.bytespersecond();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::canseek
+//
+// Gets a flag indicating if the stream allows seek operations
+//
+// Arguments:
+//
+//	NONE
+
+bool streammeter::canseek(void) const
+{
+	assert(m_basestream);
+	return m_basestream->canseek();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::close
+//
+// Closes the stream
+//
+// Arguments:
+//
+//	NONE
+
+void streammeter::close(void)
+{
+	assert(m_basestream);
+	m_basestream->close();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::create (static)
+//
+// Factory method, creates a new streammeter instance
+//
+// Arguments:
+//
+//	basestream	- Underlying stream instance
+//	opened		- Time at which the stream was requested
+//	publisher	- Function used to publish the stream telemetry
+
+std::unique_ptr<streammeter> streammeter::create(std::unique_ptr<pvrstream> basestream, std::chrono::steady_clock::time_point opened, 
+	publisher_t publisher)
+{
+	return std::unique_ptr<streammeter>(new streammeter(std::move(basestream), opened, std::move(publisher)));
+}
+
+//---------------------------------------------------------------------------
+// streammeter::length
+//
+// Gets the length of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long streammeter::length(void) const
+{
+	assert(m_basestream);
+	return m_basestream->length();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::mediatype
+//
+// Gets the media type of the stream
+//
+// Arguments:
+//
+//	NONE
+
+char const* streammeter::mediatype(void) const
+{
+	assert(m_basestream);
+	return m_basestream->mediatype();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long streammeter::minposition(void) const
+{
+	assert(m_basestream);
+	return m_basestream->minposition();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long streammeter::position(void) const
+{
+	assert(m_basestream);
+	return m_basestream->position();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::publish (private)
+//
+// Publishes the current stream telemetry
+//
+// Arguments:
+//
+//	NONE
+
+void streammeter::publish(void)
+{
+	telemetry_t			values;			// Stream telemetry values
+
+	m_published = std::chrono::steady_clock::now();
+	if(!m_publisher) return;
+
+	telemetry(values);
+	m_publisher(values);
+}
+
+//---------------------------------------------------------------------------
+// streammeter::read
+//
+// Reads available data from the stream
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t streammeter::read(uint8_t* buffer, size_t count)
+{
+	size_t			available = 0;			// Available bytes to read
+
+	assert(buffer != nullptr);
+
+	uint8_t* data = acquire(count, &available);
+	if(available > 0) memcpy(buffer, data, available);
+
+	release(available);
+	return available;
+}
+
+//---------------------------------------------------------------------------
+// streammeter::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool streammeter::realtime(void) const
+{
+	assert(m_basestream);
+	return m_basestream->realtime();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
+
+void streammeter::release(size_t count)
+{
+	assert(m_basestream);
+
+	m_basestream->release(count);
+
+	m_bytes += static_cast<long long>(count);
+	m_meter.add(count);
+	m_meter.sample();
+
+	// Periodically publish the telemetry; this is done on the thread consuming the stream
+	// so none of the underlying stream implementations have to synchronize with the publisher
+	if((std::chrono::steady_clock::now() - m_published) >= PUBLISH_INTERVAL) publish();
+}
+
+//---------------------------------------------------------------------------
+// streammeter::seek
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long streammeter::seek(long long position, int whence)
+{
+	assert(m_basestream);
+
+	m_seeks++;
+	return m_basestream->seek(position, whence);
+}
+
+//---------------------------------------------------------------------------
+// streammeter::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void streammeter::telemetry(telemetry_t& values) const
+{
+	using namespace std::chrono;
+
+	assert(m_basestream);
+
+	// The average throughput is measured from the first packet, the time spent opening the stream is reported separately
+	long long elapsed = duration_cast<milliseconds>(steady_clock::now() - m_opened).count();
+	long long streaming = (m_firstpacketms >= 0) ? elapsed - m_firstpacketms : 0;
+
+	values.emplace_back("streammeter.open_ms", m_openms);
+	values.emplace_back("streammeter.first_packet_ms", m_firstpacketms);
+	values.emplace_back("streammeter.elapsed_ms", elapsed);
+	values.emplace_back("streammeter.bytes", m_bytes);
+	values.emplace_back("streammeter.bytes_per_second", static_cast<long long>(m_meter.bytespersecond()));
+	values.emplace_back("streammeter.average_bytes_per_second", (streaming > 0) ? (m_bytes * 1000) / streaming : 0);
+	values.emplace_back("streammeter.reads", m_reads);
+	values.emplace_back("streammeter.empty_reads", m_emptyreads);
+	values.emplace_back("streammeter.stalls", m_stalls);
+	values.emplace_back("streammeter.seeks", m_seeks);
+
+	for(size_t index = 0; index < LATENCY_BUCKETS.size(); index++)
+		values.emplace_back("streammeter.reads_under_" + std::to_string(LATENCY_BUCKETS[index]) + "ms", m_latency[index]);
+	values.emplace_back("streammeter.reads_over_" + std::to_string(LATENCY_BUCKETS.back()) + "ms", m_latency.back());
+
+	m_basestream->telemetry(values);
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,184 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __STREAMMETER_H_
+#define __STREAMMETER_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "bitratemeter.h"
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class streammeter
+//
+// Implements a pvrstream decorator that measures how the stream is being
+// consumed and periodically publishes the telemetry of the entire stream
+
+class streammeter : public pvrstream
+{
+public:
+
+	// publisher_t
+	//
+	// Function used to publish the stream telemetry values
+	using publisher_t = std::function<void(telemetry_t const& values)>;
+
+	// Destructor
+	//
+	virtual ~streammeter();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
+	// bytespersecond
+	//
+	// Gets the measured rate at which the stream is being consumed
+	uint64_t bytespersecond(void) const;
+
+	// canseek
+	//
+	// Flag indicating if the stream allows seek operations
+	bool canseek(void) const;
+
+	// close
+	//
+	// Closes the stream
+	void close(void);
+
+	// create (static)
+	//
+	// Factory method, creates a new streammeter instance
+	static std::unique_ptr<streammeter> create(std::unique_ptr<pvrstream> basestream, std::chrono::steady_clock::time_point opened, 
+		publisher_t publisher);
+
+	// length
+	//
+	// Gets the length of the stream
+	long long length(void) const;
+
+	// mediatype
+	//
+	// Gets the media type of the stream
+	char const* mediatype(void) const;
+
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
+	// position
+	//
+	// Gets the current position of the stream
+	long long position(void) const;
+
+	// read
+	//
+	// Reads available data from the stream
+	size_t read(uint8_t* buffer, size_t count);
+
+	// realtime
+	//
+	// Gets a flag indicating if the stream is real-time
+	bool realtime(void) const;
+
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
+	// seek
+	//
+	// Sets the stream pointer to a specific position
+	long long seek(long long position, int whence);
+
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
+private:
+
+	streammeter(streammeter const&) = delete;
+	streammeter& operator=(streammeter const&) = delete;
+
+	// LATENCY_BUCKETS
+	//
+	// Upper bounds of the read latency histogram buckets, in milliseconds
+	static std::array<long long, 4> const LATENCY_BUCKETS;
+
+	// PUBLISH_INTERVAL
+	//
+	// Interval at which the stream telemetry is published
+	static std::chrono::milliseconds const PUBLISH_INTERVAL;
+
+	// STALL_THRESHOLD
+	//
+	// Read latency at which the stream is considered to have stalled
+	static std::chrono::milliseconds const STALL_THRESHOLD;
+
+	// Instance Constructor
+	//
+	streammeter(std::unique_ptr<pvrstream> basestream, std::chrono::steady_clock::time_point opened, publisher_t publisher);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// publish
+	//
+	// Publishes the current stream telemetry
+	void publish(void);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	std::unique_ptr<pvrstream> const	m_basestream;			// Underlying stream instance
+	publisher_t const					m_publisher;			// Telemetry publisher
+	std::chrono::steady_clock::time_point const m_opened;		// Time the stream was requested
+	long long const						m_openms;				// Time required to open the stream
+	std::chrono::steady_clock::time_point m_published;			// Time of the last publish
+	long long							m_firstpacketms = -1;	// Time required to receive data
+	bitratemeter						m_meter;				// Outgoing bitrate meter
+	long long							m_bytes = 0;			// Total bytes consumed
+	long long							m_reads = 0;			// Number of read operations
+	long long							m_emptyreads = 0;		// Number of empty read operations
+	long long							m_stalls = 0;			// Number of stalled read operations
+	long long							m_seeks = 0;			// Number of seek operations
+	std::array<long long, 5>			m_latency{};			// Read latency histogram
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __STREAMMETER_H_
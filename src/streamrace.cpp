@@ -0,0 +1,218 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "streamrace.h"
+
+#pragma warning(push, 4)
+
+// streamrace::ATTEMPT_DELAY (static)
+//
+// Delay between starting each of the candidate stream attempts
+std::chrono::milliseconds const streamrace::ATTEMPT_DELAY(250);
+
+// streamrace::MPEGTS_PACKET_LENGTH (static)
+//
+// Length of a single mpeg-ts data packet
+size_t const streamrace::MPEGTS_PACKET_LENGTH = 188;
+
+// streamrace::VALIDATION_TIMEOUT (static)
+//
+// Amount of time a candidate stream has to deliver valid packets
+std::chrono::milliseconds const streamrace::VALIDATION_TIMEOUT(5000);
+
+//---------------------------------------------------------------------------
+// streamrace Constructor (private)
+//
+// Arguments:
+//
+//	openers		- Functions used to open the candidate streams, in order of preference
+
+streamrace::streamrace(std::vector<opener_t> const& openers) : m_started(std::chrono::steady_clock::now())
+{
+	try {
+
+		// Each candidate attempt gets its own thread; the attempts themselves enforce the
+		// stagger so that the more preferred candidates are given a head start
+		for(size_t index = 0; index < openers.size(); index++)
+			m_attempts.emplace_back(&streamrace::attempt, this, index, openers[index]);
+	}
+
+	// If a thread could not be created, cancel and wait for any that were before rethrowing
+	catch(...) {
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_cancel = true;
+		m_cv.notify_all();
+		lock.unlock();
+
+		for(auto& thread : m_attempts) thread.join();
+		throw;
+	}
+}
+
+//---------------------------------------------------------------------------
+// streamrace Destructor
+
+streamrace::~streamrace()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_cancel = true;
+	m_cv.notify_all();
+	lock.unlock();
+
+	// Losing attempts close their own streams, this only has to wait for any that
+	// are still blocked opening a connection to complete
+	for(auto& thread : m_attempts) if(thread.joinable()) thread.join();
+}
+
+//---------------------------------------------------------------------------
+// streamrace::attempt (private)
+//
+// Executes a single candidate stream attempt
+//
+// Arguments:
+//
+//	index		- Index of the candidate, in order of preference
+//	opener		- Function used to open the candidate stream
+
+void streamrace::attempt(size_t index, opener_t const& opener)
+{
+	std::unique_ptr<pvrstream> stream;			// Candidate stream instance
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// Wait for this candidate's turn to start; that occurs when the stagger delay has elapsed
+	// or as soon as enough of the attempts ahead of it have failed, whichever happens first
+	m_cv.wait_until(lock, m_started + (ATTEMPT_DELAY * index), [&]() -> bool { return finished(lock) || (m_failed >= index); });
+	if(finished(lock)) return;
+
+	lock.unlock();
+
+	// Open the candidate stream and wait for it to deliver valid packets, any exception
+	// thrown just means this particular candidate has failed
+	try { stream = opener(); if((stream) && (!validate(stream.get()))) stream.reset(); }
+	catch(...) { stream.reset(); }
+
+	lock.lock();
+
+	// The first valid stream wins the race, all others are counted as having failed
+	if((stream) && (!finished(lock))) m_winner = std::move(stream);
+	else m_failed++;
+
+	m_cv.notify_all();
+	lock.unlock();
+
+	// A losing stream is closed here, outside of the lock
+	stream.reset();
+}
+
+//---------------------------------------------------------------------------
+// streamrace::create (static)
+//
+// Factory method, creates a new streamrace instance
+//
+// Arguments:
+//
+//	openers		- Functions used to open the candidate streams, in order of preference
+
+std::unique_ptr<streamrace> streamrace::create(std::vector<opener_t> const& openers)
+{
+	return std::unique_ptr<streamrace>(new streamrace(openers));
+}
+
+//---------------------------------------------------------------------------
+// streamrace::finished (private)
+//
+// Determines if the race has been won or cancelled
+//
+// Arguments:
+//
+//	lock		- Reference to unique_lock<> that must be owned
+
+bool streamrace::finished(std::unique_lock<std::mutex> const& lock) const
+{
+	assert(lock.owns_lock());
+	if(!lock.owns_lock()) throw std::invalid_argument("lock");
+
+	return ((m_cancel) || (m_winner));
+}
+
+//---------------------------------------------------------------------------
+// streamrace::validate (private)
+//
+// Waits for a candidate stream to deliver valid packets
+//
+// Arguments:
+//
+//	stream		- Candidate stream instance
+
+bool streamrace::validate(pvrstream* stream)
+{
+	size_t			available = 0;			// Available stream data
+	uint8_t*		data = nullptr;			// Pointer to the stream data
+
+	assert(stream != nullptr);
+
+	auto const deadline = std::chrono::steady_clock::now() + VALIDATION_TIMEOUT;
+
+	// Acquire the first two packets from the stream without releasing them, the stream
+	// remains positioned at the start of the data for the winning candidate
+	while(available < (MPEGTS_PACKET_LENGTH * 2)) {
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		if(finished(lock) || (std::chrono::steady_clock::now() > deadline)) return false;
+		lock.unlock();
+
+		data = stream->acquire(MPEGTS_PACKET_LENGTH * 2, &available);
+		if(available < (MPEGTS_PACKET_LENGTH * 2)) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	// Both packets must start with the sync byte to be considered valid
+	return ((data != nullptr) && (data[0] == 0x47) && (data[MPEGTS_PACKET_LENGTH] == 0x47));
+}
+
+//---------------------------------------------------------------------------
+// streamrace::wait
+//
+// Waits for the first valid stream, or for all of the candidates to fail
+//
+// Arguments:
+//
+//	NONE
+
+std::unique_ptr<pvrstream> streamrace::wait(void)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	m_cv.wait(lock, [&]() -> bool { return finished(lock) || (m_failed == m_attempts.size()); });
+
+	// Cancel all of the remaining attempts and take ownership of the winning stream, if any
+	m_cancel = true;
+	m_cv.notify_all();
+
+	return std::move(m_winner);
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
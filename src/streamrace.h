@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __STREAMRACE_H_
+#define __STREAMRACE_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class streamrace
+//
+// Opens a set of candidate streams concurrently with a short stagger between
+// the attempts and selects the first one that delivers valid MPEG-TS packets
+
+class streamrace
+{
+public:
+
+	// opener_t
+	//
+	// Function used to open a candidate stream on a background thread
+	using opener_t = std::function<std::unique_ptr<pvrstream>(void)>;
+
+	// Destructor
+	//
+	~streamrace();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// create (static)
+	//
+	// Factory method, creates a new streamrace instance
+	static std::unique_ptr<streamrace> create(std::vector<opener_t> const& openers);
+
+	// wait
+	//
+	// Waits for the first valid stream, or for all of the candidates to fail
+	std::unique_ptr<pvrstream> wait(void);
+
+private:
+
+	streamrace(streamrace const&) = delete;
+	streamrace& operator=(streamrace const&) = delete;
+
+	// ATTEMPT_DELAY
+	//
+	// Delay between starting each of the candidate stream attempts
+	static std::chrono::milliseconds const ATTEMPT_DELAY;
+
+	// MPEGTS_PACKET_LENGTH
+	//
+	// Length of a single mpeg-ts data packet
+	static size_t const MPEGTS_PACKET_LENGTH;
+
+	// VALIDATION_TIMEOUT
+	//
+	// Amount of time a candidate stream has to deliver valid packets
+	static std::chrono::milliseconds const VALIDATION_TIMEOUT;
+
+	// Instance Constructor
+	//
+	streamrace(std::vector<opener_t> const& openers);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// attempt
+	//
+	// Executes a single candidate stream attempt
+	void attempt(size_t index, opener_t const& opener);
+
+	// finished
+	//
+	// Determines if the race has been won or cancelled
+	bool finished(std::unique_lock<std::mutex> const& lock) const;
+
+	// validate
+	//
+	// Waits for a candidate stream to deliver valid packets
+	bool validate(pvrstream* stream);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	std::chrono::steady_clock::time_point const	m_started;		// Time the race started
+	std::vector<std::thread>			m_attempts;				// Candidate attempt threads
+	mutable std::mutex					m_lock;					// Synchronization object
+	std::condition_variable				m_cv;					// Attempt state condition
+	bool								m_cancel = false;		// Flag to cancel the attempts
+	size_t								m_failed = 0;			// Number of failed attempts
+	std::unique_ptr<pvrstream>			m_winner;				// The first valid stream
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __STREAMRACE_H_
@@ -0,0 +1,187 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "streamreaper.h"
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// streamreaper Constructor (private)
+//
+// Arguments:
+//
+//	NONE
+
+streamreaper::streamreaper()
+{
+	m_worker = std::thread(&streamreaper::reap, this);
+}
+
+//---------------------------------------------------------------------------
+// streamreaper Destructor
+
+streamreaper::~streamreaper()
+{
+	// The worker thread drains the queue before it stops; every retired stream
+	// must be destroyed before this returns so that all tuners are released
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_stop = true;
+	m_cv.notify_all();
+	lock.unlock();
+
+	if(m_worker.joinable()) m_worker.join();
+}
+
+//---------------------------------------------------------------------------
+// streamreaper::create (static)
+//
+// Factory method, creates a new streamreaper instance
+//
+// Arguments:
+//
+//	NONE
+
+std::unique_ptr<streamreaper> streamreaper::create(void)
+{
+	return std::unique_ptr<streamreaper>(new streamreaper());
+}
+
+//---------------------------------------------------------------------------
+// streamreaper::enqueue (private)
+//
+// Adds a retired object instance to the queue
+//
+// Arguments:
+//
+//	object		- Object instance to be destroyed
+
+void streamreaper::enqueue(std::shared_ptr<void> object)
+{
+	if(!object) return;
+
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_queue.emplace_back(std::move(object));
+	m_cv.notify_all();
+}
+
+//---------------------------------------------------------------------------
+// streamreaper::reap (private)
+//
+// Background worker thread procedure
+//
+// Arguments:
+//
+//	NONE
+
+void streamreaper::reap(void)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	while(true) {
+
+		m_cv.wait(lock, [&]() -> bool { return m_stop || !m_queue.empty(); });
+		if(m_queue.empty()) break;			// Only stop after the queue has drained
+
+		std::shared_ptr<void> object = std::move(m_queue.front());
+		m_queue.pop_front();
+		m_busy = true;
+
+		// Destroy the object outside of the lock; this is the part that can take a while
+		// as it waits for the transfer threads to stop and the tuner(s) to be released
+		lock.unlock();
+		try { object.reset(); }
+		catch(...) { /* DO NOTHING */ }
+		lock.lock();
+
+		m_busy = false;
+		m_cv.notify_all();
+	}
+}
+
+//---------------------------------------------------------------------------
+// streamreaper::retire
+//
+// Hands a pretuner over to be destroyed in the background; this waits for the
+// pretuner to finish opening its stream if that is still in progress
+//
+// Arguments:
+//
+//	pretuned	- Pretuner instance to be destroyed
+
+void streamreaper::retire(std::unique_ptr<pretuner> pretuned)
+{
+	enqueue(std::move(pretuned));
+}
+
+//---------------------------------------------------------------------------
+// streamreaper::retire
+//
+// Hands a stream instance over to be destroyed in the background
+//
+// Arguments:
+//
+//	stream		- Stream instance to be destroyed
+
+void streamreaper::retire(std::unique_ptr<pvrstream> stream)
+{
+	enqueue(std::move(stream));
+}
+
+//---------------------------------------------------------------------------
+// streamreaper::retire
+//
+// Hands a stream race over to be destroyed in the background; this waits for
+// any candidate attempts that are still blocked opening their streams
+//
+// Arguments:
+//
+//	race		- Stream race instance to be destroyed
+
+void streamreaper::retire(std::unique_ptr<streamrace> race)
+{
+	enqueue(std::move(race));
+}
+
+//---------------------------------------------------------------------------
+// streamreaper::wait
+//
+// Waits until all of the retired stream instances have been destroyed; returns
+// true if there were any stream instances that had not yet been destroyed
+//
+// Arguments:
+//
+//	NONE
+
+bool streamreaper::wait(void)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	bool pending = (m_busy || !m_queue.empty());
+	m_cv.wait(lock, [&]() -> bool { return !m_busy && m_queue.empty(); });
+
+	return pending;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,119 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __STREAMREAPER_H_
+#define __STREAMREAPER_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "pretuner.h"
+#include "pvrstream.h"
+#include "streamrace.h"
+
+//---------------------------------------------------------------------------
+// Class streamreaper
+//
+// Destroys retired stream instances on a background thread so that closing a
+// stream does not block the caller while the connections and tuners are released;
+// anything else that owns streams, like an abandoned stream race or pretuner, can be retired too
+
+class streamreaper
+{
+public:
+
+	// Destructor
+	//
+	~streamreaper();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// create (static)
+	//
+	// Factory method, creates a new streamreaper instance
+	static std::unique_ptr<streamreaper> create(void);
+
+	// retire
+	//
+	// Hands a pretuner over to be destroyed in the background
+	void retire(std::unique_ptr<pretuner> pretuned);
+
+	// retire
+	//
+	// Hands a stream instance over to be destroyed in the background
+	void retire(std::unique_ptr<pvrstream> stream);
+
+	// retire
+	//
+	// Hands a stream race over to be destroyed in the background
+	void retire(std::unique_ptr<streamrace> race);
+
+	// wait
+	//
+	// Waits until all of the retired stream instances have been destroyed
+	bool wait(void);
+
+private:
+
+	streamreaper(streamreaper const&) = delete;
+	streamreaper& operator=(streamreaper const&) = delete;
+
+	// Instance Constructor
+	//
+	streamreaper();
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// enqueue
+	//
+	// Adds a retired object instance to the queue
+	void enqueue(std::shared_ptr<void> object);
+
+	// reap
+	//
+	// Background worker thread procedure
+	void reap(void);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	std::thread								m_worker;				// Background worker thread
+	bool									m_stop = false;			// Flag to stop the worker thread
+	bool									m_busy = false;			// Flag if a stream is being destroyed
+	std::mutex								m_lock;					// Synchronization object
+	std::condition_variable					m_cv;					// Queue condition variable
+	std::deque<std::shared_ptr<void>>		m_queue;				// Retired object instances
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __STREAMREAPER_H_
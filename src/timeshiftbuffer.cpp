@@ -0,0 +1,570 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "timeshiftbuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+#if !defined(_WINDOWS) && !defined(WINAPI_FAMILY)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "align.h"
+#include "string_exception.h"
+
+#pragma warning(push, 4)
+
+// timeshiftbuffer::MAXIMUM_WAIT_TIME (static)
+//
+// The maximum amount of time to wait for stream data
+unsigned int const timeshiftbuffer::MAXIMUM_WAIT_TIME = 1000;
+
+// timeshiftbuffer::MPEGTS_PACKET_LENGTH (static)
+//
+// Length of a single mpeg-ts data packet
+size_t const timeshiftbuffer::MPEGTS_PACKET_LENGTH = 188;
+
+// timeshiftbuffer::SPOOL_CHUNK_SIZE (static)
+//
+// Maximum amount of data to read from the base stream at once
+size_t const timeshiftbuffer::SPOOL_CHUNK_SIZE = (MPEGTS_PACKET_LENGTH * 256);
+
+// timeshiftbuffer::SPOOL_RETRY_INTERVAL (static)
+//
+// Amount of time to wait after a zero-length read from the base stream
+unsigned int const timeshiftbuffer::SPOOL_RETRY_INTERVAL = 100;
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer Constructor (private)
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+//	path			- Path to the circular file to create
+//	buffersize		- Size of the circular file, in bytes
+
+timeshiftbuffer::timeshiftbuffer(std::unique_ptr<pvrstream> basestream, char const* path, size_t buffersize) : 
+	m_basestream(std::move(basestream)), m_mediatype(m_basestream->mediatype()), 
+	m_buffersize(align::down(buffersize, static_cast<unsigned int>(MPEGTS_PACKET_LENGTH)))
+{
+	assert(m_basestream);
+	assert(path != nullptr);
+
+	if((path == nullptr) || (*path == '\0')) throw std::invalid_argument("path");
+	if(m_buffersize == 0) throw std::invalid_argument("buffersize");
+
+	map_file(path);					// Create and map the circular file
+
+	try {
+
+		// The spool worker is the only thing that reads from the base stream or writes into the
+		// circular file; it runs until the stream is closed or the base stream throws an exception
+		m_worker = std::thread([&]() -> void {
+
+			try {
+
+				while(true) {
+
+					// Check for a stop signal before blocking on the base stream
+					{ std::unique_lock<std::mutex> lock(m_lock); if(m_stop) break; }
+
+					// Acquire the data from the base stream so that it only needs to be copied into the circular file
+					size_t read = 0;
+					uint8_t* chunk = m_basestream->acquire(SPOOL_CHUNK_SIZE, &read);
+
+					std::unique_lock<std::mutex> lock(m_lock);
+
+					// If no data was available from the base stream, back off for a short time before trying again
+					if(read == 0) { m_cv.wait_for(lock, std::chrono::milliseconds(SPOOL_RETRY_INTERVAL), [&]() -> bool { return m_stop; }); continue; }
+
+					// Acquired data cannot be overwritten until it has been released by the reader
+					m_cv.wait(lock, [&]() -> bool { return (m_stop) || (m_acquired == 0) || 
+						((m_writepos + static_cast<long long>(read) - static_cast<long long>(m_buffersize)) <= m_readpos); });
+					if(m_stop) break;
+
+					// Write the data into the circular file, release it, and wake up any waiting reader
+					copy_to(m_writepos, chunk, read);
+					m_basestream->release(read);
+					m_writepos += read;
+					m_cv.notify_all();
+				}
+			}
+
+			catch(...) { std::unique_lock<std::mutex> lock(m_lock); m_exception = std::current_exception(); }
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_finished = true;
+			m_cv.notify_all();
+		});
+	}
+
+	catch(...) { unmap_file(); throw; }
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer Destructor
+
+timeshiftbuffer::~timeshiftbuffer()
+{
+	close();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* timeshiftbuffer::acquire(size_t count, size_t* available)
+{
+	assert(available != nullptr);
+	if(available == nullptr) throw std::invalid_argument("available");
+	*available = 0;
+
+	if(count == 0) return nullptr;
+
+	std::unique_lock<std::mutex> lock(m_lock);
+	if(m_buffer == nullptr) throw string_exception(__func__, ": stream has been closed");
+
+	// Wait for the spool worker to write data beyond the current read position
+	m_cv.wait_for(lock, std::chrono::milliseconds(MAXIMUM_WAIT_TIME), [&]() -> bool { return (m_writepos > m_readpos) || m_finished; });
+
+	// If the reader has fallen behind the writer, the oldest data has been overwritten; skip ahead
+	long long minpos = minimum_position();
+	if(m_readpos < minpos) m_readpos = minpos;
+
+	// If all available data has been read and the spool worker failed, propagate the exception
+	size_t readable = static_cast<size_t>(m_writepos - m_readpos);
+	if((readable == 0) && (m_exception)) std::rethrow_exception(m_exception);
+
+	// Only the data up to the end of the circular file is contiguous; the circular file is
+	// aligned to MPEGTS_PACKET_LENGTH so this will never split a packet
+	size_t offset = static_cast<size_t>(m_readpos % static_cast<long long>(m_buffersize));
+	m_acquired = std::min(std::min(count, readable), m_buffersize - offset);
+
+	// The spool worker will not overwrite the acquired data until it has been released
+	*available = m_acquired;
+	return (m_acquired > 0) ? &m_buffer[offset] : nullptr;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::canseek
+//
+// Gets a flag indicating if the stream allows seek operations
+//
+// Arguments:
+//
+//	NONE
+
+bool timeshiftbuffer::canseek(void) const
+{
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::close
+//
+// Closes the stream
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftbuffer::close(void)
+{
+	assert(m_basestream);
+
+	// Signal the spool worker to stop and wait for it to do so; it may be blocked in
+	// the base stream read operation so this may not happen immediately
+	if(m_worker.joinable()) {
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_stop = true;
+		m_cv.notify_all();
+		lock.unlock();
+
+		m_worker.join();
+	}
+
+	m_basestream->close();			// Close the underlying stream
+	unmap_file();					// Release the circular file
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::copy_to (private)
+//
+// Copies data into the circular file at the specified stream position
+//
+// Arguments:
+//
+//	position	- Stream position at which to copy the data
+//	buffer		- Source buffer
+//	count		- Number of bytes to copy into the circular file
+
+void timeshiftbuffer::copy_to(long long position, uint8_t const* buffer, size_t count)
+{
+	assert(m_buffer != nullptr);
+	assert((position >= 0) && (count <= m_buffersize));
+
+	size_t offset = static_cast<size_t>(position % static_cast<long long>(m_buffersize));
+	size_t first = std::min(count, m_buffersize - offset);
+
+	memcpy(&m_buffer[offset], buffer, first);
+	if(first < count) memcpy(&m_buffer[0], &buffer[first], count - first);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::create (static)
+//
+// Factory method, creates a new timeshiftbuffer instance
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+//	path			- Path to the circular file to create
+//	buffersize		- Size of the circular file, in bytes
+
+std::unique_ptr<timeshiftbuffer> timeshiftbuffer::create(std::unique_ptr<pvrstream> basestream, char const* path, size_t buffersize)
+{
+	return std::unique_ptr<timeshiftbuffer>(new timeshiftbuffer(std::move(basestream), path, buffersize));
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::length
+//
+// Gets the length of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long timeshiftbuffer::length(void) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	return m_writepos;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::map_file (private)
+//
+// Creates and maps the backing circular file into memory
+//
+// Arguments:
+//
+//	path		- Path to the circular file to create
+
+void timeshiftbuffer::map_file(char const* path)
+{
+	assert(path != nullptr);
+	assert(m_buffer == nullptr);
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+
+	// Convert the path into a wide character string for the Windows API
+	int pathlen = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	if(pathlen <= 0) throw string_exception(__func__, ": unable to convert timeshift buffer file path: ", GetLastError());
+
+	std::unique_ptr<wchar_t[]> widepath(new wchar_t[pathlen]);
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, widepath.get(), pathlen);
+
+	// The circular file is a temporary file that is automatically deleted when the handle is closed
+	CREATEFILE2_EXTENDED_PARAMETERS params = {};
+	params.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+	params.dwFileAttributes = FILE_ATTRIBUTE_TEMPORARY;
+	params.dwFileFlags = FILE_FLAG_DELETE_ON_CLOSE;
+
+	m_file = CreateFile2(widepath.get(), GENERIC_READ | GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, &params);
+	if(m_file == INVALID_HANDLE_VALUE) throw string_exception(__func__, ": unable to create timeshift buffer file: ", GetLastError());
+
+	try {
+
+		ULARGE_INTEGER size;
+		size.QuadPart = m_buffersize;
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, size.HighPart, size.LowPart, nullptr);
+#else
+		m_mapping = CreateFileMappingFromApp(m_file, nullptr, PAGE_READWRITE, size.QuadPart, nullptr);
+#endif
+		if(m_mapping == nullptr) throw string_exception(__func__, ": unable to map timeshift buffer file: ", GetLastError());
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+		m_buffer = reinterpret_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, m_buffersize));
+#else
+		m_buffer = reinterpret_cast<uint8_t*>(MapViewOfFileFromApp(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, m_buffersize));
+#endif
+		if(m_buffer == nullptr) throw string_exception(__func__, ": unable to map timeshift buffer file view: ", GetLastError());
+	}
+
+	catch(...) { unmap_file(); throw; }
+
+#else
+
+	// The circular file is unlinked as soon as it's been created, the storage is
+	// released automatically when the descriptor is closed or the process exits
+	m_file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if(m_file < 0) throw string_exception(__func__, ": unable to create timeshift buffer file: ", strerror(errno));
+	unlink(path);
+
+	try {
+
+		if(ftruncate(m_file, static_cast<off_t>(m_buffersize)) != 0) 
+			throw string_exception(__func__, ": unable to set timeshift buffer file size: ", strerror(errno));
+
+		void* view = mmap(nullptr, m_buffersize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+		if(view == MAP_FAILED) throw string_exception(__func__, ": unable to map timeshift buffer file: ", strerror(errno));
+
+		m_buffer = reinterpret_cast<uint8_t*>(view);
+	}
+
+	catch(...) { unmap_file(); throw; }
+
+#endif
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::mediatype
+//
+// Gets the media type of the stream
+//
+// Arguments:
+//
+//	NONE
+
+char const* timeshiftbuffer::mediatype(void) const
+{
+	return m_mediatype.c_str();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::minimum_position (private)
+//
+// Calculates the minimum readable position; requires the lock be held
+//
+// Arguments:
+//
+//	NONE
+
+long long timeshiftbuffer::minimum_position(void) const
+{
+	long long const buffersize = static_cast<long long>(m_buffersize);
+
+	// The oldest data in the circular file is overwritten first, align up to the first whole packet
+	return (m_writepos > buffersize) ? align::up(m_writepos - buffersize, static_cast<int>(MPEGTS_PACKET_LENGTH)) : 0;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long timeshiftbuffer::minposition(void) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	return minimum_position();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long timeshiftbuffer::position(void) const
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	return m_readpos;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::read
+//
+// Reads data from the circular file
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the live stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t timeshiftbuffer::read(uint8_t* buffer, size_t count)
+{
+	size_t				available = 0;			// Available bytes to read
+
+	assert(buffer != nullptr);
+
+	// Acquire a contiguous region of the circular file and copy it into the destination buffer
+	uint8_t* data = acquire(count, &available);
+	if(available > 0) memcpy(buffer, data, available);
+
+	release(available);
+	return available;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool timeshiftbuffer::realtime(void) const
+{
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
+
+void timeshiftbuffer::release(size_t count)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// Data acquired before a seek has already been given up by the seek, there is nothing to release
+	assert((m_acquired == 0) || (count <= m_acquired));
+	m_readpos += std::min(count, m_acquired);
+	m_acquired = 0;
+
+	// Wake up the spool worker if it's waiting on the acquired data to be released
+	m_cv.notify_all();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::seek
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long timeshiftbuffer::seek(long long position, int whence)
+{
+	long long			newposition = 0;			// New stream position
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// Calculate the new position of the stream
+	if(whence == SEEK_SET) newposition = position;
+	else if(whence == SEEK_CUR) newposition = m_readpos + position;
+	else if(whence == SEEK_END) newposition = m_writepos + position;
+	else throw std::invalid_argument("whence");
+
+	// The new position is constrained to the data currently held in the circular file and
+	// is aligned to an MPEG-TS packet boundary
+	newposition = std::min(std::max(newposition, minimum_position()), m_writepos);
+	m_readpos = align::down(newposition, static_cast<int>(MPEGTS_PACKET_LENGTH));
+
+	// Any outstanding acquired data refers to the old position; give it up so that it doesn't move the read
+	// position once released, and wake up the spool worker if it's waiting on that data to be released
+	m_acquired = 0;
+	m_cv.notify_all();
+
+	return m_readpos;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void timeshiftbuffer::telemetry(telemetry_t& values) const
+{
+	assert(m_basestream);
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	values.emplace_back("timeshiftbuffer.buffer_size", static_cast<long long>(m_buffersize));
+	values.emplace_back("timeshiftbuffer.buffer_used", m_writepos - minimum_position());
+	values.emplace_back("timeshiftbuffer.live_distance", m_writepos - m_readpos);
+
+	lock.unlock();
+
+	m_basestream->telemetry(values);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::unmap_file (private)
+//
+// Unmaps and releases the backing circular file
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftbuffer::unmap_file(void)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+
+	if(m_buffer != nullptr) UnmapViewOfFile(m_buffer);
+	if(m_mapping != nullptr) CloseHandle(m_mapping);
+	if(m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+
+	m_mapping = nullptr;
+	m_file = INVALID_HANDLE_VALUE;
+
+#else
+
+	if(m_buffer != nullptr) munmap(m_buffer, m_buffersize);
+	if(m_file >= 0) ::close(m_file);
+
+	m_file = -1;
+
+#endif
+
+	m_buffer = nullptr;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
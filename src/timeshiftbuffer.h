@@ -0,0 +1,208 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __TIMESHIFTBUFFER_H_
+#define __TIMESHIFTBUFFER_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class timeshiftbuffer
+//
+// Implements a pvrstream wrapper that spools a real-time MPEG-TS stream into a
+// bounded memory-mapped circular file to allow for pause and rewind operations
+
+class timeshiftbuffer : public pvrstream
+{
+public:
+
+	// Destructor
+	//
+	virtual ~timeshiftbuffer();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
+	// canseek
+	//
+	// Flag indicating if the stream allows seek operations
+	bool canseek(void) const;
+
+	// close
+	//
+	// Closes the stream
+	void close(void);
+
+	// create (static)
+	//
+	// Factory method, creates a new timeshiftbuffer instance
+	static std::unique_ptr<timeshiftbuffer> create(std::unique_ptr<pvrstream> basestream, char const* path, size_t buffersize);
+
+	// length
+	//
+	// Gets the length of the stream
+	long long length(void) const;
+
+	// mediatype
+	//
+	// Gets the media type of the stream
+	char const* mediatype(void) const;
+
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
+	// position
+	//
+	// Gets the current position of the stream
+	long long position(void) const;
+
+	// read
+	//
+	// Reads available data from the stream
+	size_t read(uint8_t* buffer, size_t count);
+
+	// realtime
+	//
+	// Gets a flag indicating if the stream is real-time
+	bool realtime(void) const;
+
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
+	// seek
+	//
+	// Sets the stream pointer to a specific position
+	long long seek(long long position, int whence);
+
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
+private:
+
+	timeshiftbuffer(timeshiftbuffer const&) = delete;
+	timeshiftbuffer& operator=(timeshiftbuffer const&) = delete;
+
+	// MAXIMUM_WAIT_TIME
+	//
+	// The maximum amount of time to wait for stream data
+	static unsigned int const MAXIMUM_WAIT_TIME;
+
+	// MPEGTS_PACKET_LENGTH
+	//
+	// Length of a single mpeg-ts data packet
+	static size_t const MPEGTS_PACKET_LENGTH;
+
+	// SPOOL_CHUNK_SIZE
+	//
+	// Maximum amount of data to read from the base stream at once
+	static size_t const SPOOL_CHUNK_SIZE;
+
+	// SPOOL_RETRY_INTERVAL
+	//
+	// Amount of time to wait after a zero-length read from the base stream
+	static unsigned int const SPOOL_RETRY_INTERVAL;
+
+	// Instance Constructor
+	//
+	timeshiftbuffer(std::unique_ptr<pvrstream> basestream, char const* path, size_t buffersize);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// copy_to
+	//
+	// Copies data into the circular file at the specified stream position
+	void copy_to(long long position, uint8_t const* buffer, size_t count);
+
+	// map_file
+	//
+	// Creates and maps the backing circular file into memory
+	void map_file(char const* path);
+
+	// minimum_position
+	//
+	// Calculates the minimum readable position; requires the lock be held
+	long long minimum_position(void) const;
+
+	// unmap_file
+	//
+	// Unmaps and releases the backing circular file
+	void unmap_file(void);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	// BASE STREAM
+	//
+	std::unique_ptr<pvrstream> const	m_basestream;			// Underlying stream instance
+	std::string const					m_mediatype;			// Underlying stream media type
+	std::thread							m_worker;				// Spool worker thread
+	std::exception_ptr					m_exception;			// Spool worker exception
+
+	// CIRCULAR FILE
+	//
+	size_t const						m_buffersize;			// Size of the circular file
+	uint8_t*							m_buffer = nullptr;		// Mapped view of the circular file
+#if defined(_WINDOWS) || defined(WINAPI_FAMILY)
+	HANDLE								m_file = INVALID_HANDLE_VALUE;	// Circular file handle
+	HANDLE								m_mapping = nullptr;	// Circular file mapping handle
+#else
+	int									m_file = -1;			// Circular file descriptor
+#endif
+
+	// STREAM STATE
+	//
+	mutable std::mutex					m_lock;					// Synchronization object
+	std::condition_variable				m_cv;					// Spool condition variable
+	long long							m_readpos = 0;			// Current read position
+	size_t								m_acquired = 0;			// Currently acquired data length
+	long long							m_writepos = 0;			// Current write position
+	bool								m_stop = false;			// Flag to stop the spool worker
+	bool								m_finished = false;		// Flag if spool worker has stopped
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __TIMESHIFTBUFFER_H_
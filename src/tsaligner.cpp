@@ -0,0 +1,409 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "tsaligner.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "align.h"
+
+#pragma warning(push, 4)
+
+// tsaligner::BUFFER_SIZE (static)
+//
+// Size of the packet staging buffer
+size_t const tsaligner::BUFFER_SIZE = (188 * 1024);
+
+// tsaligner::MPEGTS_PACKET_LENGTH (static)
+//
+// Length of a single mpeg-ts data packet
+size_t const tsaligner::MPEGTS_PACKET_LENGTH = 188;
+
+// tsaligner::MPEGTS_SYNC_BYTE (static)
+//
+// Value of the mpeg-ts packet sync byte
+uint8_t const tsaligner::MPEGTS_SYNC_BYTE = 0x47;
+
+//---------------------------------------------------------------------------
+// tsaligner Constructor (private)
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+
+tsaligner::tsaligner(std::unique_ptr<pvrstream> basestream) : m_basestream(std::move(basestream)), 
+	m_buffer(new uint8_t[BUFFER_SIZE])
+{
+	assert(m_basestream);
+}
+
+//---------------------------------------------------------------------------
+// tsaligner Destructor
+
+tsaligner::~tsaligner()
+{
+	close();
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::acquire
+//
+// Acquires a contiguous region of readable data from the stream
+//
+// Arguments:
+//
+//	count		- Maximum number of bytes to acquire
+//	available	- Receives the number of bytes acquired
+
+uint8_t* tsaligner::acquire(size_t count, size_t* available)
+{
+	size_t			basecount = 0;			// Bytes acquired from the base stream
+
+	assert(m_basestream);
+	assert(available != nullptr);
+
+	if(available == nullptr) throw std::invalid_argument("available");
+	*available = 0;
+
+	// The count should be aligned down to MPEGTS_PACKET_LENGTH and can't exceed the staging buffer, any
+	// data acquired from the base stream may have to be copied into it if it turns out to be unaligned
+	count = align::down(std::min(count, BUFFER_SIZE), MPEGTS_PACKET_LENGTH);
+	if(count == 0) return nullptr;
+
+	// If nothing has been staged and the stream is synchronized, the base stream data can be
+	// handed out directly as long as it consists entirely of whole, aligned packets
+	if((m_tail == m_head) && (m_synced)) {
+
+		m_head = m_tail = 0;
+
+		uint8_t* data = m_basestream->acquire(count, &basecount);
+		if((data == nullptr) || (basecount == 0)) return nullptr;
+
+		if(aligned(data, basecount) == basecount) {
+
+			m_passthrough = true;
+			*available = basecount;
+			return data;
+		}
+
+		// The base stream data is not aligned, stage it and find the packets the hard way
+		memcpy(&m_buffer[0], data, basecount);
+		m_basestream->release(basecount);
+		m_head = basecount;
+	}
+
+	while(true) {
+
+		// Locate the sync byte if the stream is not synchronized and return any aligned packets
+		if(!m_synced) resync();
+		if(m_synced) {
+
+			size_t length = aligned(&m_buffer[m_tail], m_head - m_tail);
+			if(length > 0) { *available = std::min(length, count); return &m_buffer[m_tail]; }
+
+			// If there is at least one whole packet staged but it isn't aligned, the stream has lost
+			// synchronization (glitch or discontinuity) and the sync byte has to be located again
+			if((m_head - m_tail) >= MPEGTS_PACKET_LENGTH) { m_synced = false; m_resyncs++; continue; }
+		}
+
+		// Move any partial packet data to the start of the staging buffer
+		if(m_tail > 0) {
+
+			memmove(&m_buffer[0], &m_buffer[m_tail], m_head - m_tail);
+			m_head -= m_tail;
+			m_tail = 0;
+		}
+
+		// Append more data from the base stream; if there is none, there is nothing to return yet
+		uint8_t* data = m_basestream->acquire(std::min(count, BUFFER_SIZE - m_head), &basecount);
+		if((data == nullptr) || (basecount == 0)) return nullptr;
+
+		memcpy(&m_buffer[m_head], data, basecount);
+		m_basestream->release(basecount);
+		m_head += basecount;
+	}
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::aligned (private, static)
+//
+// Determines the length of the aligned packets at the start of a buffer
+//
+// Arguments:
+//
+//	buffer		- Buffer containing the packet data
+//	count		- Length of the buffer in bytes
+
+size_t tsaligner::aligned(uint8_t const* buffer, size_t count)
+{
+	size_t length = 0;
+
+	while(((count - length) >= MPEGTS_PACKET_LENGTH) && (buffer[length] == MPEGTS_SYNC_BYTE)) length += MPEGTS_PACKET_LENGTH;
+	return length;
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::canseek
+//
+// Gets a flag indicating if the stream allows seek operations
+//
+// Arguments:
+//
+//	NONE
+
+bool tsaligner::canseek(void) const
+{
+	assert(m_basestream);
+	return m_basestream->canseek();
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::close
+//
+// Closes the stream
+//
+// Arguments:
+//
+//	NONE
+
+void tsaligner::close(void)
+{
+	assert(m_basestream);
+	m_basestream->close();
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::create (static)
+//
+// Factory method, creates a new tsaligner instance
+//
+// Arguments:
+//
+//	basestream		- Underlying pvrstream instance to wrap
+
+std::unique_ptr<tsaligner> tsaligner::create(std::unique_ptr<pvrstream> basestream)
+{
+	return std::unique_ptr<tsaligner>(new tsaligner(std::move(basestream)));
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::length
+//
+// Gets the length of the stream; or -1 if stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+long long tsaligner::length(void) const
+{
+	assert(m_basestream);
+	return m_basestream->length();
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::mediatype
+//
+// Gets the media type of the stream
+//
+// Arguments:
+//
+//	NONE
+
+char const* tsaligner::mediatype(void) const
+{
+	assert(m_basestream);
+	return m_basestream->mediatype();
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::minposition
+//
+// Gets the minimum position that the stream can be seeked to
+//
+// Arguments:
+//
+//	NONE
+
+long long tsaligner::minposition(void) const
+{
+	assert(m_basestream);
+	return m_basestream->minposition();
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long tsaligner::position(void) const
+{
+	assert(m_basestream);
+
+	// Data that has been staged but not yet returned precedes the base stream position
+	long long position = m_basestream->position();
+	return (position < 0) ? position : position - static_cast<long long>(m_head - m_tail);
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::read
+//
+// Reads available data from the stream
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t tsaligner::read(uint8_t* buffer, size_t count)
+{
+	size_t			available = 0;			// Available bytes to read
+
+	assert(buffer != nullptr);
+
+	// Acquire the next aligned packets and copy them into the destination buffer
+	uint8_t* data = acquire(count, &available);
+	if(available > 0) memcpy(buffer, data, available);
+
+	release(available);
+	return available;
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool tsaligner::realtime(void) const
+{
+	assert(m_basestream);
+	return m_basestream->realtime();
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::release
+//
+// Releases data previously acquired from the stream
+//
+// Arguments:
+//
+//	count		- Number of acquired bytes to release
+
+void tsaligner::release(size_t count)
+{
+	assert(m_basestream);
+
+	// Data handed out directly from the base stream is released back to it
+	if(m_passthrough) {
+
+		m_basestream->release(count);
+		m_passthrough = false;
+	}
+
+	else {
+
+		assert(count <= (m_head - m_tail));
+		m_tail += std::min(count, m_head - m_tail);
+	}
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::resync (private)
+//
+// Locates the first packet sync byte in the staging buffer
+//
+// Arguments:
+//
+//	NONE
+
+void tsaligner::resync(void)
+{
+	assert(!m_synced);
+
+	// Discard data until a sync byte is found that is followed by another sync byte exactly one
+	// packet later; if there isn't enough data to verify that, more has to be staged first
+	while((m_head - m_tail) > MPEGTS_PACKET_LENGTH) {
+
+		if((m_buffer[m_tail] == MPEGTS_SYNC_BYTE) && (m_buffer[m_tail + MPEGTS_PACKET_LENGTH] == MPEGTS_SYNC_BYTE)) {
+
+			m_synced = true;
+			return;
+		}
+
+		++m_tail;
+		++m_discarded;
+	}
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::seek
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long tsaligner::seek(long long position, int whence)
+{
+	assert(m_basestream);
+
+	// Any staged data is discarded and the stream has to be synchronized again
+	m_head = m_tail = 0;
+	m_synced = m_passthrough = false;
+
+	return m_basestream->seek(position, whence);
+}
+
+//---------------------------------------------------------------------------
+// tsaligner::telemetry
+//
+// Appends the stream telemetry values to a collection
+//
+// Arguments:
+//
+//	values		- Collection to receive the telemetry values
+
+void tsaligner::telemetry(telemetry_t& values) const
+{
+	assert(m_basestream);
+
+	values.emplace_back("tsaligner.resyncs", static_cast<long long>(m_resyncs));
+	values.emplace_back("tsaligner.discarded_bytes", m_discarded);
+
+	m_basestream->telemetry(values);
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
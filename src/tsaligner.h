@@ -0,0 +1,169 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __TSALIGNER_H_
+#define __TSALIGNER_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <memory>
+
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class tsaligner
+//
+// Implements a pvrstream wrapper that locates the MPEG-TS sync byte across read
+// boundaries and only returns whole, aligned transport stream packets
+
+class tsaligner : public pvrstream
+{
+public:
+
+	// Destructor
+	//
+	virtual ~tsaligner();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// acquire
+	//
+	// Acquires a contiguous region of readable data from the stream
+	uint8_t* acquire(size_t count, size_t* available);
+
+	// canseek
+	//
+	// Flag indicating if the stream allows seek operations
+	bool canseek(void) const;
+
+	// close
+	//
+	// Closes the stream
+	void close(void);
+
+	// create (static)
+	//
+	// Factory method, creates a new tsaligner instance
+	static std::unique_ptr<tsaligner> create(std::unique_ptr<pvrstream> basestream);
+
+	// length
+	//
+	// Gets the length of the stream
+	long long length(void) const;
+
+	// mediatype
+	//
+	// Gets the media type of the stream
+	char const* mediatype(void) const;
+
+	// minposition
+	//
+	// Gets the minimum position that the stream can be seeked to
+	long long minposition(void) const;
+
+	// position
+	//
+	// Gets the current position of the stream
+	long long position(void) const;
+
+	// read
+	//
+	// Reads available data from the stream
+	size_t read(uint8_t* buffer, size_t count);
+
+	// realtime
+	//
+	// Gets a flag indicating if the stream is real-time
+	bool realtime(void) const;
+
+	// release
+	//
+	// Releases data previously acquired from the stream
+	void release(size_t count);
+
+	// seek
+	//
+	// Sets the stream pointer to a specific position
+	long long seek(long long position, int whence);
+
+	// telemetry
+	//
+	// Appends the stream telemetry values to a collection
+	void telemetry(telemetry_t& values) const;
+
+private:
+
+	tsaligner(tsaligner const&) = delete;
+	tsaligner& operator=(tsaligner const&) = delete;
+
+	// BUFFER_SIZE
+	//
+	// Size of the packet staging buffer
+	static size_t const BUFFER_SIZE;
+
+	// MPEGTS_PACKET_LENGTH
+	//
+	// Length of a single mpeg-ts data packet
+	static size_t const MPEGTS_PACKET_LENGTH;
+
+	// MPEGTS_SYNC_BYTE
+	//
+	// Value of the mpeg-ts packet sync byte
+	static uint8_t const MPEGTS_SYNC_BYTE;
+
+	// Instance Constructor
+	//
+	tsaligner(std::unique_ptr<pvrstream> basestream);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// aligned
+	//
+	// Determines the length of the aligned packets at the start of a buffer
+	static size_t aligned(uint8_t const* buffer, size_t count);
+
+	// resync
+	//
+	// Locates the first packet sync byte in the staging buffer
+	void resync(void);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	std::unique_ptr<pvrstream> const	m_basestream;			// Underlying stream instance
+	std::unique_ptr<uint8_t[]>			m_buffer;				// Packet staging buffer
+	size_t								m_head = 0;				// Staging buffer head (write) position
+	size_t								m_tail = 0;				// Staging buffer tail (read) position
+	bool								m_synced = false;		// Flag if stream is synchronized
+	bool								m_passthrough = false;	// Flag if base stream data is acquired
+	size_t								m_resyncs = 0;			// Number of synchronization losses
+	long long							m_discarded = 0;		// Number of discarded bytes
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __TSALIGNER_H_
@@ -0,0 +1,345 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "tsdemuxer.h"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+#pragma warning(push, 4)
+
+// tsdemuxer::NO_TIMESTAMP (static)
+//
+// Value of a packet timestamp that was not provided
+long long const tsdemuxer::NO_TIMESTAMP = std::numeric_limits<long long>::min();
+
+// tsdemuxer::READ_SIZE (static)
+//
+// Amount of data to read from the stream at a time
+size_t const tsdemuxer::READ_SIZE = (mpegts::PACKET_LENGTH * 256);
+
+//---------------------------------------------------------------------------
+// read_timestamp (local)
+//
+// Reads a 33-bit PES timestamp from memory
+//
+// Arguments:
+//
+//	ptr		- Pointer to the data to be read
+
+static uint64_t read_timestamp(uint8_t const* ptr)
+{
+	return (static_cast<uint64_t>(ptr[0] & 0x0E) << 29) | (static_cast<uint64_t>(ptr[1]) << 22) |
+		(static_cast<uint64_t>(ptr[2] & 0xFE) << 14) | (static_cast<uint64_t>(ptr[3]) << 7) | (ptr[4] >> 1);
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer Constructor (private)
+//
+// Arguments:
+//
+//	stream		- Underlying pvrstream instance to demultiplex
+
+tsdemuxer::tsdemuxer(pvrstream& stream) : m_stream(stream), m_buffer(new uint8_t[READ_SIZE])
+{
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer Destructor
+
+tsdemuxer::~tsdemuxer()
+{
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer::complete (private)
+//
+// Completes a packetized elementary stream packet
+//
+// Arguments:
+//
+//	pid			- Elementary stream packet id
+//	pes			- Packetized elementary stream buffer
+
+void tsdemuxer::complete(uint16_t pid, struct pesbuffer& pes)
+{
+	std::vector<uint8_t> const& data = pes.data;
+
+	long long		pts = NO_TIMESTAMP;			// Presentation timestamp
+	long long		dts = NO_TIMESTAMP;			// Decode timestamp
+	size_t			headerlength = 6U;			// Length of the PES header
+
+	pes.started = false;
+
+	// The PES packet must start with the 0x000001 start code prefix
+	if((data.size() < 9U) || (data[0] != 0x00) || (data[1] != 0x00) || (data[2] != 0x01)) { pes.data.clear(); return; }
+
+	// Streams other than padding, private stream 2 and a handful of system streams have the optional PES header
+	uint8_t streamid = data[3];
+	if((streamid != 0xBC) && (streamid != 0xBE) && (streamid != 0xBF) && (streamid != 0xF0) && (streamid != 0xF1) && 
+		(streamid != 0xF2) && (streamid != 0xF8) && (streamid != 0xFF)) {
+
+		uint8_t flags = data[7];
+		headerlength = 9U + data[8];
+
+		if(((flags & 0x80) == 0x80) && (data.size() >= 14U)) pts = timestamp(read_timestamp(&data[9]));
+		if(((flags & 0xC0) == 0xC0) && (data.size() >= 19U)) dts = timestamp(read_timestamp(&data[14]));
+	}
+
+	// The decode timestamp is only present when it differs from the presentation timestamp
+	if(headerlength < data.size()) 
+		m_packets.push_back({ false, pid, std::vector<uint8_t>(data.begin() + headerlength, data.end()), pts, (dts == NO_TIMESTAMP) ? pts : dts });
+
+	// Clearing the buffer rather than moving it retains the allocation for the next packet
+	pes.data.clear();
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer::create (static)
+//
+// Factory method, creates a new tsdemuxer instance
+//
+// Arguments:
+//
+//	stream		- Underlying pvrstream instance to demultiplex
+
+std::unique_ptr<tsdemuxer> tsdemuxer::create(pvrstream& stream)
+{
+	return std::unique_ptr<tsdemuxer>(new tsdemuxer(stream));
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer::demux (private)
+//
+// Demultiplexes a single mpeg-ts packet
+//
+// Arguments:
+//
+//	packet		- Pointer to the mpeg-ts packet
+
+void tsdemuxer::demux(uint8_t* packet)
+{
+	// Packets flagged with a transport error are discarded outright
+	if((packet[1] & 0x80) == 0x80) return;
+
+	uint16_t pid = mpegts::read_be16(packet + 1U) & 0x1FFF;
+
+	// Program Association Table (PAT)
+	//
+	if(pid == 0x0000) {
+
+		// Only the first program listed in the PAT is demultiplexed, program zero is the network PID
+		int pmtpid = -1;
+		mpegts::enumerate_pat(packet, [&](uint16_t program, uint16_t programpid) -> void {
+
+			if((program != 0) && (pmtpid < 0)) pmtpid = programpid;
+		});
+
+		if(pmtpid >= 0) m_pmtpid = pmtpid;
+		return;
+	}
+
+	// Program Map Table (PMT)
+	//
+	if(static_cast<int>(pid) == m_pmtpid) {
+
+		// Elementary streams with a codec that can't be described to Kodi are dropped
+		std::vector<mpegts::elementarystream> streams;
+		mpegts::enumerate_pmt(packet, [&](uint8_t* entry) -> bool {
+
+			struct mpegts::elementarystream stream = mpegts::describe_stream(entry);
+			if(stream.codec != nullptr) streams.emplace_back(std::move(stream));
+			return false;
+		});
+
+		// The PMT is repeated continuously; only act on it if the layout has changed
+		if((streams.empty()) || ((streams.size() == m_streams.size()) && (std::equal(streams.begin(), streams.end(), m_streams.begin(),
+			[](mpegts::elementarystream const& lhs, mpegts::elementarystream const& rhs) -> bool {
+
+			return (lhs.pid == rhs.pid) && (lhs.streamtype == rhs.streamtype) && (lhs.language == rhs.language);
+		})))) return;
+
+		// Carry over the partially assembled data for any elementary streams that remain
+		std::map<uint16_t, struct pesbuffer> pes;
+		for(auto const& stream : streams) {
+
+			auto found = m_pes.find(stream.pid);
+			if(found != m_pes.end()) pes.emplace(stream.pid, std::move(found->second));
+			else pes.emplace(stream.pid, pesbuffer{ false, std::vector<uint8_t>() });
+		}
+
+		m_pes.swap(pes);
+		m_streams = std::move(streams);
+
+		// Let the consumer know that the stream layout has changed before any packets that follow it
+		m_packets.push_back({ true, 0, std::vector<uint8_t>(), NO_TIMESTAMP, NO_TIMESTAMP });
+		return;
+	}
+
+	// Packetized Elementary Stream (PES)
+	//
+	auto found = m_pes.find(pid);
+	if(found == m_pes.end()) return;
+
+	// Move the pointer beyond the TS header and any adaptation field, there may not be a payload
+	uint32_t header = mpegts::read_be32(packet);
+	if((header & 0x00000010) != 0x00000010) return;
+
+	size_t offset = 4U;
+	if((header & 0x00000020) == 0x00000020) offset += packet[4] + 1U;
+	if(offset >= mpegts::PACKET_LENGTH) return;
+
+	struct pesbuffer& pes = found->second;
+
+	// The payload unit start indicator marks the beginning of a new PES packet and therefore the end
+	// of the previous one; data that arrives before the first PES packet has started is discarded
+	if((header & 0x00400000) == 0x00400000) {
+
+		if(pes.started) complete(pid, pes);
+
+		pes.started = true;
+		pes.data.assign(packet + offset, packet + mpegts::PACKET_LENGTH);
+	}
+
+	else if(pes.started) pes.data.insert(pes.data.end(), packet + offset, packet + mpegts::PACKET_LENGTH);
+	else return;
+
+	// If the length of the PES packet is known (usually audio), it can be completed as soon as it has
+	// all arrived rather than waiting for the next one to start
+	if(pes.data.size() >= 6U) {
+
+		size_t length = mpegts::read_be16(&pes.data[4]);
+		if((length > 0) && (pes.data.size() >= (6U + length))) {
+
+			pes.data.resize(6U + length);
+			complete(pid, pes);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer::fill (private)
+//
+// Reads and demultiplexes the next chunk of data from the stream
+//
+// Arguments:
+//
+//	NONE
+
+bool tsdemuxer::fill(void)
+{
+	assert(m_buffered < READ_SIZE);
+
+	size_t read = m_stream.read(&m_buffer[m_buffered], READ_SIZE - m_buffered);
+	if(read == 0) return false;
+
+	m_buffered += read;
+
+	// The stream isn't necessarily packet aligned; walk forward a byte at a time until
+	// the sync byte is located, there is no need to be any smarter about it than that
+	size_t offset = 0;
+	while((m_buffered - offset) >= mpegts::PACKET_LENGTH) {
+
+		if(m_buffer[offset] != 0x47) { offset++; continue; }
+
+		demux(&m_buffer[offset]);
+		offset += mpegts::PACKET_LENGTH;
+	}
+
+	// Hang on to any partial packet at the end of the buffer for the next read
+	if(offset < m_buffered) memmove(&m_buffer[0], &m_buffer[offset], m_buffered - offset);
+	m_buffered -= offset;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer::read
+//
+// Reads the next elementary stream packet
+//
+// Arguments:
+//
+//	packet		- Receives the elementary stream packet
+
+bool tsdemuxer::read(struct packet& packet)
+{
+	while(m_packets.empty()) if(!fill()) return false;
+
+	packet = std::move(m_packets.front());
+	m_packets.pop_front();
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer::reset
+//
+// Discards all buffered and partially assembled data
+//
+// Arguments:
+//
+//	NONE
+
+void tsdemuxer::reset(void)
+{
+	m_buffered = 0;
+
+	for(auto& iterator : m_pes) { iterator.second.started = false; iterator.second.data.clear(); }
+
+	// Any pending stream layout change still needs to be reported to the consumer
+	bool streamchange = std::any_of(m_packets.begin(), m_packets.end(), [](struct packet const& packet) -> bool { return packet.streamchange; });
+
+	m_packets.clear();
+	if(streamchange) m_packets.push_back({ true, 0, std::vector<uint8_t>(), NO_TIMESTAMP, NO_TIMESTAMP });
+}
+
+//---------------------------------------------------------------------------
+// tsdemuxer::timestamp (private)
+//
+// Converts a 90KHz PES timestamp into microseconds relative to the stream start
+//
+// Arguments:
+//
+//	ticks		- 33-bit PES timestamp
+
+long long tsdemuxer::timestamp(uint64_t ticks)
+{
+	// The first timestamp observed establishes the start of the stream
+	if(m_lastpts < 0) m_lastpts = static_cast<long long>(ticks);
+
+	// Unwrap the timestamp relative to the previous value so that it can be treated as a continuous clock,
+	// this works as long as the stream doesn't move more than half of the 33-bit range at a time
+	long long delta = static_cast<long long>((ticks - static_cast<uint64_t>(m_lastpts)) & 0x1FFFFFFFFULL);
+	if(delta >= 0x100000000LL) delta -= 0x200000000LL;
+
+	m_lastpts = static_cast<long long>(ticks);
+	m_lasttime += delta;
+
+	return (m_lasttime * 100) / 9;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
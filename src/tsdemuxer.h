@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2016-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __TSDEMUXER_H_
+#define __TSDEMUXER_H_
+#pragma once
+
+#pragma warning(push, 4)
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "mpegts.h"
+#include "pvrstream.h"
+
+//---------------------------------------------------------------------------
+// Class tsdemuxer
+//
+// Implements a lightweight MPEG-TS demultiplexer that reassembles the packetized
+// elementary streams described by the program map table of a pvrstream
+
+class tsdemuxer
+{
+public:
+
+	// NO_TIMESTAMP
+	//
+	// Value of a packet timestamp that was not provided
+	static long long const NO_TIMESTAMP;
+
+	// packet
+	//
+	// Structure used to return a single elementary stream packet
+	struct packet {
+
+		bool						streamchange;	// Flag if the stream layout changed
+		uint16_t					pid;			// Elementary stream packet id
+		std::vector<uint8_t>		data;			// Elementary stream data
+		long long					pts;			// Presentation timestamp (microseconds)
+		long long					dts;			// Decode timestamp (microseconds)
+	};
+
+	// Destructor
+	//
+	~tsdemuxer();
+
+	//-----------------------------------------------------------------------
+	// Member Functions
+
+	// create (static)
+	//
+	// Factory method, creates a new tsdemuxer instance
+	static std::unique_ptr<tsdemuxer> create(pvrstream& stream);
+
+	// read
+	//
+	// Reads the next elementary stream packet
+	bool read(struct packet& packet);
+
+	// reset
+	//
+	// Discards all buffered and partially assembled data
+	void reset(void);
+
+private:
+
+	tsdemuxer(tsdemuxer const&)=delete;
+	tsdemuxer& operator=(tsdemuxer const&)=delete;
+
+	// pesbuffer
+	//
+	// Structure used to assemble a single packetized elementary stream packet
+	struct pesbuffer {
+
+		bool						started;		// Flag if the start has been seen
+		std::vector<uint8_t>		data;			// Packetized elementary stream data
+	};
+
+	// READ_SIZE
+	//
+	// Amount of data to read from the stream at a time
+	static size_t const READ_SIZE;
+
+	// Instance Constructor
+	//
+	tsdemuxer(pvrstream& stream);
+
+	//-----------------------------------------------------------------------
+	// Private Member Functions
+
+	// complete
+	//
+	// Completes a packetized elementary stream packet
+	void complete(uint16_t pid, struct pesbuffer& pes);
+
+	// demux
+	//
+	// Demultiplexes a single mpeg-ts packet
+	void demux(uint8_t* packet);
+
+	// fill
+	//
+	// Reads and demultiplexes the next chunk of data from the stream
+	bool fill(void);
+
+	// timestamp
+	//
+	// Converts a 90KHz PES timestamp into microseconds relative to the stream start
+	long long timestamp(uint64_t ticks);
+
+	//-----------------------------------------------------------------------
+	// Member Variables
+
+	pvrstream&								m_stream;				// Underlying stream instance
+	std::unique_ptr<uint8_t[]>				m_buffer;				// Stream data buffer
+	size_t									m_buffered = 0;			// Bytes held in the buffer
+	int										m_pmtpid = -1;			// Program map table packet id
+	std::vector<mpegts::elementarystream>	m_streams;				// Elementary stream layout
+	std::map<uint16_t, struct pesbuffer>	m_pes;					// Elementary stream buffers
+	std::deque<struct packet>				m_packets;				// Completed packets
+	long long								m_lastpts = -1;			// Last observed timestamp
+	long long								m_lasttime = 0;			// Last unwrapped timestamp
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif	// __TSDEMUXER_H_
@@ -23,7 +23,6 @@
 #include "stdafx.h"
 #include "xmlstream.h"
 
-#include <algorithm>
 #include <assert.h>
 
 #include "http_exception.h"
@@ -31,11 +30,6 @@
 
 #pragma warning(push, 4)
 
-// xmlstream::DEFAULT_RINGBUFFER_SIZE (static)
-//
-// Default ring buffer size, in bytes
-size_t const xmlstream::DEFAULT_RINGBUFFER_SIZE = (1 MiB);
-
 //---------------------------------------------------------------------------
 // curl_multi_get_result
 //
@@ -84,16 +78,10 @@ static bool curl_multi_get_result(CURLM* multi, CURL* easy, CURLcode *result)
 //	proxy			- Proxy string to specify for the connection
 //	share			- CURLSH instance to use for the connection
 
-xmlstream::xmlstream(char const* url, char const* useragent, char const* proxy, CURLSH* share) : m_buffersize(DEFAULT_RINGBUFFER_SIZE)
+xmlstream::xmlstream(char const* url, char const* useragent, char const* proxy, CURLSH* share)
 {
-	size_t		available = 0;				// Amount of available ring buffer data
-
 	if(url == nullptr) throw std::invalid_argument("url");
 
-	// Allocate the ring buffer using the 64KiB upward-aligned buffer size
-	m_buffer = std::unique_ptr<uint8_t[]>(new uint8_t[m_buffersize]);
-	if(!m_buffer) throw std::bad_alloc();
-
 	// Allocate and initialize the cURL handle error message buffer
 	m_curlerr = std::unique_ptr<char[]>(new char[CURL_ERROR_SIZE + 1]);
 	if(!m_curlerr) throw std::bad_alloc();
@@ -123,6 +111,8 @@ xmlstream::xmlstream(char const* url, char const* useragent, char const* proxy,
 			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_FOLLOWLOCATION, 1L);
 			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_MAXREDIRS, 5L);
 			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_CONNECTTIMEOUT, 10L);
+			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_LOW_SPEED_TIME, 60L);
 			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
 			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
 			if(curlresult == CURLE_OK) curlresult = curl_easy_setopt(m_curl, CURLOPT_SSL_VERIFYPEER, false);
@@ -136,24 +126,9 @@ xmlstream::xmlstream(char const* url, char const* useragent, char const* proxy,
 
 			if(curlresult != CURLE_OK) throw string_exception(__func__, ": curl_easy_setopt() failed: ", curl_easy_strerror(curlresult));
 
-			// Attempt to add the easy handle to the multi handle
+			// Attempt to add the easy handle to the multi handle; the data transfer doesn't start until transfer() is called
 			curlmresult = curl_multi_add_handle(m_curlm, m_curl);
 			if(curlmresult != CURLM_OK) throw string_exception(__func__, ": curl_multi_add_handle() failed: ", curl_multi_strerror(curlmresult));
-
-			try {
-
-				// Attempt to begin the data transfer and wait for the initial chunk of data to become available
-				transfer_until([&]() -> bool {
-
-					available = (m_tail > m_head) ? (m_buffersize - m_tail) + m_head : m_head - m_tail;
-					return (available > 0);
-				});
-
-				if(available == 0) throw string_exception(__func__, ": failed to receive HTTP response body");
-			}
-
-			// Remove the easy handle from the multi interface on exception
-			catch(...) { curl_multi_remove_handle(m_curlm, m_curl); throw; }
 		}
 
 		// Clean up and destroy the easy handle on exception
@@ -172,6 +147,23 @@ xmlstream::~xmlstream()
 	close();
 }
 
+//---------------------------------------------------------------------------
+// xmlstream::abort
+//
+// Aborts the data transfer from another thread
+//
+// Arguments:
+//
+//	NONE
+
+void xmlstream::abort(void)
+{
+	m_abort = true;
+
+	// Wake up the transfer if it's waiting on data from the host
+	if(m_curlm != nullptr) curl_multi_wakeup(m_curlm);
+}
+
 //---------------------------------------------------------------------------
 // xmlstream::close
 //
@@ -257,7 +249,7 @@ std::unique_ptr<xmlstream> xmlstream::create(char const* url, char const* userag
 //---------------------------------------------------------------------------
 // xmlstream::curl_write (static, private)
 //
-// libcurl callback to write transferred data into the buffer
+// libcurl callback to pass received data to the transfer handler
 //
 // Arguments:
 //
@@ -269,161 +261,93 @@ std::unique_ptr<xmlstream> xmlstream::create(char const* url, char const* userag
 size_t xmlstream::curl_write(void const* data, size_t size, size_t count, void* context)
 {
 	size_t				cb = size * count;			// Calculate the actual byte count
-	size_t				byteswritten = 0;			// Total bytes actually written
+	long				responsecode = 200;			// Assume HTTP 200: OK
 
 	if((data == nullptr) || (cb == 0) || (context == nullptr)) return 0;
 
 	// Cast the context pointer back into a xmlstream instance
 	xmlstream* instance = reinterpret_cast<xmlstream*>(context);
+	assert(instance->m_handler != nullptr);
 
-	// This operation requires that all of the data be written, if it isn't going to fit in the
-	// available ring buffer space, the input stream has to be paused via CURL_WRITEFUNC_PAUSE
-	size_t available = (instance->m_head < instance->m_tail) ? instance->m_tail - instance->m_head : (instance->m_buffersize - instance->m_head) + instance->m_tail;
-	if(available < (cb + 1)) { instance->m_paused = true; return CURL_WRITEFUNC_PAUSE; }
-
-	// Write until the buffer has been exhausted or the desired count has been reached
-	while(cb) {
+	// Only the body of a successful response is passed to the handler, anything else is discarded
+	// here and then reported as an http_exception when the transfer has completed
+	curl_easy_getinfo(instance->m_curl, CURLINFO_RESPONSE_CODE, &responsecode);
+	if((responsecode < 200) || (responsecode > 299)) return cb;
 
-		// If the head is behind the tail linearly, take the data between them otherwise
-		// take the data between the end of the buffer and the head
-		size_t chunk = (instance->m_head < instance->m_tail) ? std::min(cb, instance->m_tail - instance->m_head) : std::min(cb, instance->m_buffersize - instance->m_head);
-		memcpy(&instance->m_buffer[instance->m_head], &reinterpret_cast<uint8_t const*>(data)[byteswritten], chunk);
+	// Exceptions cannot be allowed to propagate through libcurl; hold onto it and abort the
+	// transfer, it will be rethrown by transfer() after control has returned from libcurl
+	try { instance->m_aborted = !(*instance->m_handler)(reinterpret_cast<uint8_t const*>(data), cb); }
+	catch(...) { instance->m_exception = std::current_exception(); instance->m_aborted = true; }
 
-		instance->m_head += chunk;		// Increment the head position
-		byteswritten += chunk;			// Increment number of bytes written
-		cb -= chunk;					// Decrement remaining bytes
+	// Returning anything other than the number of bytes provided aborts the transfer
+	if(instance->m_aborted) return 0;
 
-		// If the head has reached the end of the buffer, reset it back to zero
-		if(instance->m_head >= instance->m_buffersize) instance->m_head = 0;
-	}
-
-	assert(byteswritten == (size * count));		// Verify all bytes were written
-
-	return byteswritten;
+	instance->m_received += cb;
+	return cb;
 }
 
 //---------------------------------------------------------------------------
-// xmlstream::read
+// xmlstream::transfer
 //
-// Reads data from the live stream
+// Executes the data transfer, passing the received data to the specified handler
 //
 // Arguments:
 //
-//	buffer		- Buffer to receive the live stream data
-//	count		- Size of the destination buffer in bytes
+//	handler		- Handler to receive the data; returns false to abort the transfer
 
-size_t xmlstream::read(uint8_t* buffer, size_t count)
-{
-	size_t				bytesread = 0;			// Total bytes actually read
-	size_t				available = 0;			// Available bytes to read
-
-	assert((m_curlm != nullptr) && (m_curl != nullptr));
-
-	if(count >= m_buffersize) throw std::invalid_argument("count");
-	if(count == 0) return 0;
-
-	// Transfer data into the ring buffer until data is available, the stream has completed, 
-	// or an exception/error occurs
-	transfer_until([&]() -> bool {
-
-		available = (m_tail > m_head) ? (m_buffersize - m_tail) + m_head : m_head - m_tail;
-		return (available > 0);
-	});
-
-	// If there is no available data in the ring buffer after transfer_until, indicate stream is finished
-	if(available == 0) return 0;
-
-	// Copy the data from the ring buffer into the destination buffer
-	count = std::min(available, count); 
-	while(count) {
-
-		// If the tail is behind the head linearly, take the data between them otherwise
-		// take the data between the end of the buffer and the tail
-		size_t chunk = (m_tail < m_head) ? std::min(count, m_head - m_tail) : std::min(count, m_buffersize - m_tail);
-		if(buffer != nullptr) memcpy(&buffer[bytesread], &m_buffer[m_tail], chunk);
-
-		m_tail += chunk;					// Increment the tail position
-		bytesread += chunk;					// Increment number of bytes read
-		count -= chunk;						// Decrement remaining bytes
-
-		// If the tail has reached the end of the buffer, reset it back to zero
-		if(m_tail >= m_buffersize) m_tail = 0;
-	}
-
-	return bytesread;
-}
-
-//---------------------------------------------------------------------------
-// xmlstream::transfer_until (private)
-//
-// Executes the data transfer until the specified predicate has been satisfied
-// or the transfer has completed
-//
-// Arguments:
-//
-//	predicate		- Predicate to be satisfied by the transfer
-
-bool xmlstream::transfer_until(std::function<bool(void)> predicate)
+bool xmlstream::transfer(xmlstream_handler const& handler)
 {
 	int				numfds;				// Number of active file descriptors
 
 	assert((m_curlm != nullptr) && (m_curl != nullptr));
 
-	// If the stream has been paused due to the ring buffer filling up, attempt to resume it
-	if(m_paused) {
-
-		// Determine the amount of free space in the ring buffer
-		size_t free = (m_head < m_tail) ? m_tail - m_head : (m_buffersize - m_head) + m_tail;
+	m_handler = &handler;				// Set the active transfer handler
+	m_aborted = false;					// Reset the transfer aborted flag
 
-		// If the buffer now has more than 50% free space available, resume the transfer.  Note that
-		// calling curl_easy_pause() with CURLPAUSE_CONT synchronously attempts a write operation
-		if(free >= (m_buffersize / 2)) {
-
-			m_paused = false;									// Reset the stream paused flag
-			curl_easy_pause(m_curl, CURLPAUSE_CONT);			// Resume transfer on the stream
+	// Execute the data transfer until it has completed or has been aborted by either the handler or abort(); the
+	// handler is invoked synchronously from curl_write() as data is received. A host that stops sending data
+	// fails the transfer with CURLE_OPERATION_TIMEDOUT once it has been below the low speed limit long enough
+	CURLMcode curlmresult = curl_multi_perform(m_curlm, &numfds);
+	while((curlmresult == CURLM_OK) && (!m_aborted) && (!m_abort) && (numfds > 0)) {
 
-			if(m_paused) return predicate();					// Still paused; abort
-		}
+		curlmresult = curl_multi_poll(m_curlm, nullptr, 0, 500, nullptr);
+		if(curlmresult == CURLM_OK) curlmresult = curl_multi_perform(m_curlm, &numfds);
 	}
 
-	// Attempt an initial data transfer operation and abort if there are no transfers
-	CURLMcode curlmresult = curl_multi_perform(m_curlm, &numfds);
-	if(numfds == 0) return predicate();
+	if(m_abort) m_aborted = true;
 
-	// Continue to execute the data transfer until the predicate has been satisfied, the data
-	// transfer operation is complete, or the stream has been paused due to a full buffer condition
-	while((curlmresult == CURLM_OK) && (!m_paused) && (numfds > 0) && (predicate() == false)) {
+	m_handler = nullptr;				// Reset the active transfer handler
 
-		curlmresult = curl_multi_wait(m_curlm, nullptr, 0, 500, nullptr);
-		if(curlmresult == CURLM_OK) curlmresult = curl_multi_perform(m_curlm, &numfds);
-	}
+	// If the handler threw an exception, rethrow it now that control has returned from libcurl
+	if(m_exception) { std::exception_ptr exception = m_exception; m_exception = nullptr; std::rethrow_exception(exception); }
 
 	// If a curl error occurred, throw an exception
 	if(curlmresult != CURLM_OK) throw string_exception(__func__, ": ", curl_multi_strerror(curlmresult));
 
-	// If the number of file descriptors has reduced to zero, the transfer has completed.
-	// Check for a cURL error or an HTTP error response on the transfer
-	if(numfds == 0) {
+	// If the handler aborted the transfer there is no result to check
+	if(m_aborted) return false;
 
-		CURLcode		result = CURLE_OK;			// Assume everything went well
-		long			responsecode = 200;			// Assume HTTP 200: OK
+	CURLcode		result = CURLE_OK;			// Assume everything went well
+	long			responsecode = 200;			// Assume HTTP 200: OK
 
-		// Get the cURL result code for the easy handle and remove it from the multi
-		// interface to prevent any more data transfer operations from taking place
-		curl_multi_get_result(m_curlm, m_curl, &result);
-		curl_multi_remove_handle(m_curlm, m_curl);
+	// Get the cURL result code for the easy handle and remove it from the multi
+	// interface to prevent any more data transfer operations from taking place
+	curl_multi_get_result(m_curlm, m_curl, &result);
+	curl_multi_remove_handle(m_curlm, m_curl);
 
-		// If the cURL result indicated a failure, throw it as an exception
-		if(result != CURLE_OK) throw string_exception((strlen(m_curlerr.get())) ? m_curlerr.get() : curl_easy_strerror(result));
+	// If the cURL result indicated a failure, throw it as an exception
+	if(result != CURLE_OK) throw string_exception((strlen(m_curlerr.get())) ? m_curlerr.get() : curl_easy_strerror(result));
 
-		// The response code will come back as zero if there was no response from the host,
-		// otherwise it should be a standard HTTP response code
-		curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &responsecode);
-		if(responsecode == 0) throw string_exception(__func__, ": no response from host");
-		else if((responsecode < 200) || (responsecode > 299)) throw http_exception(responsecode);
-	}
+	// The response code will come back as zero if there was no response from the host,
+	// otherwise it should be a standard HTTP response code
+	curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &responsecode);
+	if(responsecode == 0) throw string_exception(__func__, ": no response from host");
+	else if((responsecode < 200) || (responsecode > 299)) throw http_exception(responsecode);
+
+	// A successful response with no body is still treated as a failure
+	if(m_received == 0) throw string_exception(__func__, ": failed to receive HTTP response body");
 
-	return predicate();				// Re-evaluate the predicate as the result
+	return true;
 }
 
 //---------------------------------------------------------------------------
@@ -26,13 +26,24 @@
 
 #pragma warning(push, 4)
 
+#include <atomic>
+#include <exception>
 #include <functional>
 #include <memory>
 
+//---------------------------------------------------------------------------
+// DATA TYPES
+//---------------------------------------------------------------------------
+
+// xmlstream_handler
+//
+// Handler invoked with the data received by xmlstream; return false to abort the transfer
+using xmlstream_handler = std::function<bool(uint8_t const* data, size_t count)>;
+
 //---------------------------------------------------------------------------
 // Class xmlstream
 //
-// Implements an HTTP-based XML stream reader
+// Implements an HTTP-based XML stream that pushes the received data to a handler
 
 class xmlstream
 {
@@ -45,6 +56,11 @@ public:
 	//-----------------------------------------------------------------------
 	// Member Functions
 
+	// abort
+	//
+	// Aborts the data transfer from another thread
+	void abort(void);
+
 	// close
 	//
 	// Closes the stream
@@ -58,21 +74,16 @@ public:
 	static std::unique_ptr<xmlstream> create(char const* url, char const* useragent, char const* proxy);
 	static std::unique_ptr<xmlstream> create(char const* url, char const* useragent, char const* proxy, CURLSH* share);
 
-	// read
+	// transfer
 	//
-	// Reads available data from the stream
-	size_t read(uint8_t* buffer, size_t count);
+	// Executes the data transfer, passing the received data to the specified handler
+	bool transfer(xmlstream_handler const& handler);
 
 private:
 
 	xmlstream(xmlstream const&)=delete;
 	xmlstream& operator=(xmlstream const&)=delete;
 
-	// DEFAULT_RINGBUFFER_SIZE
-	//
-	// Default ring buffer size, in bytes
-	static size_t const DEFAULT_RINGBUFFER_SIZE;
-
 	// Instance Constructor
 	//
 	xmlstream(char const* url, char const* useragent, char const* proxy, CURLSH* share);
@@ -82,14 +93,9 @@ private:
 
 	// curl_write (static)
 	//
-	// libcurl callback to write received data into the buffer
+	// libcurl callback to pass received data to the transfer handler
 	static size_t curl_write(void const* data, size_t size, size_t count, void* context);
 
-	// transfer_until
-	//
-	// Executes the data tranfer until the predicate has been satisfied
-	bool transfer_until(std::function<bool(void)> predicate);
-
 	//-----------------------------------------------------------------------
 	// Member Variables
 
@@ -98,14 +104,14 @@ private:
 	CURL*						m_curl = nullptr;					// CURL easy interface handle
 	CURLM*						m_curlm = nullptr;					// CURL multi interface handle
 	std::unique_ptr<char[]>		m_curlerr;							// CURL error message
-	bool						m_paused = false;					// Flag if transfer is paused
 
-	// RING BUFFER
+	// TRANSFER HANDLER
 	//
-	size_t const				m_buffersize;						// Size of the ring buffer
-	std::unique_ptr<uint8_t[]>	m_buffer;							// Ring buffer stroage
-	size_t						m_head = 0;							// Head (write) buffer position
-	size_t						m_tail = 0;							// Tail (read) buffer position
+	xmlstream_handler const*	m_handler = nullptr;				// Active transfer handler
+	std::exception_ptr			m_exception;						// Exception thrown by handler
+	bool						m_aborted = false;					// Flag if handler aborted transfer
+	std::atomic<bool>			m_abort{false};						// Flag to abort the transfer
+	uint64_t					m_received = 0;						// Bytes passed to the handler
 };
 
 //-----------------------------------------------------------------------------